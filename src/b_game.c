@@ -54,6 +54,12 @@
 #include "r_things.h"
 #include "g_game.h"
 #include "d_net.h"
+#include "d_clisrv.h"
+  // D_BackupTics_Mem
+#include "m_profile.h"
+  // M_Time_ns
+#include "i_system.h"
+  // I_Quit
 #include "byteptr.h"
 
 
@@ -452,6 +458,94 @@ void B_Register_Commands( void )
     COM_AddCommand ("addbot", Command_AddBot, CC_command);
 }
 
+
+// -stressbots num tics
+// Bot stress test, for the player tables and the LARGE_LOBBY profile.
+// Adds the bots at the start map, times the tics of the game,
+// then prints the memory and tic timing, and quits.
+// The bots are players of the server node, and send no packets, so this
+// times the playsim and the player tables, not the per node net paths
+// (netcmds from clients, ackpak, net_nodes).  Those need real clients.
+byte  stressbots_active = 0;
+
+static int  stress_numbots;
+static int  stress_tics;
+static int  stress_tic_cnt;
+static uint64_t  stress_sum_ns;
+static uint64_t  stress_max_ns;
+static uint64_t  stress_start_ns;
+
+// Check for -stressbots.
+// Return true when the game must autostart.
+boolean  B_StressBots_Init( void )
+{
+    if( ! M_CheckParm( "-stressbots" ) )
+        return false;
+
+    stress_numbots = ( M_IsNextParm() )? atoi( M_GetNextParm() ) : (MAXPLAYERS - 1);
+    stress_tics = ( M_IsNextParm() )? atoi( M_GetNextParm() ) : (20 * TICRATE);
+    if( stress_numbots < 1 )
+        stress_numbots = 1;
+    if( stress_numbots > (MAXPLAYERS - 1) )
+        stress_numbots = MAXPLAYERS - 1;  // the console player has one
+    if( stress_tics < 1 )
+        stress_tics = 1;
+
+    // Bots are added by B_Regulate_Bots, when the level loads.
+    CV_SetValue( &cv_bots, stress_numbots );
+    stress_tic_cnt = 0;
+    stress_sum_ns = stress_max_ns = 0;
+    stressbots_active = 1;
+    return true;
+}
+
+// Called after each game tic, by TryRunTics.
+//   tic_start_ns : M_Time_ns at the start of the tic
+void  B_StressBots_Tic( uint64_t tic_start_ns )
+{
+    uint64_t  now = M_Time_ns();
+    uint64_t  tic_ns = now - tic_start_ns;
+    int  pn, numbots;
+    int  memfree, cache, used, largefreeblock;
+
+    if( gamestate != GS_LEVEL )
+        return;
+
+    if( stress_tic_cnt == 0 )
+    {
+        // Start timing when all the bots have joined.
+        numbots = 0;
+        for( pn=0; pn<MAXPLAYERS; pn++ )
+        {
+            if( playeringame[pn] && players[pn].bot )
+                numbots++;
+        }
+        if( numbots < stress_numbots && leveltime < (5 * TICRATE) )
+            return;
+
+        GenPrintf( EMSG_info, "Stress bots: %d players, %d bots, timing %d tics\n",
+                   num_game_players, numbots, stress_tics );
+        stress_start_ns = tic_start_ns;
+    }
+
+    stress_sum_ns += tic_ns;
+    if( tic_ns > stress_max_ns )
+        stress_max_ns = tic_ns;
+    if( ++stress_tic_cnt < stress_tics )
+        return;
+
+    Z_FreeMemory( &memfree, &cache, &used, &largefreeblock );
+    GenPrintf( EMSG_info, "Stress bots: %d tics in %d ms, tic avg %d us, max %d us\n",
+               stress_tic_cnt,
+               (int)((now - stress_start_ns) / 1000000),
+               (int)(stress_sum_ns / stress_tic_cnt / 1000),
+               (int)(stress_max_ns / 1000) );
+    GenPrintf( EMSG_info, "Stress bots: MAXPLAYERS %d, backup tics %d, %d KB, zone used %d KB\n",
+               MAXPLAYERS, backup_tics, (int)(D_BackupTics_Mem() >> 10), used >> 10 );
+    stressbots_active = 0;
+    I_Quit();  // No return
+}
+
 static
 void B_AvoidMissile(player_t* p, mobj_t* missile)
 {
@@ -52,6 +52,11 @@ void B_Send_bot_NameColor( byte pn );
 void B_Send_all_bots_NameColor(void);
 void B_Regulate_Bots( int req_numbots );
 
+// -stressbots num tics
+extern byte  stressbots_active;
+boolean  B_StressBots_Init( void );
+void  B_StressBots_Tic( uint64_t tic_start_ns );
+
 void B_forget_stuff( bot_t * bot );
 
 void B_Destroy_Bot( player_t * player );
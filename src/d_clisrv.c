@@ -160,6 +160,8 @@
 #include "t_script.h"
 
 #include "b_game.h"	//added by AC for acbot
+#include "m_profile.h"
+  // M_Time_ns
 #include "r_things.h"
   // skins
 #include "g_input.h"
@@ -185,13 +187,23 @@
 
 // The addition of wait messages should be transparent to previous network
 // versions.
+// The default build is unchanged on the wire, the new packet types and
+// flags are negotiated, so older clients still join.
+// The LARGE_LOBBY player masks and player tables are wider,
+// so it is only compatible with another LARGE_LOBBY build.
+#if MAXPLAYERS > 32
+const int  NETWORK_VERSION = 1026; // separate version number for network protocol (obsolete)
+#else
 const int  NETWORK_VERSION = 26; // separate version number for network protocol (obsolete)
+#endif
 
 
 #define JOININGAME
 
 
-#if NUM_SERVERTIC_CMD < BACKUPTICS
+// The ticcmd of one player for 32 backup tics fit in one packet.
+// More backup tics use extension packets.
+#if NUM_SERVERTIC_CMD < 32
 # error Not enough NUM_SERVERTIC_CMD
 #endif
 
@@ -218,7 +230,7 @@ static byte  network_state = NETS_idle;  // network_state_e
 static byte  quit_netgame_status = 0;  // to avoid repeating shutdown
 static byte  wait_netplayer = 0;
 
-#define PREDICTIONQUEUE         BACKUPTICS
+#define PREDICTIONQUEUE         BACKUPTICS_MAX
 #define PREDICTIONMASK          (PREDICTIONQUEUE-1)
 
 // Server state
@@ -294,6 +306,7 @@ static byte     join_waiting[MAXNETNODES];  // num of players waiting to join
 static byte     consistency_faults[MAXNETNODES];
 static tic_t    nettics[MAXNETNODES];     // what tic the client have received
 static tic_t    nextsend_tic[MAXNETNODES]; // what server sent to client
+static byte     tic_delta_node[MAXNETNODES]; // client takes TPF_delta servertics
 
 static tic_t    next_tic_send;     // min of the nettics
 static tic_t    next_tic_clear=0;  // clear next_tic_clear to next_tic_send
@@ -330,6 +343,7 @@ boolean         cl_drone; // client displays, no commands
 static byte     cl_nnode; // net node for this client, assigned by server (server nnode space)
 static byte     cl_error_status = 0;  // repair
 static boolean  cl_packetmissed;
+static byte     cl_tic_delta = 0;  // server sends TPF_delta servertics
 static tic_t    cl_need_tic;
 static tic_t    cl_prev_tic = 0;  // client tests once per tic
 
@@ -351,18 +365,18 @@ static textbuf_t  localtextcmd[2];
 
 // engine
 // Server packet state
-static uint32_t ticcmd_player_mask = 0;  // one bit for each player that sends ticcmd, no bots
+static player_mask_t ticcmd_player_mask = 0;  // one bit for each player that sends ticcmd, no bots
 static byte     num_ticcmd_per_tic = 0;  // num in ticcmd_pid
 static byte     ticcmd_pid[MAXPLAYERS];  // pid in order of ticcmd in packet
 static byte     update_player_count_request = 0;  // for XNetCmd, as the list is in use during execution
 
 // NetCmd and TextCmd store
-// Index for netcmds and textcmds
-#define BTIC_INDEX( tic )  ((tic)%BACKUPTICS)
+// Allocated for backup_tics, by D_Alloc_BackupTics.
+int  backup_tics = BACKUPTICS;
 // Index using BTIC_INDEX
-static byte     netcmd_tic_hash[BACKUPTICS];  // tic hash for the BACKUPTIC
-static byte     netseq[BACKUPTICS];   // bit per tic packet seq, ready=0xFF
-ticcmd_t        netcmds[BACKUPTICS][MAXPLAYERS];
+static byte *   netcmd_tic_hash = NULL;  // tic hash for the BACKUPTIC
+static byte *   netseq = NULL;   // bit per tic packet seq, ready=0xFF
+ticcmd_t        (*netcmds)[MAXPLAYERS] = NULL;
 
 // [WDJ] Combined textcmd buffer for all players, and server.
 // No apparant reason to keep separate buffers at this point.
@@ -380,9 +394,9 @@ typedef struct {
    byte      buff[MAX_TEXTCMD_BUFF+1];  // format as array of textcmd_item_t
              // Format: pn, len, text[MAXTEXTCMD]
 } textcmdbuff_t;
-static textcmdbuff_t  textcmdbuff[BACKUPTICS];
+static textcmdbuff_t *  textcmdbuff = NULL;
 
-static int16_t    consistency[BACKUPTICS];
+static int16_t *  consistency = NULL;
 
 
 
@@ -397,6 +411,8 @@ consvar_t cv_download_files = {"download_files"  ,"1", CV_SAVE, download_cons_t}
 consvar_t cv_SV_download_files = {"sv_download_files"  ,"1", CV_SAVE, download_cons_t};
 consvar_t cv_download_savegame = {"download_savegame"  ,"1", CV_SAVE, download_cons_t};
 consvar_t cv_SV_download_savegame = {"sv_download_savegame"  ,"1", CV_SAVE, download_cons_t};
+// KB/sec, for all window mode file transfers
+consvar_t cv_SV_filetx_rate = {"sv_filetx_rate", "512", CV_VALUE|CV_SAVE, CV_Unsigned};
 
 CV_PossibleValue_t netrepair_cons_t[] = {{0,"None"},{1,"Minimal"},{2,"Medium"},{3,"Aggressive"},{0,NULL}};
 consvar_t cv_netrepair = {"netrepair","2", CV_SAVE, netrepair_cons_t};
@@ -476,6 +492,29 @@ uint32_t  read_N32( N32_t * vf )
 #endif
 }
 
+static
+void  write_NPM( NPM_t * vf, player_mask_t val )
+{
+    // LSB first
+    int i;
+    for( i=0; i<sizeof(NPM_t); i++ )
+    {
+        vf->b[i] = val;
+        val >>= 8;
+    }
+}
+
+static
+player_mask_t  read_NPM( NPM_t * vf )
+{
+    // LSB first
+    player_mask_t  val = 0;
+    int i;
+    for( i=sizeof(NPM_t)-1; i>=0; i-- )
+        val = (val<<8) | vf->b[i];
+    return val;
+}
+
 
 // Handle errors from HSendPacket consistently.
 static void  generic_network_error_handler( byte errcode, const char * who )
@@ -487,7 +526,7 @@ static void  generic_network_error_handler( byte errcode, const char * who )
 
 static byte btic_hash( tic_t tic )
 {
-    // Overlap with the BTIC_INDEX (tic % BACKUPTICS) is wasted.
+    // Overlap with the BTIC_INDEX (tic % backup_tics) is wasted.
     return (byte) (tic >> 4);
 }
 
@@ -866,7 +905,7 @@ static void net_textcmd_handler( byte nnode )
 
             // When a textbuf is too full, use the next tic.	   
             tic++;
-            if( tic >= (next_tic_send+BACKUPTICS) )
+            if( tic >= (next_tic_send+backup_tics) )
                 goto drop_packet;  // ran out of tic buffers
         }
 
@@ -1324,7 +1363,10 @@ static byte  SendPacket( byte nnode, byte packettype )
 typedef enum {
   NF_drone = 0x80,
   NF_big_endian = 0x40,
+  NF_tic_delta = 0x20,  // can take TPF_delta servertics
   NF_download_savegame = 0x10,
+  NF_filetx_window = 0x08,  // FTC_window
+  NF_filetx_zlib = 0x04,    // FTC_zlib
 } join_flags_e;
 
 // By Client.
@@ -1332,9 +1374,11 @@ typedef enum {
 // Called by CL_ConnectToServer.
 static boolean  CL_Send_Join( void )
 {
-    byte flg = 0;
+    byte flg = NF_tic_delta;
     if( cv_download_savegame.EV )  flg |= NF_download_savegame;
     if( cl_drone )  flg |= NF_drone;
+    if( CL_Filetx_Caps() & FTC_window )  flg |= NF_filetx_window;
+    if( CL_Filetx_Caps() & FTC_zlib )  flg |= NF_filetx_zlib;
 #ifdef __BIG_ENDIAN__
     flg |= NF_big_endian;
 #endif
@@ -1409,22 +1453,23 @@ static boolean SV_Send_ServerConfig( byte to_node, byte command )
 
 #if 1
     // Send mask for all players and bots
-    int   i,playermask=0;
+    int   i;
+    player_mask_t  playermask=0;
     for(i=0;i<MAXPLAYERS;i++)
     {
          if(playeringame[i])
-              playermask|=1<<i;
+              playermask|=PLAYER_BIT(i);
     }
-    write_N32( & netbuffer->u.servercfg.playerdetected, playermask );
+    write_NPM( & netbuffer->u.servercfg.playerdetected, playermask );
 #else
     // Send mask for all players, but not bots.
     update_player_counts();   // not necessary, already done
-    write_N32( & netbuffer->u.servercfg.playerdetected, ticcmd_player_mask );
+    write_NPM( & netbuffer->u.servercfg.playerdetected, ticcmd_player_mask );
 #endif
 
     netbuffer->packettype=PT_SERVERCFG;
     netbuffer->u.servercfg.version         = VERSION;
-    netbuffer->u.servercfg.ver1 = 0;
+    netbuffer->u.servercfg.cfg_flags = (tic_delta_node[to_node])? SCF_tic_delta : 0;
     netbuffer->u.servercfg.ver2 = VERSION;
     netbuffer->u.servercfg.ver3 = REVISION;
     netbuffer->u.servercfg.subversion      = LE_SWAP32(NETWORK_VERSION);
@@ -1971,9 +2016,8 @@ static void  CL_set_mobj( mobj_pos_t * mpp, unsigned int objtype, const char * m
         *mopp = mo;  // save new mobj
 #else
         // incomplete
-        mo = Z_Malloc(sizeof(*mobj), PU_LEVEL, NULL);
+        mo = P_Alloc_Mobj();
         *mopp = mo;  // save new mobj
-        memset(pp->mo, 0, sizeof(mobj_t));
         if( gamestate == GS_LEVEL )
             setthingpos = 1;
 #endif
@@ -3613,7 +3657,7 @@ void Got_NetXCmd_KickCmd(xcmd_t * xc)
     }
 }
 
-CV_PossibleValue_t maxplayers_cons_t[]={{1,"MIN"},{32,"MAX"},{0,NULL}};
+CV_PossibleValue_t maxplayers_cons_t[]={{1,"MIN"},{MAXPLAYERS,"MAX"},{0,NULL}};
 
 consvar_t cv_allownewplayer = {"sv_allownewplayers","1",0,CV_OnOff};
 consvar_t cv_maxplayers     =
@@ -3622,6 +3666,28 @@ consvar_t cv_maxplayers     =
 static void Got_NetXCmd_AddPlayer(xcmd_t * xc);
 static void Got_NetXCmd_AddBot(xcmd_t * xc);	//added by AC for acbot
 
+// Allocate the tic stores for backup_tics.
+// Memory used by the backup tic tables, in bytes.
+size_t  D_BackupTics_Mem( void )
+{
+    return backup_tics * ( sizeof(byte) + sizeof(byte) + sizeof(ticcmd_t[MAXPLAYERS])
+                           + sizeof(textcmdbuff_t) + sizeof(int16_t) );
+}
+
+// Called one time at init, by D_Init_ClientServer.
+static void D_Alloc_BackupTics( void )
+{
+    netcmd_tic_hash = calloc( backup_tics, sizeof(byte) );
+    netseq = calloc( backup_tics, sizeof(byte) );
+    netcmds = calloc( backup_tics, sizeof(ticcmd_t[MAXPLAYERS]) );
+    textcmdbuff = calloc( backup_tics, sizeof(textcmdbuff_t) );
+    consistency = calloc( backup_tics, sizeof(int16_t) );
+    if( !netcmd_tic_hash || !netseq || !netcmds || !textcmdbuff || !consistency )
+        I_Error( "Backup tics: cannot allocate %d tics\n", backup_tics );
+
+    GenPrintf(EMSG_ver, "Backup tics %d, %d KB\n", backup_tics, (int)(D_BackupTics_Mem() >> 10) );
+}
+
 // Called one time at init, by D_Startup_NetGame.
 void D_Init_ClientServer (void)
 {
@@ -3658,6 +3724,7 @@ void D_Init_ClientServer (void)
 //    debug_Printf( "viewangleoffset=%i\n", viewangleoffset );
 
     COM_AddCommand("playerinfo",Command_PlayerInfo, CC_info);
+    COM_AddCommand("filetx", Command_Filetx_f, CC_info);
     COM_AddCommand("kick",Command_Kick, CC_net);
     COM_AddCommand("connect",Command_connect, CC_net);
 
@@ -3668,6 +3735,8 @@ void D_Init_ClientServer (void)
     CV_RegisterVar (&cv_allownewplayer);
     CV_RegisterVar (&cv_maxplayers);
 
+    D_Alloc_BackupTics();
+
     gametic = 0;
 #ifdef CLIENTPREDICTION2
     localgametic = 0;
@@ -3690,6 +3759,16 @@ static void SV_Reset_NetNode(byte nnode)
     nextsend_tic[nnode]=gametic;
     join_waiting[nnode]=0;
     playerpernode[nnode]=0;
+    tic_delta_node[nnode]=0;
+}
+
+// Server: The tics that the client at the net node is behind maketic.
+// Return -1 when the net node is not a client.
+int  SV_Node_TicLag( byte nnode )
+{
+    if( !server || nnode >= MAXNETNODES || nnode_state[nnode] < NOS_client )
+        return -1;
+    return maketic - nettics[nnode];
 }
 
 // Called by D_Init_ClientServer, SV_SpawnServer, CL_Reset, D_WaitPlayer_Response
@@ -3935,7 +4014,7 @@ static void  update_player_counts( void )
             num_game_players++;
             if( ps >= PS_player && ps < PS_bot )
             {
-                ticcmd_player_mask |= 1<<pn;  // players that send ticcmds
+                ticcmd_player_mask |= PLAYER_BIT(pn);  // players that send ticcmds
                 ticcmd_pid[num_ticcmd_per_tic++] = pn;  // list of pid
             }
         }
@@ -3945,7 +4024,7 @@ static void  update_player_counts( void )
 // Client
 //    pmask : player_mask
 // The number of bits set in the player_mask.
-static void CL_num_ticcmd_per( uint32_t pmask )
+static void CL_num_ticcmd_per( player_mask_t pmask )
 {
     byte pn = 0;
     num_ticcmd_per_tic = 0;
@@ -3967,24 +4046,25 @@ static void CL_num_ticcmd_per( uint32_t pmask )
 //   Only use the player mask for message content, not the way to update players.
 // Client
 static
-void  CL_player_mask_error_detection( uint32_t playerdet )
+void  CL_player_mask_error_detection( player_mask_t playerdet )
 {
     int pn;
 
     if( playerdet == ticcmd_player_mask )  return;  // quick check
 
     // When joining game, this is normal, as client has not been given all the players yet.
-    GenPrintf(EMSG_warn, "Player mask error: server= %4X client= %4X\n", playerdet, ticcmd_player_mask );
+    GenPrintf(EMSG_warn, "Player mask error: server= %4llX client= %4llX\n",
+              (unsigned long long)playerdet, (unsigned long long)ticcmd_player_mask );
 
     // Client only uses ticcmd_player_mask for this check.
     // Player_mask should match playeringame.
     // Does not affect players or bot set by client.
     for(pn=0; pn<MAXPLAYERS; pn++)
     {
-        uint32_t pnb = 1<<pn;
+        player_mask_t pnb = PLAYER_BIT(pn);
         if( (playerdet & pnb) != (ticcmd_player_mask & pnb) )
         {
-            GenPrintf(EMSG_warn, "  Player %d: server= %4X client= %4X\n", pn, playerdet & pnb, ticcmd_player_mask & pnb  );
+            GenPrintf(EMSG_warn, "  Player %d: server= %d client= %d\n", pn, (playerdet & pnb) != 0, (ticcmd_player_mask & pnb) != 0 );
         }
     }
 
@@ -4372,7 +4452,7 @@ void SV_StopServer( void )
     localtextcmd[0].len = 0;  // text len
     localtextcmd[1].len = 0; // text len
 
-    for(i=0; i<BACKUPTICS; i++)
+    for(i=0; i<backup_tics; i++)
         D_Clear_ticcmd(i);
 
     consoleplayer=0;
@@ -4461,6 +4541,13 @@ static void client_join_handler( byte nnode )
         return;
     }
 
+    // Older clients only take the whole ticcmd.
+    tic_delta_node[nnode] = ( join_flags & NF_tic_delta ) != 0;
+
+    // How the savegame can be sent.
+    SV_Filetx_Caps( nnode, ((join_flags & NF_filetx_window)? FTC_window : 0)
+                           | ((join_flags & NF_filetx_zlib)? FTC_zlib : 0) );
+
     // To determine the intial command to send with the config.
     command = CTRL_normal;
     // If there is an existing player at the node, then will not be newnode.
@@ -4660,6 +4747,7 @@ static void server_cfg_handler( byte nnode )
         player_to_nnode[serverplayer] = cl_servernode;
 
     cl_nnode = netbuffer->u.servercfg.clientnode;  // assigned by server
+    cl_tic_delta = ( netbuffer->u.servercfg.cfg_flags & SCF_tic_delta ) != 0;
 
     GenPrintf(EMSG_hud, "Join accepted, wait next map change ...\n");
     DEBFILE(va("Server accept join gametic=%d, client net node=%d\n",
@@ -4671,15 +4759,15 @@ static void server_cfg_handler( byte nnode )
         // Client
 #if 1
 #ifdef PARANOIA   
-        uint32_t  playerdet = read_N32( & netbuffer->u.servercfg.playerdetected );
+        player_mask_t  playerdet = read_NPM( & netbuffer->u.servercfg.playerdetected );
         CL_player_mask_error_detection( playerdet );
 #endif
 #else
         // This was for servertic cmds, no longer need to do this.
-        uint32_t  playerdet = read_N32( & netbuffer->u.servercfg.playerdetected );
+        player_mask_t  playerdet = read_NPM( & netbuffer->u.servercfg.playerdetected );
         for(j=0;j<MAXPLAYERS;j++)
         {
-            playeringame[j] = (( playerdet & (1<<j) ) != 0);
+            playeringame[j] = (( playerdet & PLAYER_BIT(j) ) != 0);
             player_state[j] = (playeringame[j])? PS_player_from_server : 0;
         }
 #endif
@@ -4934,7 +5022,7 @@ static void client_cmd_handler( byte netcmd, byte nnode )
 
     // Check consistency
     if((start_tic <= gametic)
-       && (start_tic > (gametic - BACKUPTICS + 1)) )
+       && (start_tic > (gametic - backup_tics + 1)) )
     {
         // within previous tics
         btic = BTIC_INDEX(start_tic);
@@ -4969,23 +5057,194 @@ static void client_cmd_handler( byte netcmd, byte nnode )
 // packets when needed.
 // All of the textcmd will be included.
 
+// [WDJ] TPF_delta ticcmd encoding, see tic_delta_field_e.
+
+// Write the zigzag varint of a 16 bit difference, 1 to 3 bytes.
+static byte *  write_delta16( byte * bp, uint16_t val, uint16_t ref )
+{
+    int16_t  d = val - ref;
+    uint16_t z = ((uint16_t)d << 1) ^ (uint16_t)(d >> 15);
+    while( z >= 0x80 )
+    {
+        *bp++ = (z & 0x7F) | 0x80;
+        z >>= 7;
+    }
+    *bp++ = z;
+    return bp;
+}
+
+// Read the zigzag varint of a 16 bit difference, and apply it to ref.
+// Return NULL when past the end.
+static byte *  read_delta16( byte * bp, byte * endp, /*INOUT*/ uint16_t * val )
+{
+    uint16_t z = 0;
+    int  shift = 0;
+    byte b;
+    do
+    {
+        if( bp >= endp || shift > 14 )  return NULL;
+        b = *bp++;
+        z |= (b & 0x7F) << shift;
+        shift += 7;
+    } while( b & 0x80 );
+    *val += (z >> 1) ^ (uint16_t)(-(z & 1));
+    return bp;
+}
+
+static const ticcmd_t  idle_ticcmd;  // all zero
+
+// By Server.
+// Delta encode the ticcmd of the players, against the previous tic,
+// or against the idle ticcmd when prev_cmds is NULL.
+// Players that are unchanged are not sent.
+// Return the bytes written to buf.
+static int  ticcmd_delta_encode( byte * buf, ticcmd_t * cmds, ticcmd_t * prev_cmds )
+{
+    byte * bp = buf;
+    byte * player_bits = buf;
+    int  nbits = (num_ticcmd_per_tic + 7) >> 3;
+    int  j;
+
+    memset( player_bits, 0, nbits );
+    bp += nbits;
+
+    // Use list of pid generated from playeringame and player_state.
+    for( j=0; j<num_ticcmd_per_tic; j++ )
+    {
+        byte pn = ticcmd_pid[j];
+        ticcmd_t * cp = &cmds[pn];
+        const ticcmd_t * rp = (prev_cmds)? &prev_cmds[pn] : &idle_ticcmd;
+        byte fields = 0;
+
+        if( cp->forwardmove != rp->forwardmove )  fields |= TDF_forwardmove;
+        if( cp->sidemove != rp->sidemove )  fields |= TDF_sidemove;
+        if( cp->angleturn != rp->angleturn )  fields |= TDF_angleturn;
+        if( cp->aiming != rp->aiming )  fields |= TDF_aiming;
+        if( cp->buttons != rp->buttons )  fields |= TDF_buttons;
+#ifdef TICCMD_148
+        if( cp->ticflags != rp->ticflags )  fields |= TDF_ticflags;
+#endif
+#ifdef CLIENTPREDICTION2
+        if( cp->x != rp->x || cp->y != rp->y )  fields |= TDF_xy;
+#endif
+        if( fields == 0 )  continue;  // idle, or same as previous tic
+
+        player_bits[j>>3] |= 1 << (j & 7);
+        *bp++ = fields;
+        if( fields & TDF_forwardmove )  *bp++ = cp->forwardmove;
+        if( fields & TDF_sidemove )  *bp++ = cp->sidemove;
+        if( fields & TDF_angleturn )
+            bp = write_delta16( bp, cp->angleturn, rp->angleturn );
+        if( fields & TDF_aiming )
+            bp = write_delta16( bp, cp->aiming, rp->aiming );
+        if( fields & TDF_buttons )  *bp++ = cp->buttons;
+#ifdef TICCMD_148
+        if( fields & TDF_ticflags )  *bp++ = cp->ticflags;
+#endif
+#ifdef CLIENTPREDICTION2
+        if( fields & TDF_xy )
+        {
+            write_N32( (N32_t*)bp, cp->x );
+            write_N32( (N32_t*)(bp+4), cp->y );
+            bp += 8;
+        }
+#endif
+    }
+    return bp - buf;
+}
+
+// Max bytes of one tic, ticcmd_delta_encode.
+#define TICCMD_DELTA_MAX  (((MAXPLAYERS+7)>>3) + (MAXPLAYERS*(sizeof(ticcmd_t)+5)))
+
+// By Client.
+// Decode the delta encoded ticcmd of the players into cmds,
+// against prev_cmds, or the idle ticcmd when prev_cmds is NULL.
+// Return the position after the tic, or NULL when corrupt.
+static byte *  ticcmd_delta_decode( byte * bp, byte * endp, ticcmd_t * cmds, ticcmd_t * prev_cmds )
+{
+    byte * player_bits = bp;
+    int  nbits = (num_ticcmd_per_tic + 7) >> 3;
+    int  j;
+
+    bp += nbits;
+    if( bp > endp )  return NULL;
+
+    for( j=0; j<num_ticcmd_per_tic; j++ )
+    {
+        // Use list of pid generated from cmd_player_mask.
+        byte pn = ticcmd_pid[j];
+        ticcmd_t * cp = &cmds[pn];
+        byte fields;
+
+        *cp = (prev_cmds)? prev_cmds[pn] : idle_ticcmd;
+        if( ! (player_bits[j>>3] & (1 << (j & 7))) )  continue;  // unchanged
+
+        if( bp >= endp )  return NULL;
+        fields = *bp++;
+        if( fields & TDF_forwardmove )
+        {
+            if( bp >= endp )  return NULL;
+            cp->forwardmove = *bp++;
+        }
+        if( fields & TDF_sidemove )
+        {
+            if( bp >= endp )  return NULL;
+            cp->sidemove = *bp++;
+        }
+        if( fields & TDF_angleturn )
+        {
+            bp = read_delta16( bp, endp, (uint16_t*) &cp->angleturn );
+            if( ! bp )  return NULL;
+        }
+        if( fields & TDF_aiming )
+        {
+            bp = read_delta16( bp, endp, (uint16_t*) &cp->aiming );
+            if( ! bp )  return NULL;
+        }
+        if( fields & TDF_buttons )
+        {
+            if( bp >= endp )  return NULL;
+            cp->buttons = *bp++;
+        }
+#ifdef TICCMD_148
+        if( fields & TDF_ticflags )
+        {
+            if( bp >= endp )  return NULL;
+            cp->ticflags = *bp++;
+        }
+#endif
+#ifdef CLIENTPREDICTION2
+        if( fields & TDF_xy )
+        {
+            if( bp + 8 > endp )  return NULL;
+            cp->x = read_N32( (N32_t*)bp );
+            cp->y = read_N32( (N32_t*)(bp+4) );
+            bp += 8;
+        }
+#endif
+    }
+    return bp;
+}
+
 // By Server.
 // Send PT_SERVERTICS, the server packet.
 // Send tic from next_tic_send to maketic-1.
 static void SV_Send_Tics (void)
 {
     static byte resend_cnt = 0;  // spread resends at less cost than Get_Time
+    static byte delta_buf[TICCMD_DELTA_MAX];
 
-    ticcmd_t * netcmd_p;
+    ticcmd_t * netcmd_p, * prev_cmd_p;
     byte * bufpos;  // net txtcmd text
     byte * endbuf, * end_ticcmd;
 
     tic_t start_tic, end_tic, ti;
     int  btic, j;
-    int  packsize;
+    int  packsize, len;
     int  total_textcmd_size;
     byte seq_num, num_cmds, num_txt, flags;
     byte nnode, pn;
+    byte tic_delta;
 
     // update_player_counts sets ticcmd_player_mask, num_ticcmd_per_tic, ticcmd_pid[].
 
@@ -5032,13 +5291,21 @@ static void SV_Send_Tics (void)
         if( start_tic < next_tic_send )
             start_tic = next_tic_send;
 
+        tic_delta = tic_delta_node[nnode];
+
         // Compute the length of the packet and cut it if too large.
         packsize = SERVER_TIC_BASE_SIZE;
         total_textcmd_size = 0;
         for(ti=start_tic; ti<end_tic; ti++)
         {
             // All of the ticcmd
-            packsize += sizeof(ticcmd_t) * num_ticcmd_per_tic;
+            if( tic_delta )
+            {
+                packsize += ticcmd_delta_encode( delta_buf, netcmds[ BTIC_INDEX( ti ) ],
+                               (ti == start_tic)? NULL : netcmds[ BTIC_INDEX( ti - 1 ) ] );
+            }
+            else
+                packsize += sizeof(ticcmd_t) * num_ticcmd_per_tic;
             // All of the textcmd buffer and support fields
             // Optional textcmd support fields, are only needed when there are textcmd.
             int tcblen = textcmdbuff[ BTIC_INDEX(ti) ].len;
@@ -5073,7 +5340,7 @@ static void SV_Send_Tics (void)
         netbuffer->packettype = PT_SERVERTICS;
         netbuffer->u.serverpak.starttic = start_tic;
         netbuffer->u.serverpak.numtics = (end_tic - start_tic); // num tics
-        write_N32( &netbuffer->u.serverpak.cmd_player_mask, ticcmd_player_mask );  // players that send ticcmd
+        write_NPM( &netbuffer->u.serverpak.cmd_player_mask, ticcmd_player_mask );  // players that send ticcmd
 
         // init
         netbuffer->u.serverpak.cmds_offset = 0;
@@ -5087,8 +5354,44 @@ static void SV_Send_Tics (void)
         if( end_ticcmd > (byte*)& netbuffer->u.serverpak.cmds[NUM_SERVERTIC_CMD-1] )
             end_ticcmd = (byte*)& netbuffer->u.serverpak.cmds[NUM_SERVERTIC_CMD-1];
 
+        stat_tic_fullbytes += (end_tic - start_tic) * num_ticcmd_per_tic * sizeof(ticcmd_t);
+
+        // Delta encoded, whole tics.
+        // Each packet section starts again from the idle ticcmd, so a lost
+        // packet section does not affect the others.
+        prev_cmd_p = NULL;
+        for(ti=start_tic; tic_delta && ti<end_tic; ti++)
+        {
+            netcmd_p = netcmds[ BTIC_INDEX( ti ) ];
+            len = ticcmd_delta_encode( delta_buf, netcmd_p, prev_cmd_p );
+            if( (bufpos + len > endbuf) && num_cmds )
+            {
+                // send packet section
+                netbuffer->u.serverpak.flags = TPF_more | TPF_delta | seq_num;
+                netbuffer->u.serverpak.num_cmds_present = num_cmds;
+                packsize = bufpos - (byte*)&(netbuffer->u);
+                HSendPacket(nnode, 0, 0, packsize);  // msg lost when too busy
+
+                // init next seq packet, num_cmds and cmds_offset are tics
+                netbuffer->u.serverpak.cmds_offset += num_cmds;
+                num_cmds = 0;
+                seq_num ++;
+                bufpos = (byte*)&netbuffer->u.serverpak.cmds;
+                len = ticcmd_delta_encode( delta_buf, netcmd_p, NULL );
+            }
+            memcpy( bufpos, delta_buf, len );
+            bufpos += len;
+            stat_tic_bytes += len;
+            num_cmds++;  // tic count
+            prev_cmd_p = netcmd_p;
+        }
+        if( tic_delta )
+            flags = TPF_delta;
+        else
+            stat_tic_bytes += (end_tic - start_tic) * num_ticcmd_per_tic * sizeof(ticcmd_t);
+
         // All the ticcmd_t, start_tic..(end_tic-1)
-        for(ti=start_tic; ti<end_tic; ti++)
+        for(ti=start_tic; !tic_delta && ti<end_tic; ti++)
         {
             btic = BTIC_INDEX( ti );
             netcmd_p = netcmds[btic];
@@ -5201,7 +5504,7 @@ static void servertic_handler( byte nnode )
     textcmdbuff_t * tcbuf;
     int    btic, j;
     uint16_t buflen;
-    uint32_t cmd_player_mask;
+    player_mask_t cmd_player_mask;
     tic_t  start_tic, end_tic, ti;
     byte   start_tic_hash;
     byte   packetflags;
@@ -5211,8 +5514,8 @@ static void servertic_handler( byte nnode )
     start_tic = ExpandTics (netbuffer->u.serverpak.starttic);
     end_tic   = start_tic + netbuffer->u.serverpak.numtics;
 
-    if( end_tic > (gametic + BACKUPTICS))
-        end_tic = (gametic + BACKUPTICS);  // limit to backup capability
+    if( end_tic > (gametic + backup_tics))
+        end_tic = (gametic + backup_tics);  // limit to backup capability
 
     // Check if missed any packets.
     cl_packetmissed = (start_tic > cl_need_tic);
@@ -5230,10 +5533,17 @@ static void servertic_handler( byte nnode )
     bufpos = (byte*)netbuffer->u.serverpak.cmds;  // first ticcmd
     endbuffer = (byte*)& netbuffer->u.serverpak.cmds[NUM_SERVERTIC_CMD];  // after last content
 
-    cmd_player_mask = read_N32( &netbuffer->u.serverpak.cmd_player_mask );
+    cmd_player_mask = read_NPM( &netbuffer->u.serverpak.cmd_player_mask );
     cmds_offset = netbuffer->u.serverpak.cmds_offset;
     num_cmds = netbuffer->u.serverpak.num_cmds_present;
-    if( num_cmds > NUM_SERVERTIC_CMD )  goto corrupt_packet;
+    if( packetflags & TPF_delta )
+    {
+        // num_cmds and cmds_offset are tics
+        if( ! cl_tic_delta )  goto corrupt_packet;
+        if( (cmds_offset + num_cmds) > netbuffer->u.serverpak.numtics )  goto corrupt_packet;
+        endbuffer = (byte*)netbuffer + doomcom->datalength;
+    }
+    else if( num_cmds > NUM_SERVERTIC_CMD )  goto corrupt_packet;
 
     // Hash differs between this packet and previous usage of the same btic.
     // Could compute it for every tic in the packet, but is not necessary.
@@ -5259,7 +5569,38 @@ static void servertic_handler( byte nnode )
 
     // Nettics
     // Some extension packets may have num_cmds = 0
-    if( num_cmds && cmd_player_mask )
+    if( (packetflags & TPF_delta) && num_cmds && cmd_player_mask )
+    {
+        // client only
+        // Whole tics, each against the previous tic of this packet.
+        ticcmd_t  tic_cmds[2][MAXPLAYERS];
+        ticcmd_t * prev_cmds = NULL;
+        byte  cur = 0;
+
+        if( cmd_player_mask != ticcmd_player_mask )
+            CL_num_ticcmd_per( cmd_player_mask );  // num_ticcmd_per_tic
+
+        for( ti = start_tic + cmds_offset; num_cmds; ti++, num_cmds-- )
+        {
+            // All tics are decoded to find the textcmd.
+            bufpos = ticcmd_delta_decode( bufpos, endbuffer, tic_cmds[cur], prev_cmds );
+            if( ! bufpos )  goto corrupt_packet;
+
+            if( ti < end_tic )
+            {
+                // Copy the tics
+                netcmd_p = netcmds[ BTIC_INDEX( ti ) ];
+                for( j = 0; j<num_ticcmd_per_tic; j++ )
+                {
+                    byte pn = ticcmd_pid[j];
+                    netcmd_p[pn] = tic_cmds[cur][pn];
+                }
+            }
+            prev_cmds = tic_cmds[cur];
+            cur ^= 1;
+        }
+    }
+    else if( num_cmds && cmd_player_mask )
     {
         // client only
         // Update the player list according to cmd_player_mask
@@ -5283,7 +5624,7 @@ static void servertic_handler( byte nnode )
 
             // Copy the tics
             btic = BTIC_INDEX( ti );
-            // btic limited to BACKUPTICS-1
+            // btic limited to backup_tics-1
 
             netcmd_p = netcmds[btic];  // player dest
 
@@ -5411,6 +5752,10 @@ static void Net_Packet_Handler(void)
                 if( !server )
                     Got_Filetxpak();
                 continue;
+             case PT_FILEWINDOW :
+                if( !server )
+                    Got_Filetx_Window();
+                continue;
              case PT_NETWAIT:
                 if( !server )
                     netwait_handler();
@@ -5497,6 +5842,9 @@ static void Net_Packet_Handler(void)
                 }
                 Got_RequestFilePak(nnode);
                 continue;
+             case PT_FILEACK :
+                Got_Filetx_Ack(nnode);
+                continue;
              case PT_CLIENTJOIN:
                 client_join_handler( nnode );
                 continue;
@@ -5543,6 +5891,10 @@ static void Net_Packet_Handler(void)
                 if( !server )
                     Got_Filetxpak();
                 continue;
+             case PT_FILEWINDOW :
+                if( !server )
+                    Got_Filetx_Window();
+                continue;
              case PT_SERVERTICS:
                 // do not remove my own server
                 // (we have just to get a out of order packet)
@@ -5638,7 +5990,7 @@ static void Local_Maketic(int realtics)
       G_BuildTiccmd(&localcmds[1], realtics, 1);
 
 #ifdef CLIENTPREDICTION2
-    if( !paused && localgametic<gametic+BACKUPTICS)
+    if( !paused && localgametic<gametic+backup_tics)
     {
         P_MoveSpirit ( &players[consoleplayer], &localcmds[0], realtics );
         localgametic+=realtics;
@@ -5838,8 +6190,15 @@ void TryRunTics (tic_t realtics)
                 D_Clear_ticcmd( gametic );
             }
 
+            uint64_t  stress_ns = ( stressbots_active )? M_Time_ns() : 0;
             G_Ticker ();
             ExtraDataTicker();  // execute NetXCmd
+            if( stressbots_active )
+                B_StressBots_Tic( stress_ns );  // -stressbots
+#ifdef THING_GRID
+            if( thinggrid_bench_active )
+                G_ThingGridBench();  // -thinggrid_bench
+#endif
             gametic++;
             // skip paused tic in a demo
             if(demoplayback)
@@ -5880,8 +6239,8 @@ static void SV_Send_Tic_Update( int count )
     }
 
     // Don't erase tics not acknowledged
-    if( (maketic+count) >= (next_tic_send+BACKUPTICS) )
-        count = (next_tic_send+BACKUPTICS) - maketic - 1;
+    if( (maketic+count) >= (next_tic_send+backup_tics) )
+        count = (next_tic_send+backup_tics) - maketic - 1;
 
     while( count-- > 0 )
         SV_Maketic();  // create missed tics and increment maketic
@@ -5890,7 +6249,10 @@ static void SV_Send_Tic_Update( int count )
     for( ; next_tic_clear<next_tic_send; next_tic_clear++)
         D_Clear_ticcmd(next_tic_clear);  // clear the maketic the new tic
 
+    // The servertic packets to all clients are sent together.
+    Net_Send_Batch( true );
     SV_Send_Tics();
+    Net_Send_Batch( false );
 
     // The server is a client too, but does not send cmdtic packets to itself.
     cl_need_tic=maketic;
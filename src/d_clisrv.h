@@ -85,7 +85,29 @@
 //
 
 // Networking and tick handling related.
+// The tics kept for the net, default for -backuptics.
+// More backup tics lets a client fall further behind on a slow link,
+// before it stalls.  A build profile can set another default.
+#ifndef BACKUPTICS
+#ifdef LARGE_LOBBY
+#define BACKUPTICS            64
+#else
 #define BACKUPTICS            32
+#endif
+#endif
+#define BACKUPTICS_MIN        16
+// ExpandTics cannot place a tic more than 64 ahead of maketic.
+#define BACKUPTICS_MAX        64
+#if ( BACKUPTICS < BACKUPTICS_MIN ) || ( BACKUPTICS > BACKUPTICS_MAX )
+# error BACKUPTICS must be BACKUPTICS_MIN..BACKUPTICS_MAX
+#endif
+
+extern int  backup_tics;  // BACKUPTICS_MIN..BACKUPTICS_MAX
+// Memory used by the backup tic tables, in bytes.
+size_t  D_BackupTics_Mem( void );
+
+// Index for netcmds and textcmds
+#define BTIC_INDEX( tic )  ((tic)%backup_tics)
 
 //
 // Packet structure
@@ -136,6 +158,8 @@ typedef enum   {
     PT_REQ_SERVERLEVEL,  // request level info from server
     PT_SERVERLEVEL,   // level info from server
     PT_REQ_CLIENTCFG, // request client config (via NetXCmd)
+    PT_FILEACK,       // selective ack of file fragments
+    PT_FILEWINDOW,    // a part of a file, window mode
  // count for table
     NUMPACKETTYPE
 } packettype_t;
@@ -171,6 +195,19 @@ typedef struct {
     byte  b[4];
 } N32_t;
 
+// Player mask, one bit for each player.
+#if MAXPLAYERS > 32
+typedef uint64_t  player_mask_t;
+#else
+typedef uint32_t  player_mask_t;
+#endif
+#define PLAYER_BIT( pn )   (((player_mask_t)1) << (pn))
+
+// Net player mask, LSB first, MAXPLAYERS bits.
+typedef struct {
+    byte  b[ (MAXPLAYERS > 32)? 8 : 4 ];
+} NPM_t;
+
 //#pragma pack(1)
 
 
@@ -236,8 +273,30 @@ typedef struct {
 typedef enum {
    TPF_seq = 0x07, // sequence number
    TPF_more = 0x08,  // not the last packet
+   TPF_delta = 0x10, // ticcmd are delta encoded, by whole tics
 } tic_packet_flag_e;
 
+// TPF_delta ticcmd encoding, ver 1.48.
+// Only to clients that join with NF_tic_delta.
+// For a TPF_delta packet, cmds_offset is the tics before this packet
+// section, and num_cmds_present is the tics in this packet section.
+// Each tic is delta encoded against the previous tic in the packet section,
+// the first tic against an idle (all zero) ticcmd.
+//   byte  player_bits[(num_ticcmd_per_tic+7)/8];  // changed players
+//   For each changed player:
+//     byte  fields;  // tic_delta_field_e
+//     the changed fields, in tic_delta_field_e order,
+//     angleturn and aiming as a zigzag varint of the difference.
+typedef enum {
+   TDF_forwardmove = 0x01,
+   TDF_sidemove    = 0x02,
+   TDF_angleturn   = 0x04,
+   TDF_aiming      = 0x08,
+   TDF_buttons     = 0x10,
+   TDF_ticflags    = 0x20,
+   TDF_xy          = 0x40,  // CLIENTPREDICTION2, 8 bytes
+} tic_delta_field_e;
+
 // Server to client packet
 // [WDJ] Ver 1.48, servertic can be sent using multiple packets.
 // Will adapt to MAXPACKETSIZE.
@@ -245,7 +304,7 @@ typedef enum {
 typedef struct {
    byte        starttic; // low byte of gametic
    byte        numtics;  // 1..
-   N32_t       cmd_player_mask;  // bit for each player with ticcmd
+   NPM_t       cmd_player_mask;  // bit for each player with ticcmd
    byte        flags;    // tic_packet_flag_e
    byte        cmds_offset;  // extension packet offset
    byte        num_cmds_present;  // in this packet, to locate textcmd
@@ -402,7 +461,8 @@ typedef struct {
 // aligned to 4 bytes
 typedef struct {
    byte        version;    // exe from differant version don't work
-   byte        ver1, ver2, ver3;  // reserve for future version
+   byte        cfg_flags;  // SCF_, was reserved
+   byte        ver2, ver3;  // reserve for future version
 // align to 4 bytes
    uint32_t    subversion; // contain build version and maybe crc
 
@@ -413,11 +473,16 @@ typedef struct {
    byte        clientnode;
    byte        gamestate;
    byte        command;   // CTRL_ command
-   N32_t       playerdetected; // playeringame vector in bit field
+   NPM_t       playerdetected; // playeringame vector in bit field
 // unaligned
    byte        netvar_buf[NETVAR_BUFF_LEN];
 } serverconfig_pak_t;
 
+// serverconfig_pak_t cfg_flags
+typedef enum {
+   SCF_tic_delta = 0x01,  // servertics will be TPF_delta
+} server_cfg_flags_e;
+
 // PT_CLIENTJOIN
 // aligned to 4 bytes
 typedef struct {
@@ -442,6 +507,29 @@ typedef struct {
    byte        data[100];  // size is variable using hardare_MAXPACKETLENGTH
 } filetx_pak_t;
 
+// PT_FILEWINDOW
+// Same layout as filetx_pak_t, with a fragment seq for the selective ack.
+// aligned to 4 bytes
+typedef struct {
+   char        fileid;
+   byte        flags;   // FTF_
+   byte        seq_lo, seq_hi;  // fragment seq
+// align to 4 bytes
+   uint32_t    position;
+   uint16_t    size;
+// unaligned
+   byte        data[100];  // size is variable using hardare_MAXPACKETLENGTH
+} filetx_win_pak_t;
+
+// PT_FILEACK
+// Selective ack of the PT_FILEWINDOW file fragments, by the client.
+typedef struct {
+   char        fileid;
+   byte        pad1;
+   N16_t       seq_base;  // fragments before it have been received
+   byte        bits[8];   // bit n for fragment seq_base+n received
+} filetx_ack_pak_t;
+
 // ver 1.48
 // PT_NETWAIT
 // aligned to 4 bytes
@@ -548,6 +636,8 @@ typedef struct
       serverconfig_pak_t servercfg;
       textcmd_pak_t      textcmdpak;
       filetx_pak_t       filetxpak;
+      filetx_win_pak_t   filetxwin;
+      filetx_ack_pak_t   filetxack;
       clientconfig_pak_t clientcfg;
       serverinfo_pak_t   serverinfo;
       string_pak_t       stringpak;
@@ -576,6 +666,7 @@ extern consvar_t cv_download_savegame;
 extern consvar_t cv_netrepair;
 extern consvar_t cv_SV_download_files;
 extern consvar_t cv_SV_download_savegame;
+extern consvar_t cv_SV_filetx_rate;
 extern consvar_t cv_SV_netrepair;
 extern consvar_t cv_wait_players;
 extern consvar_t cv_wait_timeout;
@@ -642,6 +733,8 @@ boolean SV_SpawnServer( void );
 void    SV_SpawnPlayer(byte playernum, int x, int y, angle_t angle);
 void    SV_StopServer( void );
 void    SV_ResetServer( void );
+// Return the tics the client is behind, or -1.
+int     SV_Node_TicLag( byte nnode );
 
 // [WDJ] Update state by sever.
 // By Server
@@ -224,6 +224,7 @@
 
 #include "g_game.h"
 #include "g_input.h"
+#include "g_tdreport.h"
 
 #include "hu_stuff.h"
 
@@ -241,6 +242,7 @@
 #include "p_info.h"
 #include "p_local.h"
 #include "p_extnodes.h"
+#include "p_synclog.h"
 
 #include "r_main.h"
 #include "r_local.h"
@@ -595,7 +597,9 @@ void  owner_wad_search_order( void )
         }
         else
         if( defdir
+#ifdef LAUNCHER
             &&( !(strcmp( defdir, cv_home.string ) == 0) ) // not home directory
+#endif
             &&( !(progdir && (strcmp( defdir, progdir ) == 0)) ) // not program directory
             &&( !(progdir_wads && (strcmp( defdir, progdir_wads ) == 0)) ) // not wads directory
           )
@@ -956,6 +960,12 @@ void D_Display(void)
             V_DrawString(BASEVIDWIDTH - V_StringWidth(s), BASEVIDHEIGHT - ST_HEIGHT - 20, V_WHITEMAP, s);
             sprintf(s, "SysMiss %.2f%%", netstat_lost_percent);
             V_DrawString(BASEVIDWIDTH - V_StringWidth(s), BASEVIDHEIGHT - ST_HEIGHT - 10, V_WHITEMAP, s);
+            if( netstat_tic_fullbytes )
+            {
+                // Server, ticcmd bytes per tic, whole and as sent.
+                sprintf(s, "tics %d/%d b/t", netstat_tic_bytes, netstat_tic_fullbytes);
+                V_DrawString(BASEVIDWIDTH - V_StringWidth(s), BASEVIDHEIGHT - ST_HEIGHT - 50, V_WHITEMAP, s);
+            }
         }
 
 #ifdef TILTVIEW
@@ -980,7 +990,9 @@ void D_Display(void)
             // display a graph of ticrate 
             if (cv_ticrate.value )
                 V_Draw_ticrate_graph();
+            TDR_START( TDR_blit );
             I_FinishUpdate();   // page flip or blit buffer
+            TDR_END( TDR_blit );
             //debug_Printf("last frame update took %d\n", I_EndProfile());
         }
         return;
@@ -1117,9 +1129,13 @@ void D_DoomLoop(void)
             if( ! dedicated )
             {
                 //added:16-01-98:consoleplayer -> displayplayer (hear sounds from viewpoint)
+                TDR_START( TDR_sound );
                 S_UpdateSounds();   // move positional sounds
+                TDR_END( TDR_sound );
                 // Update display, next frame, with current state.
                 D_Display();
+                if( tdr_active )
+                    TDR_Frame_End();
             }
 #ifdef CLIENTPREDICTION2
             spirit_update = false;
@@ -2362,6 +2378,14 @@ void D_DoomMain()
       exit(0);
     }
 
+#ifdef ENABLE_DRAW_SIMD
+    if (M_CheckParm("-simdcheck"))
+    {
+      // Compare the SIMD drawers to the C drawers, on scratch buffers.
+      exit( R_SIMD_Check() );
+    }
+#endif
+
     GenPrintf( EMSG_info|EMSG_all, "%s\n", legacytitle);
 
     // Find or make a default dir that is not root dir
@@ -3440,6 +3464,13 @@ fatal_error_action:
     if (D_Startup_NetGame())
         autostart = true;
 
+    if (B_StressBots_Init())  // -stressbots
+        autostart = true;
+#ifdef THING_GRID
+    if (G_ThingGridBench_Init())  // -thinggrid_bench
+        autostart = true;
+#endif
+
     // check for a driver that wants intermission stats
     p = M_CheckParm("-statcopy");
     if (p && p < myargc - 1)
@@ -3495,6 +3526,7 @@ fatal_error_action:
         FIL_DefaultExtension(demo_name, ".lmp");
 
         CONS_Printf("Playing demo %s.\n", demo_name);
+        P_SyncLog_Init();  // -synclog, -synccheck
 
         if( p == 2500 )
         {  // timedemo
@@ -3788,6 +3820,9 @@ static void Help( void )
         "-nomusic        No music\n"
         "-precachesound  Preload sound effects\n"
         "-mb num         Pre-allocate num MiB of memory\n"
+#ifdef MMAP_WAD
+        "-mmapwad        Memory map wad files\n"
+#endif
         "-window         No fullscreen\n"
         "-width num      Video mode width\n"
         "-height num     Video mode height\n"
@@ -3795,6 +3830,13 @@ static void Help( void )
         "-truecolor      Request 24bpp or 32bpp\n"
         "-native         Video mode in native bpp\n"
         "-bpp num        Video mode in (8,15,16,24,32) bpp\n"
+#ifdef ENABLE_DRAW_SIMD
+        "-nosimd         Plain C drawers, no SIMD\n"
+        "-simdcheck      Compare SIMD drawers to C drawers, and exit\n"
+#endif
+#ifdef SMIF_NULL_VIDEO
+        "-dumpframes num [ppm]  Write every num frame as PNG or PPM\n"
+#endif
         "-nocheckwadversion   Ignore legacy.wad version\n"
 #ifdef BEX_LANGUAGE
         "-lang name      Load BEX language file name.bex\n"
@@ -3809,6 +3851,7 @@ static void Help( void )
         "-connect name   Connect to server name\n"
         "-bandwidth bps  Net bandwidth in bytes/sec\n"
         "-packetsize num Net packetsize\n"
+        "-backuptics num Net tics kept, 16..64\n"
         "-nodownload     No download from server\n"
         "-nofiles        Download all from server\n"
         "-clientport x   Use port x for client\n"
@@ -3817,6 +3860,7 @@ static void Help( void )
         "-ipx            Use IPX\n"
 #endif
         "-extratic x     Send redundant player movement\n"
+        "-netsim lat jit loss reord  Simulate net latency, jitter (ms), loss, reorder (%%)\n"
         "-debugfile file Log to debug file\n"
         "-left           Left slaved view\n"
         "-right          Right slaved view\n"
@@ -3843,6 +3887,12 @@ static void Help( void )
         "-timedemo file  Timedemo from file\n"
         "-nodraw         Timedemo without draw\n"
         "-noblit         Timedemo without blit\n"
+        "-timedemo_report file.csv  Timedemo time of each frame, to CSV file\n"
+        "-synclog file   Demo, write game state hash of each tic\n"
+        "-synccheck file  Demo, compare game state to -synclog file\n"
+        "-stressbots num tics  Add bots, time the tics, and quit\n"
+        "-thinggrid_bench num tics  Time a monster crowd, thing_grid 0 and 1, and quit\n"
+        "-levelload_timing  Print the time of each level load stage\n"
         );
      break;
   }
@@ -63,12 +63,15 @@
 #include "i_net.h"
 #include "i_system.h"
 #include "m_argv.h"
+#include "m_profile.h"
 #include "w_wad.h"
 #include "d_netfil.h"
 #include "d_clisrv.h"
 #include "i_tcp.h"
 #include "m_swap.h"
 #include "z_zone.h"
+#include "command.h"
+#include "console.h"
 
 //
 // NETWORKING
@@ -107,6 +110,7 @@ network_error_e  net_error;
 byte    (*I_NetGet) (void);
 byte    (*I_NetSend) (void);
 boolean (*I_NetCanSend) (void);
+void    (*I_NetSendBatch) (boolean hold);
 void    (*I_NetCloseSocket) (void);
 void    (*I_NetFreeNode) (byte nodenum);
 byte    (*I_NetMakeNode) (char *address);
@@ -148,11 +152,14 @@ int     stat_ackpacket_sent = 0;  // sent ack packets
 int     stat_ackpacket_recv = 0;  // received ack packets
 int     stat_tic_moved = 0;  // tics to move player
 int     stat_tic_miss = 0;   // tics moved that are missing TICCMD_RECEIVED
+int     stat_tic_fullbytes = 0;  // servertic ticcmd bytes, when not encoded
+int     stat_tic_bytes = 0;  // servertic ticcmd bytes sent
 
 // NetStat globals
 int    netstat_recv_bps, netstat_send_bps;
 float  netstat_lost_percent, netstat_dup_percent;  // packets
 float  netstat_gamelost_percent;  // tics lost
+int    netstat_tic_fullbytes, netstat_tic_bytes;  // servertic ticcmd bytes per tic
 
 // Return true when stats have been updated.
 boolean Net_GetNetStat(void)
@@ -176,12 +183,16 @@ boolean Net_GetNetStat(void)
         netstat_gamelost_percent = ( stat_tic_moved )?
          100.0*(float)stat_tic_miss/(float)stat_tic_moved
          : 0.0;
+        // Server, ticcmd bytes sent per game tic, before and after TPF_delta.
+        netstat_tic_fullbytes = stat_tic_fullbytes/(ct - stat_starttic);
+        netstat_tic_bytes = stat_tic_bytes/(ct - stat_starttic);
 
         prev_stat_sendbyte = stat_sendbytes;
         stat_getbytes=0;
         stat_ackpacket_sent = stat_ackpacket_recv = 0;
         stat_duppacket = stat_retransmits = 0;
         stat_tic_miss = stat_tic_moved = 0;
+        stat_tic_fullbytes = stat_tic_bytes = 0;
         stat_starttic = ct;
 
         return 1;
@@ -227,8 +238,13 @@ boolean Net_GetNetStat(void)
 # error Required: BROADCAST_NODE < MAX_CON_NETNODE
 #endif
 
-// Max ack packets that can be saved.  Must exceed the max number of net nodes.
+// Min ack packets that can be saved.  Must exceed the max number of net nodes.
+// More are allocated for more backup_tics, as more wait for ack on a slow link.
+#if MAXNETNODES > 32
+#define MAXACKPACKETS    (MAXNETNODES*2)
+#else
 #define MAXACKPACKETS    64
+#endif
 #if ( MAXACKPACKETS <= MAXNETNODES )
 # error Required: MAXACKPACKETS > MAXNETNODES
 #endif
@@ -264,7 +280,9 @@ typedef enum {
 
 // Table of packets that are waiting for ACK, or to be sent again.
 // Can be resent (the sender window).
-static ackpak_t ackpak[MAXACKPACKETS];
+// Allocated by InitAck.
+static ackpak_t * ackpak = NULL;
+static int  num_ackpak = 0;
 
 // Node history and ack status.
 typedef struct {
@@ -294,10 +312,15 @@ typedef struct {
     fixed_t ping;
     fixed_t varping;
     int     timeout;   // computed with ping and varping
+    // Stats, for netnodestats.
+    uint32_t  stat_sendbytes, stat_getbytes;
+    uint32_t  stat_resends;
+    byte      stat_acktosend_max;  // most acktosend queued
 } netnode_t;
 
 // Ack structure for player net nodes.
-static netnode_t net_nodes[MAXNETNODES];
+// Allocated by InitAck.
+static netnode_t * net_nodes = NULL;
 
 // #define  NET_NODE_NUM( nnode )   ( nnode - net_nodes )
 
@@ -340,7 +363,7 @@ static byte Save_packet_acknum( boolean lowtimer )
    if(cmpack((byte)(np->remote_prev_ack+MAXACKTOSEND), np->next_ackreq_num) < 0)
        goto  too_fast;  // outstanding ack approaching limit of queue
 
-   for( ackpakp = &ackpak[0]; ackpakp < &ackpak[MAXACKPACKETS]; ackpakp++ )
+   for( ackpakp = &ackpak[0]; ackpakp < &ackpak[num_ackpak]; ackpakp++ )
    {
        // Visit unused ackpak.
        if(ackpakp->acknum==0)
@@ -475,7 +498,7 @@ static boolean Process_packet_ack()
         // Received an ack_return, remove the ack from the ackpak.
         np->remote_prev_ack = netbuffer->ack_return;
         // Search the ackbuffer for net node and free it.
-        for( ackpakp = &ackpak[0]; ackpakp < &ackpak[MAXACKPACKETS]; ackpakp++ )
+        for( ackpakp = &ackpak[0]; ackpakp < &ackpak[num_ackpak]; ackpakp++ )
         {
             // Remove all ackpak waiting for acknum that are <= ack_return.
             if( ackpakp->acknum
@@ -587,6 +610,10 @@ static boolean Process_packet_ack()
 
             np->acktosend[np->acktosend_head] = acknum;
             np->acktosend_head = newhead;
+
+            ati = (newhead + MAXACKTOSEND - np->acktosend_tail) % MAXACKTOSEND;
+            if( ati > np->stat_acktosend_max )
+                np->stat_acktosend_max = ati;
         }
     }
     return true;
@@ -649,7 +676,7 @@ static void Got_AcksPacket(void)
 
         // Find recv_acknum in our ack packets queue.
         // Without regards to queue head or tail.
-        for( ackpakp = &ackpak[0]; ackpakp < &ackpak[MAXACKPACKETS]; ackpakp++ )
+        for( ackpakp = &ackpak[0]; ackpakp < &ackpak[num_ackpak]; ackpakp++ )
         {
             if( ackpakp->acknum
                 && ackpakp->destination_node == rnode)
@@ -698,6 +725,14 @@ void Net_ConnectionTimeout( byte nnode )
     net_nodes[nnode].lasttime_packet_received = I_GetTime();
 }
 
+// Packets sent between Net_Send_Batch(true) and Net_Send_Batch(false)
+// are sent together, when the network driver can do that.
+void Net_Send_Batch( boolean hold )
+{
+    if( I_NetSendBatch )
+        I_NetSendBatch( hold );
+}
+
 // Resend some packets, if needed.
 void Net_AckTicker(void)
 {
@@ -708,8 +743,10 @@ void Net_AckTicker(void)
     ackpak_t * ackpakp;
     netnode_t * np;
 
+    Net_Send_Batch( true );
+
     // Check all ackpak for old packets.
-    for( ackpakp = &ackpak[0]; ackpakp < &ackpak[MAXACKPACKETS]; ackpakp++ )
+    for( ackpakp = &ackpak[0]; ackpakp < &ackpak[num_ackpak]; ackpakp++ )
     {
         if(ackpakp->acknum == 0)  continue;  // 0=inactive
 
@@ -738,6 +775,7 @@ void Net_AckTicker(void)
         ackpakp->acknum_at_xmit = np->next_ackreq_num;
         HSendPacket( nn, 0, ackpakp->acknum, ackpakp->length - PACKET_BASE_SIZE );
         stat_retransmits++; // for stat
+        np->stat_resends++;
     }
 
     for( nn=1; nn<MAXNETNODES; nn++)
@@ -758,6 +796,8 @@ void Net_AckTicker(void)
             }
         }
     }
+
+    Net_Send_Batch( false );
 }
 
 
@@ -838,7 +878,7 @@ boolean Net_Test_AllAckReceived(void)
 {
    ackpak_t * ackpakp;
 
-   for( ackpakp = &ackpak[0]; ackpakp < &ackpak[MAXACKPACKETS]; ackpakp++ )
+   for( ackpakp = &ackpak[0]; ackpakp < &ackpak[num_ackpak]; ackpakp++ )
    {
       if(ackpakp->acknum)
           return false;
@@ -880,13 +920,31 @@ static void InitNode( int nnode )
     np->next_ackreq_num = 1;
     np->remote_prev_ack = 0;
     np->flags           = 0;
+    np->stat_sendbytes  = 0;
+    np->stat_getbytes   = 0;
+    np->stat_resends    = 0;
+    np->stat_acktosend_max = 0;
 }
 
 static void InitAck()
 {
    int i;
 
-   for(i=0;i<MAXACKPACKETS;i++)
+   if( ! ackpak )
+   {
+      num_ackpak = MAXACKPACKETS;
+      if( backup_tics > 32 )
+          num_ackpak = MAXACKPACKETS * backup_tics / 32;
+      ackpak = calloc( num_ackpak, sizeof(ackpak_t) );
+      net_nodes = calloc( MAXNETNODES, sizeof(netnode_t) );
+      if( ! ackpak || ! net_nodes )
+          I_Error( "Net: cannot allocate %d ack packets\n", num_ackpak );
+      GenPrintf(EMSG_ver, "Net: %d ack packets, %d net nodes, %d KB\n",
+                num_ackpak, MAXNETNODES,
+                (int)((num_ackpak * sizeof(ackpak_t) + MAXNETNODES * sizeof(netnode_t)) >> 10) );
+   }
+
+   for(i=0;i<num_ackpak;i++)
       ackpak[i].acknum=0;
 
    for(i=0;i<MAXNETNODES;i++)
@@ -899,7 +957,7 @@ void Net_AbortPacketType(byte packettype)
     ackpak_t * ackpakp;
 
     // Check the retransmit ackpak for these type packets.
-    for( ackpakp = &ackpak[0]; ackpakp < &ackpak[MAXACKPACKETS]; ackpakp++ )
+    for( ackpakp = &ackpak[0]; ackpakp < &ackpak[num_ackpak]; ackpakp++ )
     {
         if( ackpakp->acknum == 0 )  continue;
 #if 1
@@ -953,7 +1011,7 @@ void Net_CloseConnection(byte nnode, byte forceclose)
     }
 
     // Check if we have to wait for ack from this node.
-    for( ackpakp = &ackpak[0]; ackpakp < &ackpak[MAXACKPACKETS]; ackpakp++ )
+    for( ackpakp = &ackpak[0]; ackpakp < &ackpak[num_ackpak]; ackpakp++ )
     {
         if( ackpakp->acknum
             && ackpakp->destination_node == nnode )
@@ -1014,6 +1072,17 @@ uint32_t  DN_read_N32( N32_t * vf )
     return (((((((uint32_t)(vf->b[3]))<<8) | vf->b[2])<<8) | vf->b[1])<<8) | vf->b[0];
 }
 
+static inline
+unsigned long long  DN_read_NPM( NPM_t * vf )
+{
+    // LSB first
+    unsigned long long  val = 0;
+    int i;
+    for( i=sizeof(NPM_t)-1; i>=0; i-- )
+        val = (val<<8) | vf->b[i];
+    return val;
+}
+
 
 static void fprintfstring(byte *s,byte len)
 {
@@ -1080,6 +1149,8 @@ static const char *packettypename[NUMPACKETTYPE]={
     "REQ_SERVERLEVEL",
     "SERVERLEVEL",
     "REQ_CLIENTCFG",
+    "FILEACK",
+    "FILEWINDOW",
 };
 
 static const char * control_name[]={
@@ -1236,9 +1307,9 @@ static void DebugPrintpacket(char *header)
     byte num_cmd = netbuffer->u.serverpak.num_cmds_present;
     byte num_txt = netbuffer->u.serverpak.num_textcmd;
     byte * bp;
-    fprintf(debugfile, "    firsttic %8d num_tics %d cmd_player_mask %X flags %X cmds_offset %i num_cmd %i num_textcmd %i\n",
+    fprintf(debugfile, "    firsttic %8d num_tics %d cmd_player_mask %llX flags %X cmds_offset %i num_cmd %i num_textcmd %i\n",
       ExpandTics (netbuffer->u.serverpak.starttic), netbuffer->u.serverpak.numtics,
-      DN_read_N32(&netbuffer->u.serverpak.cmd_player_mask), netbuffer->u.serverpak.flags,
+      DN_read_NPM(&netbuffer->u.serverpak.cmd_player_mask), netbuffer->u.serverpak.flags,
       netbuffer->u.serverpak.cmds_offset, num_cmd, num_txt );
     // textcmd
     bp = (byte *)&netbuffer->u.serverpak.cmds[num_cmd];
@@ -1271,8 +1342,8 @@ static void DebugPrintpacket(char *header)
    }
     break;
    case PT_SERVERCFG:
-    fprintf(debugfile, "    playermask %X numplayers %d clientnode %d serverplayer %d gametic %8u gamestate %d command %s\n",
-      DN_read_N32(&netbuffer->u.servercfg.playerdetected),
+    fprintf(debugfile, "    playermask %llX numplayers %d clientnode %d serverplayer %d gametic %8u gamestate %d command %s\n",
+      DN_read_NPM(&netbuffer->u.servercfg.playerdetected),
       netbuffer->u.servercfg.num_game_players,
       netbuffer->u.servercfg.clientnode,
       netbuffer->u.servercfg.serverplayer,
@@ -1346,6 +1417,14 @@ static void DebugPrintpacket(char *header)
       (unsigned long)netbuffer->u.filetxpak.position,
       netbuffer->u.filetxpak.size );
     break;
+   case PT_FILEWINDOW :
+    fprintf(debugfile, "    fileid %d seq %d flags %x position %8lu datasize %d\n",
+      netbuffer->u.filetxwin.fileid,
+      netbuffer->u.filetxwin.seq_lo | (netbuffer->u.filetxwin.seq_hi << 8),
+      netbuffer->u.filetxwin.flags,
+      (unsigned long)netbuffer->u.filetxwin.position,
+      netbuffer->u.filetxwin.size );
+    break;
    case PT_NETWAIT :
     fprintf(debugfile, "    num_netplayer %d wait_netplayer %d  wait_tics %d\n",
       netbuffer->u.netwait.num_netplayer, netbuffer->u.netwait.wait_netplayer, netbuffer->u.netwait.wait_tics );
@@ -1521,6 +1600,251 @@ byte  NetQueue_send( void )
 }
 #endif
 
+// ---- Network simulation.
+// Latency, jitter, loss, and reordering, set by -netsim or the netsim
+// command, to test the ack and tic distribution of a game under load.
+// It is applied to the packets this program sends and receives, so
+// a server with netsim impairs the links to all its clients, both ways.
+// The packets are held in a delay queue, and are sent, or received, when
+// they are due.  The delay queues are serviced by HGetPacket.
+
+typedef struct {
+    uint32_t  latency_ms;  // one way delay
+    uint32_t  jitter_ms;   // random added delay, 0..jitter_ms
+    byte      loss;        // percent of packets dropped
+    byte      reorder;     // percent of packets held past later packets
+} netsim_param_t;
+
+static netsim_param_t  netsim;
+static boolean  netsim_on = false;
+
+// A reordered packet is held this much longer, about a tic.
+#define NETSIM_REORDER_MS   30
+#define NETSIM_QUEUE_SIZE   256
+
+typedef struct {
+    uint32_t  due_ms;
+    uint32_t  seq;     // the order of the packets that are due together
+    int16_t   nnode;   // to node, or from node
+    uint16_t  length;
+    byte      pak[MAXPACKETLENGTH];
+} netsim_pak_t;
+
+typedef struct {
+    netsim_pak_t *  pak;  // malloc, NETSIM_QUEUE_SIZE
+    uint16_t  num;
+    uint32_t  seq;
+    // Jitter does not reorder the packets of a net node.
+    uint32_t  last_due_ms[MAX_CON_NETNODE];
+} netsim_queue_t;
+
+static netsim_queue_t  netsim_send_q, netsim_get_q;
+
+// Netsim stats
+static uint32_t  netsim_dropped = 0;
+static uint32_t  netsim_reordered = 0;
+static uint32_t  netsim_overflow = 0;
+
+static uint32_t  netsim_rand_state = 0x2545F491;
+
+// Not the game random, which must stay in sync.
+static uint32_t  netsim_random( void )
+{
+    // xorshift32
+    uint32_t x = netsim_rand_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    netsim_rand_state = x;
+    return x;
+}
+
+static uint32_t  netsim_time_ms( void )
+{
+    return (uint32_t)( M_Time_ns() / 1000000 );
+}
+
+// Put a packet in the delay queue.
+// Return false when the queue is full.
+static boolean  netsim_put( netsim_queue_t * nq, int nnode, byte * pak, int length )
+{
+    netsim_pak_t * sp;
+    uint32_t  due;
+
+    if( (netsim_random() % 100) < netsim.loss )
+    {
+        netsim_dropped++;
+        return true;  // sent, but gets lost
+    }
+
+    if( nq->num >= NETSIM_QUEUE_SIZE )
+    {
+        netsim_overflow++;
+        return false;
+    }
+
+    due = netsim_time_ms() + netsim.latency_ms;
+    if( netsim.jitter_ms )
+        due += netsim_random() % (netsim.jitter_ms + 1);
+
+    if( (netsim_random() % 100) < netsim.reorder )
+    {
+        // Held past the packets after it.
+        due += netsim.jitter_ms + NETSIM_REORDER_MS;
+        netsim_reordered++;
+    }
+    else if( nnode >= 0 && nnode < MAX_CON_NETNODE )
+    {
+        if( (int32_t)(due - nq->last_due_ms[nnode]) < 0 )
+            due = nq->last_due_ms[nnode];
+        nq->last_due_ms[nnode] = due;
+    }
+
+    sp = & nq->pak[nq->num++];
+    sp->due_ms = due;
+    sp->seq = nq->seq++;
+    sp->nnode = nnode;
+    sp->length = length;
+    memcpy( sp->pak, pak, length );
+    return true;
+}
+
+// Take the packet that is due first, into doomcom.
+// Return false when no packet is due.
+static boolean  netsim_take( netsim_queue_t * nq, uint32_t now_ms )
+{
+    netsim_pak_t * sp;
+    netsim_pak_t * first = NULL;
+
+    for( sp = &nq->pak[0]; sp < &nq->pak[nq->num]; sp++ )
+    {
+        if( (int32_t)(now_ms - sp->due_ms) < 0 )  continue;  // not due
+        if( first == NULL
+            || (int32_t)(sp->due_ms - first->due_ms) < 0
+            || ( sp->due_ms == first->due_ms
+                 && (int32_t)(sp->seq - first->seq) < 0 ) )
+            first = sp;
+    }
+    if( first == NULL )
+        return false;
+
+    doomcom->remotenode = first->nnode;
+    doomcom->datalength = first->length;
+    memcpy( doomcom->data, first->pak, first->length );
+
+    // Fill the hole with the last entry.
+    nq->num--;
+    if( first != &nq->pak[nq->num] )
+        memcpy( first, &nq->pak[nq->num], sizeof(netsim_pak_t) );
+    return true;
+}
+
+// Send the delayed packets that are due.
+//  send_all : send them all, due or not
+static void  netsim_send_due( boolean send_all )
+{
+    static byte  save_data[MAXPACKETLENGTH];
+    int16_t   save_remotenode;
+    uint16_t  save_datalength;
+    uint32_t  now_ms;
+
+    if( netsim_send_q.num == 0 )
+        return;
+
+    // The caller may still be using the netbuffer.
+    save_remotenode = doomcom->remotenode;
+    save_datalength = doomcom->datalength;
+    memcpy( save_data, doomcom->data, MAXPACKETLENGTH );
+
+    now_ms = netsim_time_ms();
+    if( send_all )
+        now_ms += netsim.latency_ms + (2 * netsim.jitter_ms) + NETSIM_REORDER_MS + 1;
+
+    while( netsim_take( &netsim_send_q, now_ms ) )
+        I_NetSend();
+
+    doomcom->remotenode = save_remotenode;
+    doomcom->datalength = save_datalength;
+    memcpy( doomcom->data, save_data, MAXPACKETLENGTH );
+}
+
+// Function for I_NetSend(), when netsim is on.
+static byte  NetSim_Send( void )
+{
+    if( ! netsim_put( &netsim_send_q, doomcom->remotenode,
+                      (byte*)doomcom->data, doomcom->datalength ) )
+    {
+        net_error = NE_queue_full;
+        return net_error;
+    }
+    return NE_success;
+}
+
+// Function for I_NetGet(), when netsim is on.
+static byte  NetSim_Get( void )
+{
+    byte errcode;
+
+    netsim_send_due( false );
+
+    // Move the packets waiting on the network into the delay queue.
+    for(;;)
+    {
+        errcode = I_NetGet();
+        if( errcode != NE_success || doomcom->remotenode < 0 )
+            break;
+        // When the queue is full, the packet is lost.
+        netsim_put( &netsim_get_q, doomcom->remotenode,
+                    (byte*)doomcom->data, doomcom->datalength );
+    }
+    if( errcode >= NE_fail )
+        return errcode;
+
+    if( ! netsim_take( &netsim_get_q, netsim_time_ms() ) )
+    {
+        doomcom->remotenode = -1;
+        return NE_empty;
+    }
+    return NE_success;
+}
+
+//  latency_ms, jitter_ms : 0 .. 10000
+//  loss, reorder : percent
+static void  NetSim_Set( int latency_ms, int jitter_ms, int loss, int reorder )
+{
+    netsim.latency_ms = (latency_ms < 0)? 0 : (latency_ms > 10000)? 10000 : latency_ms;
+    netsim.jitter_ms = (jitter_ms < 0)? 0 : (jitter_ms > 10000)? 10000 : jitter_ms;
+    netsim.loss = (loss < 0)? 0 : (loss > 100)? 100 : loss;
+    netsim.reorder = (reorder < 0)? 0 : (reorder > 100)? 100 : reorder;
+
+    if( netsim_send_q.pak == NULL )
+    {
+        netsim_send_q.pak = malloc( NETSIM_QUEUE_SIZE * sizeof(netsim_pak_t) );
+        netsim_get_q.pak = malloc( NETSIM_QUEUE_SIZE * sizeof(netsim_pak_t) );
+        if( netsim_send_q.pak == NULL || netsim_get_q.pak == NULL )
+            I_Error( "Netsim: cannot allocate delay queues\n" );
+    }
+
+    netsim_dropped = netsim_reordered = netsim_overflow = 0;
+    netsim_on = true;
+}
+
+// Send the held packets.  The held received packets are lost.
+static void  NetSim_Flush( void )
+{
+    netsim_send_due( true );
+    netsim_get_q.num = 0;
+}
+
+static void  NetSim_Off( void )
+{
+    if( ! netsim_on )
+        return;
+
+    NetSim_Flush();
+    netsim_on = false;
+}
+
 
 //
 // HSendPacket
@@ -1621,26 +1945,11 @@ byte  HSendPacket(byte to_node, byte flags, byte acknum, int packetlength)
 
     netbuffer->checksum = Netbuffer_Checksum();
     stat_sendbytes += (net_packetheader_length + doomcom->datalength); // for stat
+    if( to_node < MAXNETNODES )
+        net_nodes[to_node].stat_sendbytes += (net_packetheader_length + doomcom->datalength);
 
-#if 0
-    // DEBUG
-    // simulate internet :)
-    if( rand() > RAND_MAX/5 )
-    {
-        // Simulate a failure.
-#ifdef DEBUGFILE
-        if (debugfile)
-            DebugPrintpacket("SENDLOST");
-#endif
-        return NE_success;  // indicates sent, but gets lost
-    }
-#ifdef DEBUGFILE
-        if (debugfile)
-            DebugPrintpacket("SEND");
-#endif
-#endif
-
-    errcode = I_NetSend();   
+    // Simulate the internet :)
+    errcode = (netsim_on)? NetSim_Send() : I_NetSend();
     if( errcode >= NE_fail )   goto ret_errcode;
     return NE_success;
 
@@ -1699,7 +2008,7 @@ ret_errcode:
 // Returns false if no packet is waiting
 // Check Datalength and checksum
 //
-boolean HGetPacket (void)
+static boolean hget_packet (void)
 {
     if (rebound_tail!=rebound_head)
     {
@@ -1721,7 +2030,7 @@ boolean HGetPacket (void)
 
     if (!netgame)   goto fail_ret;
 
-    byte errcode = I_NetGet();
+    byte errcode = (netsim_on)? NetSim_Get() : I_NetGet();
     if( errcode >= NE_fail )
         goto ret_errcode;  // some other error
     if( errcode >= NE_empty )
@@ -1735,6 +2044,7 @@ boolean HGetPacket (void)
     {
         // Player netnode
         net_nodes[doomcom->remotenode].lasttime_packet_received = I_GetTime();
+        net_nodes[doomcom->remotenode].stat_getbytes += (net_packetheader_length + doomcom->datalength);
     }
     else if (doomcom->remotenode >= MAX_CON_NETNODE)  goto bad_node_num;
 
@@ -1775,6 +2085,95 @@ fail_ret:
     return false;
 }
 
+boolean HGetPacket (void)
+{
+    boolean result;
+    PROF_ZONE( zt );
+    result = hget_packet();
+    PROF_END( zt, "HGetPacket" );
+    return result;
+}
+
+// ---- Network test commands.
+
+// netsim <latency ms> <jitter ms> <loss %> <reorder %>
+// netsim off
+static void Command_NetSim_f( void )
+{
+    if( COM_Argc() >= 2 )
+    {
+        if( strcasecmp( COM_Argv(1), "off" ) == 0 )
+            NetSim_Off();
+        else
+            NetSim_Set( atoi(COM_Argv(1)), atoi(COM_Argv(2)),
+                        atoi(COM_Argv(3)), atoi(COM_Argv(4)) );
+    }
+
+    if( ! netsim_on )
+    {
+        CONS_Printf( "Netsim off\n"
+                     "netsim <latency ms> <jitter ms> <loss %%> <reorder %%>\n" );
+        return;
+    }
+    CONS_Printf( "Netsim: latency %u ms, jitter %u ms, loss %i%%, reorder %i%%\n",
+                 netsim.latency_ms, netsim.jitter_ms, netsim.loss, netsim.reorder );
+    CONS_Printf( "  dropped %u, reordered %u, queue full %u\n",
+                 netsim_dropped, netsim_reordered, netsim_overflow );
+    CONS_Printf( "  held %i send, %i receive\n",
+                 netsim_send_q.num, netsim_get_q.num );
+}
+
+// Stats of each net node.  The bandwidth is since the previous netnodestats.
+static void Command_NetNodeStats_f( void )
+{
+    static uint32_t  prev_sendbytes[MAXNETNODES];
+    static uint32_t  prev_getbytes[MAXNETNODES];
+    static tic_t  prev_tic = 0;
+
+    tic_t  now = I_GetTime();
+    tic_t  dt = (now > prev_tic)? (now - prev_tic) : 1;
+    ackpak_t * ackpakp;
+    netnode_t * np;
+    int  nn, unacked, acktosend;
+
+    CONS_Printf( "node ping  var lag  send B/s  recv B/s resend unack ackq max\n" );
+    for( nn=1; nn<MAXNETNODES; nn++ )
+    {
+        np = & net_nodes[nn];
+        if( np->return_ack == 0 && np->stat_sendbytes == 0 )
+            continue;  // unused
+
+        unacked = 0;
+        for( ackpakp = &ackpak[0]; ackpakp < &ackpak[num_ackpak]; ackpakp++ )
+        {
+            if( ackpakp->acknum && ackpakp->destination_node == nn )
+                unacked++;
+        }
+        acktosend = (np->acktosend_head + MAXACKTOSEND - np->acktosend_tail)
+                    % MAXACKTOSEND;
+
+        // The node stats are cleared when a connection closes.
+        if( np->stat_sendbytes < prev_sendbytes[nn] )
+            prev_sendbytes[nn] = 0;
+        if( np->stat_getbytes < prev_getbytes[nn] )
+            prev_getbytes[nn] = 0;
+
+        // ping in ms, lag in tics behind the server
+        CONS_Printf( "%3i %5i %4i %3i %9u %9u %6u %5i %4i %3i\n",
+            nn,
+            (int)((((int64_t)np->ping) * 1000 / TICRATE) >> FRACBITS),
+            (int)((((int64_t)np->varping) * 1000 / TICRATE) >> FRACBITS),
+            SV_Node_TicLag( nn ),
+            (unsigned int)(((uint64_t)(np->stat_sendbytes - prev_sendbytes[nn])) * TICRATE / dt),
+            (unsigned int)(((uint64_t)(np->stat_getbytes - prev_getbytes[nn])) * TICRATE / dt),
+            np->stat_resends, unacked, acktosend, np->stat_acktosend_max );
+
+        prev_sendbytes[nn] = np->stat_sendbytes;
+        prev_getbytes[nn] = np->stat_getbytes;
+    }
+    prev_tic = now;
+}
+
 
 //
 // D_Startup_NetGame
@@ -1786,6 +2185,14 @@ boolean D_Startup_NetGame(void)
     boolean client;
     int  num;
 
+    if( M_CheckParm ("-backuptics") && M_IsNextParm() )
+    {
+        // Before InitAck and D_Init_ClientServer, which allocate for it.
+        backup_tics = atoi(M_GetNextParm());
+        if( backup_tics < BACKUPTICS_MIN )  backup_tics = BACKUPTICS_MIN;
+        if( backup_tics > BACKUPTICS_MAX )  backup_tics = BACKUPTICS_MAX;
+    }
+
     // Bring up low level functions.
     InitAck();
     rebound_tail=0;
@@ -1793,10 +2200,14 @@ boolean D_Startup_NetGame(void)
 
     stat_starttic = I_GetTime();  // start netstat interval
 
+    COM_AddCommand("netsim", Command_NetSim_f, CC_net);
+    COM_AddCommand("netnodestats", Command_NetNodeStats_f, CC_info);
+
     // Default
     I_NetGet           = Internal_Get;
     I_NetSend          = Internal_Send;
     I_NetCanSend       = NULL;
+    I_NetSendBatch     = NULL;
     I_NetCloseSocket   = NULL;
     I_NetFreeNode      = Internal_FreeNode;
     I_NetMakeNode      = NULL;
@@ -1949,6 +2360,17 @@ boolean D_Startup_NetGame(void)
         software_MAXPACKETLENGTH = num;
     }
 
+    if( M_CheckParm ("-netsim") )
+    {
+        // -netsim <latency ms> <jitter ms> <loss %> <reorder %>
+        int  sp[4] = { 0, 0, 0, 0 };
+        for( num=0; num<4 && M_IsNextParm(); num++ )
+            sp[num] = atoi(M_GetNextParm());
+        NetSim_Set( sp[0], sp[1], sp[2], sp[3] );
+        CONS_Printf("Netsim: latency %u ms, jitter %u ms, loss %i%%, reorder %i%%\n",
+                    netsim.latency_ms, netsim.jitter_ms, netsim.loss, netsim.reorder );
+    }
+
 #ifdef PARANOIA
     if (doomcom->id != DOOMCOM_ID)
         I_Error ("Doomcom buffer invalid!");
@@ -2005,6 +2427,9 @@ extern void D_CloseConnection( void )
         for( i=0; i<MAX_CON_NETNODE; i++ )
             Net_CloseConnection(i, 1);  // force close
 
+        if( netsim_on )
+            NetSim_Flush();
+
         InitAck();
 
         if( I_NetCloseSocket )
@@ -2013,6 +2438,7 @@ extern void D_CloseConnection( void )
         I_NetGet           = Internal_Get;
         I_NetSend          = Internal_Send;
         I_NetCanSend       = NULL;
+        I_NetSendBatch     = NULL;
         I_NetCloseSocket   = NULL;
         I_NetFreeNode	   = Internal_FreeNode;
         I_NetMakeNode      = NULL;
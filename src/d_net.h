@@ -47,7 +47,14 @@
 //
 
 // Max player computers in a game. Limited to 127 by chat.
+// A build profile can set fewer.
+#ifndef MAXNETNODES
+#ifdef LARGE_LOBBY
+#define MAXNETNODES     64
+#else
 #define MAXNETNODES     32
+#endif
+#endif
 // Broadcast added xx/5/99: can use broadcast now
 #define BROADCAST_NODE   MAXNETNODES
 // MasterServer Ping
@@ -65,12 +72,14 @@
 extern int    netstat_recv_bps, netstat_send_bps;
 extern float  netstat_lost_percent, netstat_dup_percent;
 extern float  netstat_gamelost_percent;
+extern int    netstat_tic_fullbytes, netstat_tic_bytes;
 
 boolean Net_GetNetStat(void);
 
 extern int    net_packetheader_length;
 extern int       stat_getbytes;
 extern uint64_t  stat_sendbytes;        // realtime updated 
+extern int       stat_tic_fullbytes, stat_tic_bytes;
 
 void    Net_AckTicker(void);
 boolean Net_AllAckReceived(void);
@@ -93,5 +102,6 @@ void    Net_Cancel_Packet_Ack(int nnode);
 void    Net_CloseConnection(byte nnode, byte forceclose);
 void    Net_AbortPacketType(byte packettype);
 void    Net_Send_AcksPacket(int to_node);
+void    Net_Send_Batch( boolean hold );
 void    Net_Wait_AllAckReceived( uint32_t timeout );
 #endif
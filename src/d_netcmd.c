@@ -133,8 +133,10 @@
 #include "p_inter.h"
 #include "p_local.h"
 #include "p_setup.h"
+#include "p_tick.h"
 #include "s_sound.h"
 #include "m_misc.h"
+#include "m_profile.h"
 #include "am_map.h"
 #include "d_netfil.h"
 #include "p_spec.h"
@@ -286,6 +288,15 @@ void D_Register_ClientCommands(void)
     COM_AddCommand("turbo", Command_Turbo_f, CC_command);   // turbo speed
     COM_AddCommand("quit", Command_Quit_f, CC_command);
     COM_AddCommand("screenshot", M_ScreenShot, CC_command);
+#ifdef PROFILE_ZONES
+    M_Profile_Register();
+#endif
+#ifdef SIGHT_CACHE
+    P_Sight_Register();
+#endif
+#ifdef SECNODE_CLEARBOX
+    P_Secnode_Register();
+#endif
     COM_AddCommand("kill", Command_Kill, CC_command);
 
     COM_AddCommand("chatmacro", Command_Chatmacro_f, CC_chat);   // hu_stuff.c
@@ -331,6 +342,11 @@ void D_Register_ClientCommands(void)
    
     //misc
     CV_RegisterVar(&cv_netstat);
+    CV_RegisterVar(&cv_thinker_dispatch);  // p_tick
+    CV_RegisterVar(&cv_intercept_sort);  // p_maputl
+#ifdef THING_GRID
+    CV_RegisterVar(&cv_thing_grid);  // p_maputl
+#endif
 
     //
     //  The above commands are enough for dedicated server
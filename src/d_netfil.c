@@ -111,6 +111,12 @@
 #include <zip.h>
 #endif
 
+#if defined( HAVE_ZLIB ) && ( HAVE_ZLIB == 1 )
+// Compressed file fragments.
+# define FILETX_ZLIB
+# include <zlib.h>
+#endif
+
 #include "doomincl.h"
 #include "doomstat.h"
 #include "d_net.h"
@@ -131,6 +137,36 @@
 #include "d_main.h"
   // DOOMWADDIR
 #include "md5.h"
+#include "console.h"
+
+// Window mode file transfer, when the client has FTC_window.
+// The fragments are sent without the net ack, in a window of fragments
+// for each net node, and the client returns a selective ack of them.
+// A fragment that is not acked within the resend timeout is sent again.
+// The window grows while there is no loss, and is cut by half on loss.
+// All window mode transfers are limited by sv_filetx_rate, and do not send
+// when the network cannot send, so the tic packets go first.
+#define FILETX_WINDOW       64   // fragments, the selective ack bitmap
+#define FILETX_CWND_MIN      4
+#define FILETX_CWND_START    8
+#define FILETX_ACK_EVERY     2   // client acks after this many fragments
+// A zlib fragment holds this much raw data, at most.
+#define FILETX_RAW_MAX    (8*1024)
+
+// filetx_win_pak_t flags
+typedef enum {
+   FTF_zlib   = 0x02,  // data is zlib compressed
+} filetx_flags_e;
+
+// A window mode fragment, sent and waiting for ack.
+typedef struct {
+    uint32_t  position;  // of the raw data
+    uint16_t  length;    // raw data
+    byte      flags;     // FTF_ as sent
+    byte      acked;
+    byte      resent;    // no round trip time from a resent fragment
+    tic_t     senttime;
+} filetx_frag_t;
 
 // sender structure
 typedef struct filetx_s {
@@ -149,8 +185,28 @@ typedef struct {
    filetx_t  *txlist;    // only set by server
    uint32_t   position;  // file and data transfer position
    FILE*      currentfile;
+   byte       caps;      // FTC_ of the client
+   // Window mode, set when the file is opened.
+   byte       win_mode;
+   byte       cwnd;      // congestion window, fragments
+   byte       cwnd_acc;  // fragments acked toward the next cwnd increase
+   byte       slow_start;  // grow cwnd by the acks, until a loss
+   uint16_t   win_base;  // seq of the first fragment not acked
+   uint16_t   win_next;  // seq of the next new fragment
+   uint16_t   raw_chunk; // raw bytes to try in one fragment
+   int        srtt8, rttvar8;  // round trip time, tics * 8
+   tic_t      rto;       // resend timeout, tics
+   tic_t      cwnd_cut_tic;
+   filetx_frag_t  frag[FILETX_WINDOW];  // index by seq % FILETX_WINDOW
+   // Stats
+   tic_t      start_tic;
+   uint32_t   stat_sent, stat_resent;  // bytes
 } transfer_t;
 
+// The transfer of the node is in window mode.
+#define  FILETX_WINDOW_NODE( tnnp ) \
+   ( (tnnp)->currentfile? (tnnp)->win_mode : ((tnnp)->caps & FTC_window) )
+
 // Only transfer files to player nodes.
 static transfer_t transfer[MAXNETNODES];
 
@@ -165,6 +221,11 @@ typedef struct {
     uint32_t bytes_recv;  // to determine when done and for status
     uint32_t totalsize;
     filestatus_e status;        // the value returned by recsearch
+    // Window mode receive
+    uint16_t rx_base;     // seq of the first fragment not received
+    uint64_t rx_bits;     // bit n for fragment rx_base+n received
+    byte     rx_unacked;  // fragments received since the last ack
+    tic_t    rx_start_tic, rx_print_tic;
 } fileneed_t;
 
 // Client receiver structure
@@ -444,7 +505,7 @@ reqfile_e  Send_RequestFile(void)
 
                 // [WDJ] Check for net buffer overflow.
                 int nxt_bcnt = bcnt + strlen( filetmp ) + 1;
-                if( nxt_bcnt > MAX_NETBYTE_LEN-1 )  break;
+                if( nxt_bcnt > MAX_NETBYTE_LEN-2 )  break;
                 bcnt = nxt_bcnt;
 
                 WRITECHAR(p,fcnt);  // fileid, 0..n
@@ -456,6 +517,8 @@ reqfile_e  Send_RequestFile(void)
             }
         }
         WRITECHAR(p,-1);
+        // Older servers ignore the FTC_ after the end.
+        WRITEBYTE(p, CL_Filetx_Caps());
         netbuffer->packettype = PT_REQUESTFILE;
 
         if( bcnt == 0 )  goto broken_format;  // broken, filename too long
@@ -490,8 +553,9 @@ insufficient_space:
 void Got_RequestFilePak(byte nnode)
 {
     char *p = (char *)netbuffer->u.bytepak.b;
+    char *endp = (char *)netbuffer + doomcom->datalength;
 
-    // format: REPEAT( byte fileid, string0 filename ), 0xFF
+    // format: REPEAT( byte fileid, string0 filename ), 0xFF, byte FTC_
     // The requester determines a fileid for each filename.
     while((byte)*p!=0xFF)  // fileid
     {
@@ -499,6 +563,8 @@ void Got_RequestFilePak(byte nnode)
         p++; // skip fileid
         SKIPSTRING(p);
     }
+    // Older clients do not send the FTC_.
+    SV_Filetx_Caps( nnode, ( p + 1 < endp )? (byte)p[1] : 0 );
 }
 
 
@@ -764,6 +830,404 @@ static void SV_End_SendFile(byte nnode)
     Filetx_file_cnt--;
 }
 
+// By Server.
+// Open the file or data of the first filetx of the net node.
+// Return false when it cannot be opened, and the filetx has been ended.
+static boolean  filetx_open( byte nn )
+{
+    transfer_t * tnnp = & transfer[nn];
+    filetx_t   * ftxp = tnnp->txlist;
+    FILE * fp;
+
+    if(ftxp->release_tah == TAH_FILE)
+    {
+        // open the file to transfer
+        long filesize;
+
+        fp = fopen(ftxp->filename,"rb");
+        tnnp->currentfile = fp;  // owner of open file
+
+        if(! fp)
+        {
+            perror("FileTx");
+            I_SoftError("FileTx: Cannot open file %s\n",
+                         ftxp->filename);
+            SV_End_SendFile(nn);
+            return false;
+        }
+
+        fseek(fp, 0, SEEK_END);
+        filesize = ftell( fp );
+
+        // nobody wants to transfer a file bigger than 4GB!
+        // and computers will never need more than 640kb of RAM ;-)
+        if(-1 == filesize)
+        {
+            perror("FileTx");
+            I_SoftError("FileTx: Error getting filesize of %s\n", ftxp->filename);
+            SV_End_SendFile(nn);
+            return false;
+        }
+
+        ftxp->data_size = filesize;
+        fseek(fp, 0, SEEK_SET);
+    }
+    else
+    {
+        tnnp->currentfile = (FILE *)1;  // faked open flag
+    }
+    tnnp->position = 0;
+
+    // The mode is kept for the whole file.
+    tnnp->win_mode = tnnp->caps & FTC_window;
+    tnnp->win_base = tnnp->win_next = 0;
+    if( tnnp->win_mode && tnnp->cwnd == 0 )
+    {
+        // First window mode file to the node.
+        tnnp->cwnd = FILETX_CWND_START;
+        tnnp->cwnd_acc = 0;
+        tnnp->slow_start = 1;
+        tnnp->srtt8 = (TICRATE/4) * 8;
+        tnnp->rttvar8 = tnnp->srtt8 / 2;
+        tnnp->rto = TICRATE/2;
+    }
+    tnnp->raw_chunk = ( tnnp->caps & FTC_zlib )? FILETX_RAW_MAX/2
+     : software_MAXPACKETLENGTH - (FILETX_HEADER_SIZE+PACKET_BASE_SIZE);
+    tnnp->start_tic = I_GetTime();
+    tnnp->stat_sent = tnnp->stat_resent = 0;
+    return true;
+}
+
+// By Server.
+// Make a window mode fragment in the netbuffer.
+//   compress : try zlib
+// Return the packet length, 0 when the raw data does not fit, -1 on read error.
+static int  filetx_window_pak( transfer_t * tnnp, uint16_t seq, filetx_frag_t * frp,
+                               boolean compress )
+{
+    static byte  raw[FILETX_RAW_MAX];
+
+    filetx_t * ftxp = tnnp->txlist;
+    filetx_win_pak_t * pak = & netbuffer->u.filetxwin;
+    int  payload = software_MAXPACKETLENGTH - (FILETX_HEADER_SIZE+PACKET_BASE_SIZE);
+    uint32_t  pos;
+    uint16_t  size = 0;
+    byte * src;
+
+    if(ftxp->release_tah == TAH_FILE)
+    {
+        if( fseek( tnnp->currentfile, frp->position, SEEK_SET ) != 0 )
+            return -1;
+        if( frp->length && fread( raw, frp->length, 1, tnnp->currentfile ) != 1 )
+            return -1;
+        src = raw;
+    }
+    else
+    {
+        src = &ftxp->data[ frp->position ];
+    }
+
+    pak->flags = 0;
+#ifdef FILETX_ZLIB
+    if( compress )
+    {
+        uLongf  zlen = payload;
+        if( compress2( pak->data, &zlen, src, frp->length, Z_BEST_SPEED ) == Z_OK
+            && zlen < frp->length )
+        {
+            pak->flags |= FTF_zlib;
+            size = zlen;
+        }
+    }
+#endif
+    if( ! (pak->flags & FTF_zlib) )
+    {
+        if( frp->length > payload )
+            return 0;
+        memcpy( pak->data, src, frp->length );
+        size = frp->length;
+    }
+
+    pos = frp->position;
+    if( frp->position + frp->length >= ftxp->data_size )
+    {
+        // End of send file flag.
+        pos |= 0x80000000;
+    }
+    pak->position = LE_SWAP32_FAST(pos);
+    pak->size     = LE_SWAP16_FAST(size);
+    pak->fileid   = ftxp->fileid;
+    pak->seq_lo   = seq;
+    pak->seq_hi   = seq >> 8;
+    netbuffer->packettype=PT_FILEWINDOW;
+    return FILETX_HEADER_SIZE + size;
+}
+
+// By Server.
+// Send one window mode fragment to the net node, a resend or the next one.
+// Return the bytes sent, 0 when nothing can be sent now, -1 on error.
+static int  filetx_window_send( byte nn )
+{
+    transfer_t * tnnp = & transfer[nn];
+    filetx_t   * ftxp = tnnp->txlist;
+    filetx_frag_t * frp;
+    tic_t     now = I_GetTime();
+    uint16_t  seq;
+    uint32_t  remain;
+    int  len;
+
+    // Resend the oldest fragment that has not been acked in time.
+    for( seq = tnnp->win_base; seq != tnnp->win_next; seq++ )
+    {
+        frp = & tnnp->frag[ seq % FILETX_WINDOW ];
+        if( frp->acked || (now - frp->senttime) < tnnp->rto )
+            continue;
+
+        len = filetx_window_pak( tnnp, seq, frp, frp->flags & FTF_zlib );
+        if( len <= 0 )
+            return -1;
+        if( HSendPacket( nn, 0, 0, len ) >= NE_fail )
+            return 0;  // retry at next call
+        frp->senttime = now;
+        frp->resent = 1;
+        tnnp->stat_resent += len;
+        // Loss, cut the window and back off, once per timeout.
+        if( (now - tnnp->cwnd_cut_tic) >= tnnp->rto )
+        {
+            tnnp->cwnd = ( tnnp->cwnd > FILETX_CWND_MIN*2 )? tnnp->cwnd/2 : FILETX_CWND_MIN;
+            tnnp->cwnd_acc = 0;
+            tnnp->slow_start = 0;
+            tnnp->cwnd_cut_tic = now;
+            tnnp->rto = ( tnnp->rto < TICRATE )? tnnp->rto*2 : TICRATE*2;
+        }
+        return len;
+    }
+
+    if( tnnp->position >= ftxp->data_size && tnnp->win_next != 0 )
+    {
+        // All sent, done when all are acked.
+        if( tnnp->win_base == tnnp->win_next )
+        {
+            GenPrintf(EMSG_ver, "Filetx: %s to node %d, %dK in %d tics, resent %dK\n",
+                      (ftxp->release_tah == TAH_FILE)? ftxp->filename : "data",
+                      nn, ftxp->data_size>>10, now - tnnp->start_tic,
+                      tnnp->stat_resent>>10 );
+            SV_End_SendFile(nn);
+        }
+        return 0;
+    }
+
+    if( (uint16_t)(tnnp->win_next - tnnp->win_base) >= tnnp->cwnd )
+        return 0;  // wait for acks
+
+    seq = tnnp->win_next;
+    frp = & tnnp->frag[ seq % FILETX_WINDOW ];
+    frp->position = tnnp->position;
+    remain = ftxp->data_size - tnnp->position;
+    for(;;)
+    {
+        frp->length = ( tnnp->raw_chunk < remain )? tnnp->raw_chunk : remain;
+        len = filetx_window_pak( tnnp, seq, frp, tnnp->caps & FTC_zlib );
+        if( len < 0 )
+            return -1;
+        if( len > 0 )
+            break;
+        // Did not compress to fit, try less raw data.
+        int payload = software_MAXPACKETLENGTH - (FILETX_HEADER_SIZE+PACKET_BASE_SIZE);
+        tnnp->raw_chunk = ( tnnp->raw_chunk > payload*2 )? tnnp->raw_chunk/2 : payload;
+    }
+    // Compresses well, try more raw data next time.
+    if( (netbuffer->u.filetxwin.flags & FTF_zlib)
+        && len < (software_MAXPACKETLENGTH * 3 / 4)
+        && frp->length == tnnp->raw_chunk )
+    {
+        tnnp->raw_chunk += tnnp->raw_chunk / 4;
+        if( tnnp->raw_chunk > FILETX_RAW_MAX )
+            tnnp->raw_chunk = FILETX_RAW_MAX;
+    }
+
+    if( HSendPacket( nn, 0, 0, len ) >= NE_fail )
+        return 0;  // retry at next call
+
+    frp->flags = netbuffer->u.filetxwin.flags;
+    frp->acked = 0;
+    frp->resent = 0;
+    frp->senttime = now;
+    tnnp->win_next++;
+    tnnp->position += frp->length;
+    tnnp->stat_sent += len;
+    return len;
+}
+
+// By Server.
+// Send the window mode transfers, within sv_filetx_rate.
+static void  filetx_window_ticker( void )
+{
+    static tic_t  budget_tic = 0;
+    static int    budget = 0;  // bytes
+    static byte   txnode = 0;  // net node num, 0..(MAXNETNODES-1)
+
+    int  rate = cv_SV_filetx_rate.value << 10;  // bytes per second
+    int  per_tic = rate / TICRATE;
+    tic_t  now = I_GetTime();
+    transfer_t * tnnp;
+    boolean  sent;
+    byte nn;
+    int  tcnt, len;
+
+    if( now != budget_tic )
+    {
+        budget += per_tic * (( now - budget_tic < 2 )? now - budget_tic : 2);
+        if( budget > per_tic * 2 )
+            budget = per_tic * 2;
+        budget_tic = now;
+    }
+
+    do
+    {
+        sent = false;
+        // Round robin, fair share.
+        for( tcnt=0; tcnt<MAXNETNODES; tcnt++ )
+        {
+            nn = txnode = (txnode+1)%MAXNETNODES;
+            tnnp = & transfer[nn];
+            if( ! tnnp->txlist || ! FILETX_WINDOW_NODE( tnnp ) )
+                continue;
+            if( ! tnnp->currentfile && ! filetx_open( nn ) )
+                continue;
+            if( ! tnnp->win_mode )
+                continue;  // older file, sent by Filetx_Ticker
+
+            if( rate && budget <= 0 )
+                return;
+            // The tics go first.
+            if( I_NetCanSend && ! I_NetCanSend() )
+                return;
+
+            len = filetx_window_send( nn );
+            if( len < 0 )
+            {
+                perror("FileTx");
+                I_SoftError("Filetx: Read err on %s\n", tnnp->txlist->filename);
+                SV_End_SendFile(nn);
+                continue;
+            }
+            if( len > 0 )
+            {
+                budget -= len + PACKET_BASE_SIZE;
+                sent = true;
+            }
+        }
+    } while( sent );
+}
+
+// By Server.
+// Round trip time sample, tics.
+static void  filetx_rtt_sample( transfer_t * tnnp, int rtt )
+{
+    int err = (rtt * 8) - tnnp->srtt8;
+    tnnp->srtt8 += err / 8;
+    tnnp->rttvar8 += ( ((err < 0)? -err : err) - tnnp->rttvar8 ) / 4;
+    tnnp->rto = (tnnp->srtt8 + (tnnp->rttvar8 * 4)) / 8 + 1;
+    if( tnnp->rto < 2 )
+        tnnp->rto = 2;
+    if( tnnp->rto > TICRATE*2 )
+        tnnp->rto = TICRATE*2;
+}
+
+// By Server.
+// The FTC_ of the client, from its join or its file request.
+void  SV_Filetx_Caps( byte nnode, byte caps )
+{
+    transfer_t * tnnp;
+
+    if( nnode >= MAXNETNODES )
+        return;
+
+    tnnp = & transfer[nnode];
+#ifndef FILETX_ZLIB
+    caps &= ~FTC_zlib;
+#endif
+    // The current file keeps its mode.
+    tnnp->caps = caps;
+}
+
+// By Client.
+// The FTC_ that this client can receive.
+byte  CL_Filetx_Caps( void )
+{
+#ifdef FILETX_ZLIB
+    return FTC_window | FTC_zlib;
+#else
+    return FTC_window;
+#endif
+}
+
+// By Server.
+// PT_FILEACK, the selective ack of window mode fragments.
+void  Got_Filetx_Ack( byte nnode )
+{
+    filetx_ack_pak_t * ap = & netbuffer->u.filetxack;
+    transfer_t * tnnp;
+    filetx_frag_t * frp;
+    tic_t     now;
+    uint16_t  base, seq;
+    int  n, newly = 0;
+
+    if( nnode >= MAXNETNODES )
+        return;
+
+    tnnp = & transfer[nnode];
+    if( ! tnnp->txlist || ! tnnp->currentfile || ! tnnp->win_mode )
+        return;
+    if( ap->fileid != tnnp->txlist->fileid )
+        return;  // for an older file
+
+    base = ap->seq_base.b[0] | (ap->seq_base.b[1] << 8);
+    if( (uint16_t)(base - tnnp->win_base) > (uint16_t)(tnnp->win_next - tnnp->win_base) )
+        return;  // not in the window
+
+    now = I_GetTime();
+    for( seq = tnnp->win_base; seq != tnnp->win_next; seq++ )
+    {
+        // Before base are all received.
+        n = (int16_t)(seq - base);
+        if( n >= 0
+            && ( n >= FILETX_WINDOW || ! (ap->bits[n>>3] & (1 << (n&7))) ) )
+            continue;
+
+        frp = & tnnp->frag[ seq % FILETX_WINDOW ];
+        if( frp->acked )
+            continue;
+        frp->acked = 1;
+        newly++;
+        if( ! frp->resent )
+            filetx_rtt_sample( tnnp, now - frp->senttime );
+    }
+
+    // Advance over the acked fragments.
+    while( tnnp->win_base != tnnp->win_next
+           && tnnp->frag[ tnnp->win_base % FILETX_WINDOW ].acked )
+        tnnp->win_base++;
+
+    if( tnnp->slow_start )
+    {
+        // One more fragment in the window, each fragment acked.
+        n = tnnp->cwnd + newly;
+        tnnp->cwnd = ( n < FILETX_WINDOW )? n : FILETX_WINDOW;
+        return;
+    }
+
+    // One more fragment in the window, each window acked.
+    tnnp->cwnd_acc += newly;
+    while( tnnp->cwnd_acc >= tnnp->cwnd )
+    {
+        tnnp->cwnd_acc -= tnnp->cwnd;
+        if( tnnp->cwnd < FILETX_WINDOW )
+            tnnp->cwnd++;
+    }
+}
+
 // By Server.
 // Called by NetUpdate, CL_ConnectToServer, repair_handler.
 void Filetx_Ticker(void)
@@ -783,6 +1247,7 @@ void Filetx_Ticker(void)
     if( Filetx_file_cnt == 0 )   goto reject;  // nothing to do
    
     // By Server, only server has Filetx_file_cnt > 0.
+    filetx_window_ticker();
 
     // Packets per tic
     packet_cnt = net_bandwidth/(TICRATE*software_MAXPACKETLENGTH);
@@ -796,7 +1261,7 @@ void Filetx_Ticker(void)
         nn = (txnode+1)%MAXNETNODES;
         for( tcnt=0; tcnt<MAXNETNODES; tcnt++ )  // counter
         {
-            if(transfer[nn].txlist)
+            if(transfer[nn].txlist && ! FILETX_WINDOW_NODE( &transfer[nn] ))
                  goto found;
             nn = (nn+1)%MAXNETNODES;
         }
@@ -812,38 +1277,9 @@ found:
         fp = tnnp->currentfile;
         if(!fp) // file not already open
         {
-            if(access_tah == TAH_FILE)
-            {
-                // open the file to transfer
-                long filesize;
-
-                fp = fopen(ftxp->filename,"rb");
-                tnnp->currentfile = fp;  // owner of open file
-
-                if(! fp)
-                {
-                    perror("FileTx");
-                    I_SoftError("FileTx: Cannot open file %s\n",
-                                 ftxp->filename);
-                    SV_End_SendFile(nn);
-                    continue;
-                }
-
-                fseek(fp, 0, SEEK_END);
-                filesize = ftell( fp );
-
-                // nobody wants to transfer a file bigger than 4GB!
-                // and computers will never need more than 640kb of RAM ;-)
-                if(-1 == filesize)  goto file_size_err;
-
-                ftxp->data_size = filesize;
-                fseek(fp, 0, SEEK_SET);
-            }
-            else
-            {
-                tnnp->currentfile = (FILE *)1;  // faked open flag
-            }
-            tnnp->position = 0;
+            if( ! filetx_open( nn ) )
+                continue;
+            fp = tnnp->currentfile;
         }
 
         pak=&netbuffer->u.filetxpak;
@@ -897,12 +1333,6 @@ found:
     return;
 
     // Rare fatal errors.
-file_size_err:
-    perror("FileTx");
-    I_SoftError("FileTx: Error getting filesize of %s\n", ftxp->filename);
-    SV_End_SendFile(nn);
-    goto reject;
-
 file_read_err:
     perror("FileTx");
     I_SoftError("Filetx: Read err on %s at %d of %d bytes\n",
@@ -910,6 +1340,12 @@ file_read_err:
     goto reject;
 
 transfer_not_found:
+    // The window mode transfers are sent by filetx_window_ticker.
+    for( tcnt=0; tcnt<MAXNETNODES; tcnt++ )
+    {
+        if( transfer[tcnt].txlist )
+            goto reject;
+    }
     I_SoftError("Filetx: Filetx_file_cnt=%d but Filetx file not found\n", Filetx_file_cnt);
     Filetx_file_cnt = 0;
     goto reject;
@@ -918,6 +1354,67 @@ reject:
     return;
 }
 
+// By Server.
+// Show the file transfers.
+void Command_Filetx_f( void )
+{
+    tic_t  now = I_GetTime();
+    transfer_t * tnnp;
+    filetx_t   * ftxp;
+    tic_t  dt;
+    int  nn, cnt = 0;
+
+    for( nn=0; nn<MAXNETNODES; nn++ )
+    {
+        tnnp = & transfer[nn];
+        ftxp = tnnp->txlist;
+        if( ! ftxp )
+            continue;
+        cnt++;
+        if( ! tnnp->currentfile )
+        {
+            CONS_Printf( "%2d: %s, waiting\n", nn,
+                 (ftxp->release_tah == TAH_FILE)? ftxp->filename : "data" );
+            continue;
+        }
+        dt = ( now > tnnp->start_tic )? now - tnnp->start_tic : 1;
+        CONS_Printf( "%2d: %s, %dK/%dK, %dK/s\n", nn,
+                 (ftxp->release_tah == TAH_FILE)? ftxp->filename : "data",
+                 tnnp->position>>10, ftxp->data_size>>10,
+                 (int)(((uint64_t)tnnp->position * TICRATE / dt) >> 10) );
+        if( tnnp->win_mode )
+        {
+            CONS_Printf( "    window %d, in flight %d, resend %d tics, sent %dK, resent %dK",
+                 tnnp->cwnd, (uint16_t)(tnnp->win_next - tnnp->win_base),
+                 tnnp->rto, tnnp->stat_sent>>10, tnnp->stat_resent>>10 );
+            if( tnnp->caps & FTC_zlib )
+                CONS_Printf( ", zlib %d%%",
+                 (tnnp->position)? (int)((uint64_t)tnnp->stat_sent * 100 / tnnp->position) : 100 );
+            CONS_Printf( "\n" );
+        }
+    }
+    if( cnt == 0 )
+        CONS_Printf( "No file transfers\n" );
+}
+
+
+// By Client.
+// Send the selective ack of the window mode fragments of the file.
+static void  filetx_send_ack( fileneed_t * fnp, int filenum )
+{
+    filetx_ack_pak_t * ap = & netbuffer->u.filetxack;
+    int i;
+
+    ap->fileid = filenum;
+    ap->pad1 = 0;
+    ap->seq_base.b[0] = fnp->rx_base;
+    ap->seq_base.b[1] = fnp->rx_base >> 8;
+    for( i=0; i<8; i++ )
+        ap->bits[i] = fnp->rx_bits >> (i*8);
+    netbuffer->packettype = PT_FILEACK;
+    HSendPacket( cl_servernode, 0, 0, sizeof(filetx_ack_pak_t) );
+    fnp->rx_unacked = 0;
+}
 
 // By Client.
 // Incoming file fragments from server.
@@ -1030,6 +1527,172 @@ reject:
     return;
 }
 
+// By Client.
+// Incoming window mode file fragments from server, PT_FILEWINDOW.
+// Called by Net_Packet_Handler, unknown_host_handler.
+void Got_Filetx_Window(void)
+{
+#ifdef FILETX_ZLIB
+    static byte  raw[FILETX_RAW_MAX];
+#endif
+
+    filetx_win_pak_t * pak = & netbuffer->u.filetxwin;
+    int filenum = pak->fileid;
+    uint16_t seq = pak->seq_lo | (pak->seq_hi << 8);
+    uint32_t  position;
+    uint32_t  size;
+    int  n;  // window slot
+    byte * data;
+    tic_t  now;
+    fileneed_t * fnp;
+    char * fname; // filename
+    FILE * fp;
+
+    if( filenum < 0 || filenum >= cl_num_fileneed )
+    {
+        DEBFILE(va("filewindow fileid %d >= requested %d\n",filenum,cl_num_fileneed));
+        goto reject;
+    }
+
+    // The size must be within the received packet.
+    size = LE_SWAP16(pak->size);
+    if( (int)size > (int)doomcom->datalength - (int)(PACKET_BASE_SIZE + offsetof(filetx_win_pak_t, data)) )
+    {
+        DEBFILE(va("filewindow size %d > packet %d\n", size, doomcom->datalength));
+        goto reject;
+    }
+
+    fnp = & cl_fileneed[filenum];
+    if( fnp->status == FS_FOUND )
+    {
+        // Resent after done, the last ack was lost.
+        filetx_send_ack( fnp, filenum );
+        return;
+    }
+
+    if( fnp->status == FS_REQUESTED )
+    {
+        if(fnp->phandle)  goto file_already_open;
+
+        // Open the file.
+        fname = fnp->filename;
+        fp = fopen( fname,"wb" );
+        fnp->phandle = fp;  // owner of open file
+        if(!fp)  goto file_create_err;
+
+        GenPrintf(EMSG_hud, "\r%s ...", fname);
+        fnp->bytes_recv = 0; 
+        fnp->status = FS_DOWNLOADING;
+        fnp->rx_base = 0;
+        fnp->rx_bits = 0;
+        fnp->rx_unacked = 0;
+        fnp->rx_start_tic = fnp->rx_print_tic = I_GetTime();
+    }
+
+    if( fnp->status != FS_DOWNLOADING )
+    {
+        I_SoftError("Received a file not requested\n");
+        goto reject;
+    }
+
+    n = (int16_t)(seq - fnp->rx_base);
+    if( n < 0 || ( n < FILETX_WINDOW && ((fnp->rx_bits >> n) & 1) ) )
+    {
+        // Already have it, the ack was lost.
+        filetx_send_ack( fnp, filenum );
+        return;
+    }
+    if( n >= FILETX_WINDOW )
+        goto reject;
+
+    // Swap file position and size on big_endian machines.
+    position = LE_SWAP32(pak->position);
+    data = pak->data;
+
+    if( pak->flags & FTF_zlib )
+    {
+#ifdef FILETX_ZLIB
+        uLongf  rlen = FILETX_RAW_MAX;
+        if( uncompress( raw, &rlen, pak->data, size ) != Z_OK )
+            goto uncompress_err;
+        data = raw;
+        size = rlen;
+#else
+        goto uncompress_err;
+#endif
+    }
+
+    // File is finished only when have received all parts of it, in any order.
+    if( position & 0x80000000 ) 
+    {
+        // End of send file flag.
+        position &= ~0x80000000;
+        fnp->totalsize = position + size;
+    }
+    fp = fnp->phandle;  // file being loaded
+    fname = fnp->filename;  // for status and err msgs
+    fseek(fp, position, SEEK_SET);
+    if( size && fwrite(data, size, 1, fp) != 1 )
+       goto file_write_err;
+    fnp->bytes_recv += size;
+
+    fnp->rx_bits |= ((uint64_t)1) << n;
+    while( fnp->rx_bits & 1 )
+    {
+        fnp->rx_bits >>= 1;
+        fnp->rx_base++;
+    }
+
+    now = I_GetTime();
+    if( now - fnp->rx_print_tic >= TICRATE/2 )
+    {
+        // Update stats on screen.
+        tic_t dt = ( now > fnp->rx_start_tic )? now - fnp->rx_start_tic : 1;
+        fnp->rx_print_tic = now;
+        GenPrintf(EMSG_hud, "\r%s %dK/%dK %.1fK/s",
+                    fname,
+                    fnp->bytes_recv>>10,
+                    fnp->totalsize>>10,
+                    ((float)fnp->bytes_recv * TICRATE / dt)/1024);
+    }
+
+    // Detect when all of file received.
+    if(fnp->bytes_recv == fnp->totalsize)
+    {
+        fclose( fp );
+        fnp->phandle = NULL;
+        fnp->status = FS_FOUND;
+        GenPrintf(EMSG_hud, "\rDownloading %s ... (done)\n", fname);
+        update_download_done();
+        filetx_send_ack( fnp, filenum );
+        return;
+    }
+
+    if( ++fnp->rx_unacked >= FILETX_ACK_EVERY )
+        filetx_send_ack( fnp, filenum );
+    return;
+
+    // Rare errors.
+file_create_err:
+    I_SoftError("Got_Filetx_Window: File create error: %s\n", fname);
+    goto reject;
+
+file_write_err:
+    I_SoftError("Got_Filetx_Window: File write error: %s\n", fname);
+    goto reject;
+
+uncompress_err:
+    I_SoftError("Got_Filetx_Window: Uncompress error: %s\n", fnp->filename);
+    goto reject;
+
+file_already_open:
+    I_SoftError("Got_Filetx_Window: Received a file that is already open\n");
+    goto reject;
+   
+reject:
+    return;
+}
+
 // By Server, to cleanup sending files.
 // By Client, does nothing useful.
 //   nnode:  0..(MAXNETNODES-1)
@@ -1041,6 +1704,8 @@ void Abort_SendFiles(byte nnode)
         // By Server, only server have txlist set.
         SV_End_SendFile(nnode);
     }
+    transfer[nnode].caps = 0;
+    transfer[nnode].cwnd = 0;
 }
 
 // By Server, Client
@@ -85,12 +85,26 @@ boolean  CL_Load_ServerFiles(void);
 // For SendData
 #define SAVEGAME_FILEID   0
 
+// File transfer capabilities of a client.
+typedef enum {
+   FTC_window = 0x01,  // sliding window of fragments, selective ack
+   FTC_zlib   = 0x02,  // zlib compressed fragments
+} filetx_caps_e;
+
+// Return the FTC_ of this client.
+byte  CL_Filetx_Caps( void );
+// By Server, record the FTC_ of a client.
+void  SV_Filetx_Caps( byte nnode, byte caps );
+
 //void SV_SendFile(byte to_node, char *filename, char fileid);
 void SV_SendData(byte to_node, const char * name, byte *data, uint32_t size, TAH_e tah, char fileid);
 
 extern int Filetx_file_cnt;  // to enable call of Filetx_Ticker
 void Filetx_Ticker(void);
 void Got_Filetxpak(void);
+void Got_Filetx_Window(void);
+void Got_Filetx_Ack(byte nnode);
+void Command_Filetx_f(void);
 
 typedef enum {
    RFR_success,
@@ -61,6 +61,7 @@
 #include "i_system.h"
 #include "v_video.h"
 #include "m_argv.h"
+#include "m_profile.h"
 #include "i_video.h"
   // cv_fullscreen etc..
 
@@ -114,21 +115,6 @@ void I_UpdateNoBlit (void)
 }
 
 
-
-
-//profile stuff ---------------------------------------------------------
-//added:16-01-98:wanted to profile the VID_BlitLinearScreen() asm code.
-//#define TIMING      //uncomment this to enable profiling
-#ifdef TIMING
-#include "p5prof.h"
-static   long long mycount;
-static   long long mytotal = 0;
-static   unsigned long  nombre = TICRATE*10;
-//static   char runtest[10][80];
-#endif
-//profile stuff ---------------------------------------------------------
-
-
 //
 // I_FinishUpdate
 //
@@ -158,11 +144,6 @@ void I_FinishUpdate (void)
    }
 
 
-//added:16-01-98:profile screen blit.
-#ifdef TIMING
-    ProfZeroTimer();
-#endif
-
 #ifdef BLAST_VESA
     //added:08-01-98: support vesa1 bank change, without Allegro's BITMAP screen.
     if( gfx_use_vesa1 )
@@ -174,20 +155,13 @@ void I_FinishUpdate (void)
 #endif
     {
         // Standard Blit used by all ports.
+        PROF_ZONE( zt );
         VID_BlitLinearScreen ( vid.buffer, vid.direct,
                                vid.widthbytes, vid.height,  // copy area
                                vid.ybytes, vid.direct_rowbytes );  // scanline inc
+        PROF_END( zt, "VID_BlitLinearScreen" );
     }
 
-#ifdef TIMING
-    RDMSR(0x10,&mycount);
-    mytotal += mycount;   //64bit add
-
-    if(nombre--==0)
-       I_Error("ScreenBlit CPU Spy reports: 0x%d %d\n", *((int*)&mytotal+1),
-                                             (int)mytotal );
-#endif
-
 }
 
 
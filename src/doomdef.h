@@ -170,6 +170,10 @@
 #if defined( WIN32 ) && !defined( LAUNCHER )
 #define LAUNCHER
 #endif
+// Null video has no input, a launcher would wait forever.
+#ifdef SMIF_NULL_VIDEO
+#undef LAUNCHER
+#endif
 
 // [WDJ] Multiple config file, main and drawmode, with cvar tracking.
 // This enables editing them in the menus.
@@ -232,6 +236,31 @@
 #endif
 #endif
 
+#ifdef LINUX
+// Memory mapped wad files, enabled by -mmapwad.
+// Raw lumps are then read directly from the mapping, without a zone copy.
+#define MMAP_WAD
+#endif
+
+#if defined(LINUX) && defined(__GNUC__) && !defined(USEASM)
+// Software renderer draws in vertical strips using worker threads, r_threads.
+// The draw state (dc_, ds_, dr_) becomes thread local.
+// Not with USEASM, as the asm drawers use the draw state by absolute address.
+#define RENDER_THREADS
+#endif
+
+#if defined(__GNUC__) && !defined(USEASM) && !defined(RANGECHECK_DRAW_LIMITS) \
+    && ( defined(__x86_64__) || defined(__i386__) || defined(__aarch64__) )
+// SIMD span and column drawers, SSE2/AVX2 selected by cpu at runtime, NEON.
+// The plain C drawers are used with -nosimd.
+#define ENABLE_DRAW_SIMD
+#endif
+
+// Profiling zones, a capture is started and stopped by the profile
+// console command, and written as a Chrome trace.
+// When not capturing, each zone costs a flag test.
+#define PROFILE_ZONES
+
 // DeePsea tall patches.
 // Allows patches that exceed 254 height.
 // Not used by many wads, but not much extra code either.  Relatively safe.
@@ -244,6 +273,30 @@
 // Generate blockmap option and controls.
 #define GENERATE_BLOCKMAP
 
+// Generate a REJECT table when the map REJECT is missing or all zero.
+#define GENERATE_REJECT
+
+#if defined(LINUX) && defined(__GNUC__)
+// Level load stages that do not use the zone run on threads, while the
+// main thread loads the rest of the level.
+#define LOAD_THREADS
+#endif
+
+// Memo of P_CheckSight results, cleared every tic and when a plane moves.
+#define SIGHT_CACHE
+
+#if defined(LINUX) && defined(__GNUC__) && defined(SIGHT_CACHE)
+// Monster sight checks are done by worker threads before the thinkers
+// run, sight_threads.  Uses the P_CheckSight memo rules.
+#define SIGHT_THREADS
+#endif
+
+// Finer grid of the blockmap things, for the P_CheckPosition thing checks.
+#define THING_GRID
+
+// Keep the sector node list of a thing that moves within a box clear of lines.
+#define SECNODE_CLEARBOX
+
 // Generate options to vary map monsters and objects from the normal attributes.
 #define MAPTHING_ADJUST
 
@@ -402,7 +455,19 @@
 
 // Limit MAXPLAYERS (and others) to 250.
 // TODO: ... more!!!
+// A build profile can set fewer.
+#ifndef MAXPLAYERS
+#ifdef LARGE_LOBBY
+#define MAXPLAYERS              64
+#else
 #define MAXPLAYERS              32
+#endif
+#endif
+// The player masks have one bit for each player.
+// Demo and old lmp headers still hold 32 players.
+#if ( MAXPLAYERS > 64 ) || ( MAXPLAYERS & (MAXPLAYERS-1) )
+# error MAXPLAYERS must be a power of 2, and not more than 64
+#endif
 #define MAXSKINS                128
 #define PLAYERSMASK             (MAXPLAYERS-1)
 #define MAXPLAYERNAME           21
@@ -404,7 +404,8 @@ extern  int             bodyqueslot;
 
 //extern  ticcmd_t        localcmds[BACKUPTICS];
 
-extern  ticcmd_t        netcmds[BACKUPTICS][MAXPLAYERS];
+// [backup_tics][MAXPLAYERS], index by BTIC_INDEX
+extern  ticcmd_t        (*netcmds)[MAXPLAYERS];
 // Collect stats for netstat.
 extern int   stat_tic_moved, stat_tic_miss;
 
@@ -163,6 +163,7 @@
 #include "m_random.h"
 #include "p_local.h"
 #include "p_tick.h"
+#include "p_synclog.h"
 
 // SKY handling - still the wrong place.
 #include "r_data.h"
@@ -175,6 +176,9 @@
 
 #include "g_game.h"
 #include "g_input.h"
+#include "g_tdreport.h"
+#include "m_profile.h"
+  // M_Time_ns
 
 //added:16-01-98:quick hack test of rocket trails
 #include "p_fab.h"
@@ -579,7 +583,7 @@ consvar_t cv_allowexitlevel   = {"allowexitlevel", "1", CV_NETVAR, CV_YesNo, NUL
 // oof when hit 2s line (in PrBoom enabled by ! comp_sound)
 consvar_t cv_oof_2s = {"oof_2s", "0", CV_SAVE|CV_CALL, CV_OnOff, DemoAdapt_p_map};
 
-#if MAXPLAYERS>32
+#if MAXPLAYERS>64
 #error please update "player_name" table using the new value for MAXPLAYERS
 #endif
 #if MAXPLAYERNAME!=21
@@ -621,6 +625,41 @@ char    player_names[MAXPLAYERS][MAXPLAYERNAME] =
     "Player 30\0a123456789\0",
     "Player 31\0a123456789\0",
     "Player 32\0a123456789\0"
+#if MAXPLAYERS>32
+    ,
+    "Player 33\0a123456789\0",
+    "Player 34\0a123456789\0",
+    "Player 35\0a123456789\0",
+    "Player 36\0a123456789\0",
+    "Player 37\0a123456789\0",
+    "Player 38\0a123456789\0",
+    "Player 39\0a123456789\0",
+    "Player 40\0a123456789\0",
+    "Player 41\0a123456789\0",
+    "Player 42\0a123456789\0",
+    "Player 43\0a123456789\0",
+    "Player 44\0a123456789\0",
+    "Player 45\0a123456789\0",
+    "Player 46\0a123456789\0",
+    "Player 47\0a123456789\0",
+    "Player 48\0a123456789\0",
+    "Player 49\0a123456789\0",
+    "Player 50\0a123456789\0",
+    "Player 51\0a123456789\0",
+    "Player 52\0a123456789\0",
+    "Player 53\0a123456789\0",
+    "Player 54\0a123456789\0",
+    "Player 55\0a123456789\0",
+    "Player 56\0a123456789\0",
+    "Player 57\0a123456789\0",
+    "Player 58\0a123456789\0",
+    "Player 59\0a123456789\0",
+    "Player 60\0a123456789\0",
+    "Player 61\0a123456789\0",
+    "Player 62\0a123456789\0",
+    "Player 63\0a123456789\0",
+    "Player 64\0a123456789\0"
+#endif
 };
 
 
@@ -1677,7 +1716,7 @@ void G_Ticker (void)
        
     game_comp_tic++;  // For revenant tracers and RNG -- we must maintain sync
 
-    buf = gametic%BACKUPTICS;
+    buf = BTIC_INDEX( gametic );
 
     // read/write demo and check turbo cheat
     for (i=0 ; i<MAXPLAYERS ; i++)
@@ -1728,7 +1767,9 @@ main_actions:
       case GS_LEVEL:
         //IO_Color(0,255,0,0);
         // Apply player cmds to players, then run thinkers and level animations for this gametic.       
+        TDR_START( TDR_playsim );
         P_Ticker ();             // tic the game
+        TDR_END( TDR_playsim );
         //IO_Color(0,0,255,0);
         ST_Ticker ();
         AM_Ticker ();
@@ -3585,6 +3626,16 @@ void G_WriteDemoTiccmd (ticcmd_t* cmd,int playernum)
     char ziptic=0;
     byte *ziptic_p;
 
+#if MAXPLAYERS>32
+    if( playernum >= 32 )
+    {
+        // The demo format has 32 players, end the demo before this one.
+        GenPrintf( EMSG_warn, "Demo cannot record player %d, recording ended\n", playernum+1 );
+        G_CheckDemoStatus ();
+        return;
+    }
+#endif
+
     ziptic_p=demo_p++;  // the ziptic
                         // write at the end of this function
 
@@ -3669,6 +3720,20 @@ void G_BeginRecording (void)
     int             i;
     int rec_version = VERSION;
 
+#if MAXPLAYERS>32
+    // The demo format has 32 players, a demo with more cannot be played.
+    for (i=32 ; i<MAXPLAYERS ; i++)
+    {
+        if(playeringame[i])
+        {
+            GenPrintf( EMSG_warn, "Demo cannot record player %d, demo not recorded\n", i+1 );
+            Z_Free (demobuffer);
+            demorecording = false;
+            return;
+        }
+    }
+#endif
+
 #if 0
     // If ever need to record something other than VERSION
     // make sure they agree this time.
@@ -3705,7 +3770,8 @@ void G_BeginRecording (void)
     *demo_p++ = cv_timelimit.value;      // just to be compatible with old demo (no more used)
     *demo_p++ = multiplayer;             // 1..31
 
-    for (i=0 ; i<MAXPLAYERS ; i++)
+    // The demo header has 32 players.
+    for (i=0 ; i<32 ; i++)
     {
         if(playeringame[i])
           *demo_p++ = 1;
@@ -4284,10 +4350,6 @@ void G_DoPlayDemo (const char *defdemoname)
 
     if( demo_p > demoend )  goto broken_header;
 
-#if MAXPLAYERS>32
-#error Please add support for old lmps
-#endif
-
     // Read players in game.
     memset( playeringame, 0, sizeof(playeringame) );
     for (i=0 ; i<max_num_players ; i++)
@@ -4435,6 +4497,8 @@ void G_TimeDemo (const char* name)
     EV_restore_cv_vidwait = cv_vidwait.EV;
     if( cv_vidwait.EV )
         CV_Set( &cv_vidwait, "0");
+    if( M_CheckParm ("-timedemo_report") && M_IsNextParm() )
+        TDR_Open( M_GetNextParm() );  // per frame timing, as CSV
     timingdemo = true;
     singletics = true;
     framecount = 0;
@@ -4448,8 +4512,132 @@ void G_DoneLevelLoad(void)
     CONS_Printf("Load Level in %f sec\n",(float)(I_GetTime()-demostarttime)/TICRATE);
     framecount = 0;
     demostarttime = I_GetTime ();
+    TDR_Level_Start();
+}
+
+
+#ifdef THING_GRID
+// -thinggrid_bench num tics
+// Thing grid benchmark, a reproducible crowd for cv_thing_grid.
+// At the start map, spawns num monsters packed around the player start,
+// runs the playsim for tics, once with thing_grid 0 and once with 1,
+// reloading the map each time.  Prints the time and the sync hash of
+// each run, which must be the same, and quits.
+byte  thinggrid_bench_active = 0;
+
+static int  tgbench_monsters;
+static int  tgbench_tics;
+
+// Check for -thinggrid_bench.
+// Return true when the game must autostart.
+boolean  G_ThingGridBench_Init( void )
+{
+    if( ! M_CheckParm( "-thinggrid_bench" ) )
+        return false;
+
+    tgbench_monsters = ( M_IsNextParm() )? atoi( M_GetNextParm() ) : 300;
+    tgbench_tics = ( M_IsNextParm() )? atoi( M_GetNextParm() ) : (30 * TICRATE);
+    if( tgbench_monsters < 1 )
+        tgbench_monsters = 1;
+    if( tgbench_tics < 1 )
+        tgbench_tics = 1;
+    thinggrid_bench_active = 1;
+    return true;
 }
 
+// Spawn the monsters on a lattice, spiraling out from the player,
+// touching but not overlapping, so the blocks are crowded and
+// the monsters can still move.  Return the number spawned.
+static int  tgbench_spawn( mobj_t * pmo )
+{
+    mobjtype_t  type = ( EN_heretic )? MT_MUMMY : MT_POSSESSED;
+    fixed_t  spacing = mobjinfo[type].radius * 2;
+    int  count = 0;
+    int  ring, i, j;
+    mobj_t * mo;
+
+    for( ring = 1; ring < 64 && count < tgbench_monsters; ring++ )
+    {
+        for( j = -ring; j <= ring; j++ )
+        {
+            for( i = -ring; i <= ring; i++ )
+            {
+                if( abs(i) != ring && abs(j) != ring )
+                    continue;  // inside, done by a smaller ring
+                if( count >= tgbench_monsters )
+                    return count;
+
+                mo = P_SpawnMobj( pmo->x + i*spacing, pmo->y + j*spacing, ONFLOORZ, type );
+                if( ! P_CheckPosition( mo, mo->x, mo->y ) )
+                {
+                    P_RemoveMobj( mo );  // in a wall, or outside the map
+                    continue;
+                }
+                mo->angle = pmo->angle;
+                mo->target = pmo;
+                P_SetMobjState( mo, mo->info->seestate );
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+// Called after each game tic, by TryRunTics.
+// Runs the whole benchmark when the start map is loaded.  Does not return.
+void  G_ThingGridBench( void )
+{
+    char  mapname[MAX_WADPATH];
+    byte  restore_thing_grid = cv_thing_grid.EV;
+    uint32_t  hash[2];
+    uint64_t  start_ns, run_ns;
+    int  grid, tic, pn, spawned;
+
+    if( gamestate != GS_LEVEL )
+        return;
+    thinggrid_bench_active = 0;
+
+    if( game_map_filename[0] )
+        dl_strncpy( mapname, game_map_filename, MAX_WADPATH );
+    else
+        dl_strncpy( mapname, G_BuildMapName( gameepisode, gamemap ), MAX_WADPATH );
+
+    for( grid = 0; grid < 2; grid++ )
+    {
+        CV_SetValue( &cv_thing_grid, grid );
+        G_InitNew( gameskill, mapname, true );  // M_ClearRandom, same start
+        if( gamestate != GS_LEVEL || consoleplayer_ptr->mo == NULL )
+            I_Error( "Thing grid bench: cannot load %s\n", mapname );
+
+        consoleplayer_ptr->cheats |= CF_GODMODE;  // the monsters keep attacking
+        spawned = tgbench_spawn( consoleplayer_ptr->mo );
+
+        hash[grid] = 2166136261u;  // FNV-1a of every tic hash
+        start_ns = M_Time_ns();
+        for( tic = 0; tic < tgbench_tics; tic++ )
+        {
+            for( pn=0; pn<MAXPLAYERS; pn++ )
+                memset( &players[pn].cmd, 0, sizeof(ticcmd_t) );  // players stand still
+            P_Ticker();
+            hash[grid] = (hash[grid] ^ P_SyncLog_Hash()) * 16777619u;
+        }
+        run_ns = M_Time_ns() - start_ns;
+
+        GenPrintf( EMSG_info, "Thing grid bench: thing_grid %d, %s, %d monsters, %d tics in %d ms, tic avg %d us, hash %08X\n",
+                   grid, mapname, spawned, tgbench_tics,
+                   (int)(run_ns / 1000000), (int)(run_ns / tgbench_tics / 1000),
+                   hash[grid] );
+    }
+
+    CV_SetValue( &cv_thing_grid, restore_thing_grid );  // it is saved in the config
+
+    if( hash[0] != hash[1] )
+        I_Error( "Thing grid bench: thing_grid 0 and 1 differ, %08X %08X\n", hash[0], hash[1] );
+    GenPrintf( EMSG_info, "Thing grid bench: thing_grid 0 and 1 in sync\n" );
+    I_Quit();  // No return
+}
+#endif
+
 
 // Called after a death or level completion to allow demos to be cleaned up
 // reset engine variable set for the demos
@@ -4458,6 +4646,9 @@ void G_StopDemo(void)
 {
     Z_Free (demobuffer);
     demoplayback  = false;
+    if( timingdemo )
+        TDR_Finish();  // timedemo report
+    P_SyncLog_Close();
     timingdemo = false;
     singletics = false;
 
@@ -4504,7 +4695,10 @@ boolean G_CheckDemoStatus (void)
     if (demoplayback)
     {
         if (singledemo)
+        {
+            P_SyncLog_Close();
             I_Quit();  // No return
+        }
         G_StopDemo();
         D_AdvanceDemo ();
         return true;
@@ -264,6 +264,12 @@ void G_BeginRecording (void);
 void G_DoPlayDemo (const char *defdemoname);
 void G_TimeDemo (const char* name);
 void G_DoneLevelLoad(void);
+#ifdef THING_GRID
+// -thinggrid_bench num tics
+extern byte  thinggrid_bench_active;
+boolean  G_ThingGridBench_Init( void );
+void  G_ThingGridBench( void );
+#endif
 void G_StopDemo(void);
 boolean G_CheckDemoStatus (void);
 
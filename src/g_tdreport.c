@@ -0,0 +1,217 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 2024 by DooM Legacy Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+//
+// DESCRIPTION:
+//      Timedemo report, -timedemo_report file.csv
+//
+//   One CSV line per frame, with the wall time of the frame, and of each
+//   stage of the frame, in milliseconds.  Then the counts of visplanes,
+//   drawsegs, vissprites, and thinkers.
+//   The file ends with min, avg, and p99 lines for each time column.
+//
+//   With r_threads the wall and span draws are queued, and are drawn at
+//   the end of the view, so they are not in the walls and planes times.
+//
+//-----------------------------------------------------------------------------
+
+#include "doomincl.h"
+#include "g_tdreport.h"
+
+#include "doomstat.h"
+#include "g_game.h"
+#include "m_profile.h"
+  // M_Time_ns
+#include "p_tick.h"
+  // thinkercap
+#include "r_bsp.h"
+  // drawsegs, ds_p
+#include "r_plane.h"
+#include "r_things.h"
+
+
+byte  tdr_active = 0;
+
+uint64_t  tdr_stage_start[TDR_NUM_STAGE];
+uint64_t  tdr_stage_ns[TDR_NUM_STAGE];
+
+static FILE *  tdr_file = NULL;
+static uint64_t  tdr_frame_start;
+
+// Kept for the stats, frame time and then each stage, in nanoseconds.
+#define TDR_NUM_TIMES  (TDR_NUM_STAGE + 1)
+static uint32_t * tdr_times = NULL;
+static unsigned int  tdr_num_frames = 0;
+static unsigned int  tdr_alloc_frames = 0;
+
+static const char * tdr_time_names[TDR_NUM_TIMES] =
+   { "frame", "bsp", "walls", "planes", "masked", "playsim", "sound", "blit" };
+
+
+// -timedemo_report file, called before the timedemo starts.
+void  TDR_Open( const char * filename )
+{
+    int i;
+
+    if( tdr_file )
+        TDR_Finish();
+
+    tdr_file = fopen( filename, "w" );
+    if( ! tdr_file )
+    {
+        GenPrintf( EMSG_error, "Timedemo report: cannot open %s\n", filename );
+        return;
+    }
+
+    fprintf( tdr_file, "frame,gametic" );
+    for( i=0; i<TDR_NUM_TIMES; i++ )
+        fprintf( tdr_file, ",%s_ms", tdr_time_names[i] );
+    fprintf( tdr_file, ",visplanes,drawsegs,vissprites,thinkers\n" );
+
+    tdr_num_frames = 0;
+}
+
+// Timing starts when the demo level has loaded.
+void  TDR_Level_Start( void )
+{
+    if( ! tdr_file )
+        return;
+
+    memset( tdr_stage_ns, 0, sizeof(tdr_stage_ns) );
+    tdr_frame_start = M_Time_ns();
+    tdr_active = 1;
+}
+
+static int  count_thinkers( void )
+{
+    thinker_t * th;
+    int count = 0;
+
+    for( th = thinkercap.next; th != &thinkercap; th = th->next )
+        count++;
+    return count;
+}
+
+// Called after each frame is displayed.
+void  TDR_Frame_End( void )
+{
+    uint64_t  now = M_Time_ns();
+    uint64_t  frame_ns = now - tdr_frame_start;
+    uint32_t * tp;
+    int i;
+
+    tdr_frame_start = now;
+
+    // The walls are drawn during the BSP traversal.
+    if( tdr_stage_ns[TDR_bsp] > tdr_stage_ns[TDR_walls] )
+        tdr_stage_ns[TDR_bsp] -= tdr_stage_ns[TDR_walls];
+    else
+        tdr_stage_ns[TDR_bsp] = 0;
+
+    if( tdr_num_frames >= tdr_alloc_frames )
+    {
+        unsigned int  new_alloc = tdr_alloc_frames ? tdr_alloc_frames * 2 : 4096;
+        uint32_t * new_times = realloc( tdr_times, new_alloc * TDR_NUM_TIMES * sizeof(uint32_t) );
+        if( ! new_times )
+        {
+            GenPrintf( EMSG_error, "Timedemo report: out of memory\n" );
+            TDR_Finish();
+            return;
+        }
+        tdr_times = new_times;
+        tdr_alloc_frames = new_alloc;
+    }
+    tp = & tdr_times[ tdr_num_frames * TDR_NUM_TIMES ];
+    tp[0] = ( frame_ns > 0xFFFFFFFF )? 0xFFFFFFFF : frame_ns;
+    for( i=0; i<TDR_NUM_STAGE; i++ )
+        tp[i+1] = ( tdr_stage_ns[i] > 0xFFFFFFFF )? 0xFFFFFFFF : tdr_stage_ns[i];
+
+    fprintf( tdr_file, "%u,%u", tdr_num_frames, gametic );
+    for( i=0; i<TDR_NUM_TIMES; i++ )
+        fprintf( tdr_file, ",%.3f", tp[i] * 1.0e-6 );
+    fprintf( tdr_file, ",%i,%i,%i,%i\n",
+             R_Count_Visplanes(), (int)(ds_p - drawsegs),
+             R_Count_Vissprites(), count_thinkers() );
+
+    tdr_num_frames++;
+    memset( tdr_stage_ns, 0, sizeof(tdr_stage_ns) );
+}
+
+
+static int  cmp_uint32( const void * a, const void * b )
+{
+    uint32_t ua = *(const uint32_t*)a;
+    uint32_t ub = *(const uint32_t*)b;
+    return (ua > ub) - (ua < ub);
+}
+
+// At the end of the timedemo, write the stats, close the file.
+void  TDR_Finish( void )
+{
+    double  st_min[TDR_NUM_TIMES], st_avg[TDR_NUM_TIMES], st_p99[TDR_NUM_TIMES];
+    uint32_t * col;
+    unsigned int  n = tdr_num_frames;
+    unsigned int  f;
+    int i;
+
+    tdr_active = 0;
+    if( ! tdr_file )
+        return;
+
+    col = (n)? malloc( n * sizeof(uint32_t) ) : NULL;
+    if( col )
+    {
+        for( i=0; i<TDR_NUM_TIMES; i++ )
+        {
+            double sum = 0.0;
+            for( f=0; f<n; f++ )
+            {
+                col[f] = tdr_times[ f * TDR_NUM_TIMES + i ];
+                sum += col[f];
+            }
+            qsort( col, n, sizeof(uint32_t), cmp_uint32 );
+            st_min[i] = col[0] * 1.0e-6;
+            st_avg[i] = sum * 1.0e-6 / n;
+            st_p99[i] = col[ (n * 99) / 100 ] * 1.0e-6;
+        }
+        free( col );
+
+        fprintf( tdr_file, "min," );
+        for( i=0; i<TDR_NUM_TIMES; i++ )
+            fprintf( tdr_file, ",%.3f", st_min[i] );
+        fprintf( tdr_file, ",,,,\navg," );
+        for( i=0; i<TDR_NUM_TIMES; i++ )
+            fprintf( tdr_file, ",%.3f", st_avg[i] );
+        fprintf( tdr_file, ",,,,\np99," );
+        for( i=0; i<TDR_NUM_TIMES; i++ )
+            fprintf( tdr_file, ",%.3f", st_p99[i] );
+        fprintf( tdr_file, ",,,,\n" );
+
+        CONS_Printf( "Timedemo report: %u frames, frame ms min %.3f, avg %.3f, p99 %.3f\n",
+                     n, st_min[0], st_avg[0], st_p99[0] );
+    }
+
+    fclose( tdr_file );
+    tdr_file = NULL;
+
+    if( tdr_times )
+    {
+        free( tdr_times );
+        tdr_times = NULL;
+    }
+    tdr_num_frames = tdr_alloc_frames = 0;
+}
@@ -0,0 +1,64 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 2024 by DooM Legacy Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+//
+// DESCRIPTION:
+//      Timedemo report, per frame time of each stage, as CSV.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef G_TDREPORT_H
+#define G_TDREPORT_H
+
+#include "doomtype.h"
+#include "m_profile.h"
+  // M_Time_ns
+
+// Timed stages of a frame.
+typedef enum {
+   TDR_bsp,      // R_RenderBSPNode, without the walls
+   TDR_walls,    // R_StoreWallRange
+   TDR_planes,   // R_Draw_Planes
+   TDR_masked,   // R_Draw_Masked, and player sprites
+   TDR_playsim,  // P_Ticker
+   TDR_sound,    // S_UpdateSounds
+   TDR_blit,     // I_FinishUpdate
+   TDR_NUM_STAGE
+} tdr_stage_e;
+
+// Set while timing the frames of a timedemo report.
+extern byte  tdr_active;
+
+extern uint64_t  tdr_stage_start[TDR_NUM_STAGE];
+extern uint64_t  tdr_stage_ns[TDR_NUM_STAGE];
+
+// Stage timing, only when the report is active.
+#define TDR_START( stage ) \
+   { if( tdr_active )  tdr_stage_start[stage] = M_Time_ns(); }
+#define TDR_END( stage ) \
+   { if( tdr_active )  tdr_stage_ns[stage] += M_Time_ns() - tdr_stage_start[stage]; }
+
+// -timedemo_report file, called before the timedemo starts.
+void  TDR_Open( const char * filename );
+// Timing starts when the demo level has loaded.
+void  TDR_Level_Start( void );
+// Called after each frame is displayed.
+void  TDR_Frame_End( void );
+// At the end of the timedemo, write the stats, close the file.
+void  TDR_Finish( void );
+
+#endif
@@ -166,6 +166,9 @@ extern byte  (*I_NetGet) (void);
 extern byte  (*I_NetSend) (void);
 // Return true if network is ready to send.
 extern boolean (*I_NetCanSend) (void);
+// Hold the packets sent, to send them together.  May be NULL.
+//  hold : true to hold the sends, false to send the held packets
+extern void    (*I_NetSendBatch) (boolean hold);
 // Close the net node connection.
 extern void    (*I_NetFreeNode) (byte nodenum);
 // Open a net node connection with a specified address.
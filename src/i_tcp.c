@@ -117,6 +117,11 @@
 //
 //-----------------------------------------------------------------------------
 
+#if defined( LINUX ) && defined( __linux__ ) && !defined( _GNU_SOURCE )
+  // recvmmsg, sendmmsg
+# define _GNU_SOURCE
+#endif
+
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -154,11 +159,20 @@
 #include <sys/ioctl.h>
 #include <errno.h>
 #include <time.h>
+#ifdef __linux__
+# include <poll.h>
+#endif
 
 
 // Enable debug_Printf stmts
 //#define NET_NODE_DEBUG  1
 
+#if defined( LINUX ) && defined( __linux__ )
+// Linux: Receive and send batches of packets with recvmmsg and sendmmsg,
+// and poll only after a send would block.
+# define SOCK_MMSG
+#endif
+
 // Just some standard length for a char string
 #define STD_STRING_LEN    256
 
@@ -664,6 +678,29 @@ void SOCK_FreeNode( byte nnode )
 }
 
 
+#ifdef SOCK_MMSG
+// Receive ring, filled by recvmmsg, taken one packet at a time by SOCK_Get.
+#define RECV_BATCH   32
+static struct mmsghdr  recv_msg[RECV_BATCH];
+static struct iovec    recv_iov[RECV_BATCH];
+static mysockaddr_t    recv_addr[RECV_BATCH];
+static byte            recv_pak[RECV_BATCH][MAXPACKETLENGTH];
+static int  recv_num = 0;   // packets in the ring
+static int  recv_next = 0;  // next packet to take
+
+// Send batch, held by SOCK_Send_Batch, sent by sendmmsg.
+#define SEND_BATCH   64
+static struct mmsghdr  send_msg[SEND_BATCH];
+static struct iovec    send_iov[SEND_BATCH];
+static mysockaddr_t    send_addr[SEND_BATCH];
+static byte            send_pak[SEND_BATCH][MAXPACKETLENGTH];
+static int      send_num = 0;
+static boolean  send_hold = false;
+
+// A send would block, poll before the next send.
+static boolean  send_blocked = false;
+#endif
+
 //Hurdler: something is wrong with Robert's patch and win2k
 // Function for I_NetGet().
 // IPX or inet.  Server and client.
@@ -686,6 +723,40 @@ byte  SOCK_Get(void)
 #endif
     mysockaddr_t  fromaddress;
 
+#ifdef SOCK_MMSG
+    if( recv_next >= recv_num )
+    {
+        // Ring is empty, receive all the waiting packets.
+        int i;
+        for( i=0; i<RECV_BATCH; i++ )
+        {
+            recv_iov[i].iov_base = recv_pak[i];
+            recv_iov[i].iov_len = MAXPACKETLENGTH;
+            recv_msg[i].msg_hdr.msg_name = &recv_addr[i];
+            recv_msg[i].msg_hdr.msg_namelen = sizeof(mysockaddr_t);  // IN,OUT
+            recv_msg[i].msg_hdr.msg_iov = &recv_iov[i];
+            recv_msg[i].msg_hdr.msg_iovlen = 1;
+            recv_msg[i].msg_hdr.msg_control = NULL;
+            recv_msg[i].msg_hdr.msg_controllen = 0;
+            recv_msg[i].msg_hdr.msg_flags = 0;
+        }
+        recv_next = 0;
+        recv_num = recvmmsg(mysocket, recv_msg, RECV_BATCH, MSG_DONTWAIT, NULL);
+        if( recv_num <= 0 )
+        {
+            rcnt = recv_num;
+            recv_num = 0;
+            if( rcnt < 0 )  goto recv_err;
+            errno = EAGAIN;  // no message
+            goto recv_err;
+        }
+    }
+    fromlen = recv_msg[recv_next].msg_hdr.msg_namelen;
+    memcpy(&fromaddress, &recv_addr[recv_next], sizeof(fromaddress));
+    rcnt = recv_msg[recv_next].msg_len;
+    memcpy(&doomcom->data, recv_pak[recv_next], rcnt);
+    recv_next++;
+#else
     fromlen = sizeof(fromaddress);  // num bytes of addr for OUT
     // fromaddress: OUT the actual address.
     // fromlen: IN sizeof fromaddress, OUT the actual length of the address.
@@ -707,6 +778,7 @@ byte  SOCK_Get(void)
                     /*IN,OUT*/ &fromlen );  // net address length
 #endif
     if(rcnt < 0)  goto recv_err;
+#endif
     
 //    DEBFILE(va("Get from %s\n",SOCK_AddrToStr(&fromaddress)));
 
@@ -821,13 +893,30 @@ no_packet:
 }
 
 
+#ifndef SOCK_MMSG
 static fd_set  write_set;  // Linux: modified by select
+#endif
 
 // Function for I_NetCanSend().
 // Check if we can send (to save a buffer transfer).
 static
 boolean SOCK_CanSend(void)
 {
+#ifdef SOCK_MMSG
+    struct pollfd  pfd;
+
+    // The socket is non-blocking, a send that would block fails with EAGAIN.
+    // Only poll after that has happened, until the socket can send again.
+    if( ! send_blocked )
+        return true;
+
+    pfd.fd = mysocket;
+    pfd.events = POLLOUT;
+    pfd.revents = 0;
+    if( poll( &pfd, 1, 0 ) > 0 && (pfd.revents & POLLOUT) )
+        send_blocked = false;
+    return ! send_blocked;
+#else
     // [WDJ] Linux: select modifies timeval, so it must be init with each call.
     struct timeval timeval_0 = {0,0};  // immediate
     int stat;
@@ -850,8 +939,62 @@ boolean SOCK_CanSend(void)
                   /*IN,OUT*/ &timeval_0   // timeout
                  );
     return ( stat > 0 );
+#endif
+}
+
+#ifdef SOCK_MMSG
+// Send the held batch of packets.
+static void  SOCK_Send_Flush( void )
+{
+    int  i, cnt;
+    int  sent = 0;
+
+    for( i=0; i<send_num; i++ )
+    {
+        send_iov[i].iov_base = send_pak[i];
+        send_msg[i].msg_hdr.msg_name = &send_addr[i];
+        send_msg[i].msg_hdr.msg_namelen = sizeof(struct sockaddr);
+        send_msg[i].msg_hdr.msg_iov = &send_iov[i];
+        send_msg[i].msg_hdr.msg_iovlen = 1;
+        send_msg[i].msg_hdr.msg_control = NULL;
+        send_msg[i].msg_hdr.msg_controllen = 0;
+        send_msg[i].msg_hdr.msg_flags = 0;
+    }
+
+    while( sent < send_num )
+    {
+        cnt = sendmmsg(mysocket, &send_msg[sent], send_num - sent, MSG_DONTWAIT);
+        if( cnt > 0 )
+        {
+            sent += cnt;
+            continue;
+        }
+
+        if( errno == EWOULDBLOCK || errno == EAGAIN )
+        {
+            // The rest are lost, like a sendto that would block.
+            // Reliable packets will be resent.
+            send_blocked = true;
+            break;
+        }
+        // ECONNREFUSED can be got in linux port.
+        if( errno != ECONNREFUSED )
+            I_SoftError("SOCK_Send batch: %s\n", strerror(errno));
+        sent++;  // skip the failed packet
+    }
+    send_num = 0;
 }
 
+// Function for I_NetSendBatch().
+//  hold : true to hold the sends, false to send the held packets
+static void  SOCK_Send_Batch( boolean hold )
+{
+    send_hold = hold;
+    if( ! hold && send_num )
+        SOCK_Send_Flush();
+}
+#endif
+
 
 // Function for I_NetSend().
 // IPX or inet.
@@ -865,6 +1008,20 @@ byte  SOCK_Send(void)
                          
     if( node_hash[nnode] == 0 )   goto node_unconnected;
 
+#ifdef SOCK_MMSG
+    if( send_hold )
+    {
+        // Held, to be sent with the batch.
+        if( send_num >= SEND_BATCH )
+            SOCK_Send_Flush();
+        memcpy(&send_addr[send_num], &clientaddress[nnode], sizeof(mysockaddr_t));
+        memcpy(send_pak[send_num], &doomcom->data, doomcom->datalength);
+        send_iov[send_num].iov_len = doomcom->datalength;
+        send_num++;
+        return NE_success;
+    }
+#endif
+
     // sockaddr is defined in sys/socket.h
     // MSG_DONTROUTE: Do not use a gateway, local network only.
     // MSG_DONTWAIT: Do not block.
@@ -900,6 +1057,10 @@ send_err:
     if( errno2 == ECONNREFUSED || errno2 == EWOULDBLOCK || errno2 == EAGAIN )
 #endif
     {
+#ifdef SOCK_MMSG
+        if( errno2 != ECONNREFUSED )
+            send_blocked = true;
+#endif
         net_error = NE_refused_again;  // silent
         goto err_return;
     }
@@ -1316,6 +1477,12 @@ void SOCK_CloseSocket( void )
 #endif
         mysocket = -1;
     }
+#ifdef SOCK_MMSG
+    recv_num = recv_next = 0;
+    send_num = 0;
+    send_hold = false;
+    send_blocked = false;
+#endif
 }
 
 void I_Shutdown_TCP_Driver(void)
@@ -1460,6 +1627,11 @@ boolean SOCK_OpenSocket( void )
     I_NetCloseSocket = SOCK_CloseSocket;
     I_NetFreeNode    = SOCK_FreeNode;
     I_NetMakeNode    = SOCK_NetMakeNode;
+#ifdef SOCK_MMSG
+    I_NetSendBatch   = SOCK_Send_Batch;
+#else
+    I_NetSendBatch   = NULL;
+#endif
 
 #ifdef __WIN32__
     // seem like not work with libsocket nor linux :(
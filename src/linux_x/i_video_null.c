@@ -0,0 +1,496 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 2024 by DooM Legacy Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+//
+// DESCRIPTION:
+//      Null video, for headless timedemo and visual regression.
+//      Software render into a memory buffer, without any window system.
+//      No input events.
+//      Switch -dumpframes writes the frames as PNG or PPM files.
+//
+//-----------------------------------------------------------------------------
+
+#include "doomincl.h"
+  // stdlib, stdio, defines
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+
+#include "doomstat.h"
+#include "i_system.h"
+#include "i_video.h"
+#include "v_video.h"
+  // vid_mode_table, V_CanDraw
+#include "m_argv.h"
+#include "m_misc.h"
+  // Write_PPM, Write_PNG
+#include "screen.h"
+  // pixel24_t, pixel32_t
+#include "g_input.h"
+
+
+// Null video modes, all are both window and fullscreen.
+#define NUM_NULLMODES  (10)
+static int nullModes[NUM_NULLMODES+1][2] = {
+   // hidden from display
+   {INITIAL_WINDOW_WIDTH, INITIAL_WINDOW_HEIGHT},  // initial mode
+   // public  1..
+   {1920, 1080},
+   {1600, 1200},
+   {1280, 1024},
+   {1280,  720},
+   {1024,  768},
+   { 800,  600},
+   { 640,  480},
+   { 640,  400},
+   { 400,  300},
+   { 320,  200}
+};
+
+#define MAX_LEN_VIDMODENAME    32
+static char vidModeName[NUM_NULLMODES+1][MAX_LEN_VIDMODENAME+1];
+
+// Last palette set, for 8 bit frame dumps.
+static RGBA_t  null_palette[256];
+
+// Frame dump, -dumpframes
+static int      dump_interval = 0;  // every n frames, 0 is off
+static boolean  dump_png = false;
+static uint32_t frame_count = 0;
+static byte *   dump_rgb = NULL;  // RGB conversion buffer
+
+
+//
+// I_StartFrame
+//
+void I_StartFrame(void)
+{
+}
+
+void I_GetEvent(void)
+{
+    // no input device
+}
+
+void I_UngrabMouse(void)
+{
+}
+
+void I_StartupMouse( boolean play_mode )
+{
+}
+
+//
+// I_OsPolling
+//
+void I_OsPolling(void)
+{
+}
+
+
+//
+// I_UpdateNoBlit
+//
+void I_UpdateNoBlit(void)
+{
+}
+
+
+// Convert the display to 24 bit RGB, and write it.
+static void dump_frame( void )
+{
+    char   filename[32];
+    byte * dp = dump_rgb;
+    byte * src;
+    int x, y;
+    boolean br;
+
+    if( ! dump_rgb )
+    {
+        dump_rgb = malloc( vid.width * vid.height * 3 );
+        if( ! dump_rgb )
+            I_Error( "Dumpframes: cannot allocate %ix%i\n", vid.width, vid.height );
+        dp = dump_rgb;
+    }
+
+    for( y=0; y<vid.height; y++ )
+    {
+        src = vid.display + (y * vid.ybytes);
+        switch( vid.bitpp )
+        {
+         case 8:
+            for( x=0; x<vid.width; x++ )
+            {
+                RGBA_t * pc = & null_palette[ src[x] ];
+                *(dp++) = pc->s.red;
+                *(dp++) = pc->s.green;
+                *(dp++) = pc->s.blue;
+            }
+            break;
+         case 15:
+            for( x=0; x<vid.width; x++ )
+            {
+                uint16_t rgb555 = ((uint16_t*)src)[x];
+                *(dp++) = (rgb555 & 0x7C00) >> (10-3);
+                *(dp++) = (rgb555 & 0x03E0) >> (5-3);
+                *(dp++) = (rgb555 & 0x001F) << 3;
+            }
+            break;
+         case 16:
+            for( x=0; x<vid.width; x++ )
+            {
+                uint16_t rgb565 = ((uint16_t*)src)[x];
+                *(dp++) = (rgb565 & 0xF800) >> (11-3);
+                *(dp++) = (rgb565 & 0x07E0) >> (5-2);
+                *(dp++) = (rgb565 & 0x001F) << 3;
+            }
+            break;
+         case 24:
+            for( x=0; x<vid.width; x++ )
+            {
+                pixel24_t * p24 = & ((pixel24_t*)src)[x];
+                *(dp++) = p24->r;
+                *(dp++) = p24->g;
+                *(dp++) = p24->b;
+            }
+            break;
+         case 32:
+            for( x=0; x<vid.width; x++ )
+            {
+                pixel32_t * p32 = & ((pixel32_t*)src)[x];
+                *(dp++) = p32->r;
+                *(dp++) = p32->g;
+                *(dp++) = p32->b;
+            }
+            break;
+         default:
+            return;
+        }
+    }
+
+#if defined( HAVE_ZLIB ) && ( HAVE_ZLIB == 1 )
+    if( dump_png )
+    {
+        snprintf( filename, sizeof(filename), "frame%06u.png", frame_count );
+        br = Write_PNG( filename, vid.width, vid.height, dump_rgb );
+    }
+    else
+#endif
+    {
+        snprintf( filename, sizeof(filename), "frame%06u.ppm", frame_count );
+        br = Write_PPM( filename, vid.width, vid.height, dump_rgb );
+    }
+
+    if( ! br )
+    {
+        GenPrintf( EMSG_error, "Dumpframes: write %s failed, stopped\n", filename );
+        dump_interval = 0;
+    }
+}
+
+//
+// I_FinishUpdate
+//
+void I_FinishUpdate(void)
+{
+    // The frame is already in memory, there is nothing to show.
+    if( dump_interval && (frame_count % dump_interval) == 0 )
+        dump_frame();
+
+    frame_count++;
+}
+
+
+//
+// I_ReadScreen
+//
+void I_ReadScreen(byte* scr)
+{
+    memcpy (scr, vid.display, vid.screen_size);
+}
+
+
+//
+// I_SetPalette
+//
+void I_SetPalette(RGBA_t* palette)
+{
+    memcpy( null_palette, palette, sizeof(null_palette) );
+}
+
+
+// return number of fullscreen or window modes, for listing
+// modetype is of modetype_e
+range_t  VID_ModeRange( byte modetype )
+{
+    range_t  mrange = { 1, NUM_NULLMODES };
+    return mrange;
+}
+
+
+modestat_t  VID_GetMode_Stat( modenum_t modenum )
+{
+    modestat_t  ms;
+    int mi = modenum.index;
+
+    if( mi > NUM_NULLMODES )
+    {
+        ms.type = MODE_NOP;
+        ms.width = ms.height = 0;
+        ms.mark = NULL;
+        return ms;
+    }
+
+    ms.width = nullModes[mi][0];
+    ms.height = nullModes[mi][1];
+    ms.type = modenum.modetype;
+    ms.mark = "null";
+    return ms;
+}
+
+
+// to display selection name of modes
+char * VID_GetModeName( modenum_t modenum )
+{
+    modestat_t ms = VID_GetMode_Stat( modenum );
+    if( ! ms.mark )
+        return NULL;
+
+    snprintf( &vidModeName[modenum.index][0], MAX_LEN_VIDMODENAME, "%s %dx%d",
+              ms.mark, ms.width, ms.height );
+    vidModeName[modenum.index][MAX_LEN_VIDMODENAME] = 0;
+    return &vidModeName[modenum.index][0];
+}
+
+
+// rmodetype is of modetype_e
+// Returns MODE_NOP when none found
+modenum_t  VID_GetModeForSize( int rw, int rh, byte rmodetype )
+{
+    modenum_t  modenum;
+    int bestdist = INT_MAX;
+    int best = NUM_NULLMODES;  // default
+    int tdist, i;
+
+    for (i = 1; i <= NUM_NULLMODES; i++)
+    {
+        tdist = abs(nullModes[i][0] - rw) + abs(nullModes[i][1] - rh);
+        // find closest dist
+        if( bestdist > tdist )
+        {
+            bestdist = tdist;
+            best = i;
+            if( tdist == 0 )  break;   // found exact match
+        }
+    }
+    modenum.index = best;  // 1..
+    modenum.modetype = rmodetype;
+    return modenum;
+}
+
+
+static void free_screen(void)
+{
+    if( vid.buffer )
+    {
+        free(vid.buffer);
+        vid.buffer = vid.direct = NULL;
+        vid.display = NULL;
+        vid.screen1 = NULL;
+    }
+
+    if( dump_rgb )
+    {
+        free( dump_rgb );
+        dump_rgb = NULL;
+    }
+}
+
+// Allocate the memory screen, at vid.width, vid.height, vid.bytepp.
+static void create_screen(void)
+{
+    free_screen();
+
+    vid.widthbytes = vid.width * vid.bytepp;
+    vid.ybytes = vid.widthbytes;
+    vid.screen_size = vid.ybytes * vid.height;
+
+    vid.buffer = (unsigned char *) malloc (vid.screen_size * NUMSCREENS);
+    if( ! vid.buffer )
+        I_Error( "Null video: cannot allocate %ix%i screen\n", vid.width, vid.height );
+    vid.display = vid.buffer;
+    vid.screen1 = vid.buffer + vid.screen_size;
+    // Direct is the buffer
+    vid.direct = vid.buffer;
+    vid.direct_rowbytes = vid.ybytes;
+    vid.direct_size = vid.screen_size;
+
+    V_Setup_VideoDraw();
+}
+
+
+int VID_SetMode( modenum_t modenum )
+{
+    int mi = modenum.index;
+    if( mi > NUM_NULLMODES )
+        return FAIL_end;
+
+    vid.draw_ready = 0;  // disable print reaching console
+
+    vid.width = nullModes[mi][0];
+    vid.height = nullModes[mi][1];
+    vid.recalc = 1;
+    GenPrintf( EMSG_info, "VID_SetMode(%s,%i) %dx%d\n",
+               modetype_string[modenum.modetype], modenum.index, vid.width, vid.height);
+
+    create_screen();
+    vid.fullscreen = (modenum.modetype == MODE_fullscreen);
+    vid.modenum = modenum;
+    graphics_state = VGS_active;
+    return 1;
+}
+
+
+//   request_drawmode : vid_drawmode_e
+//   request_fullscreen : true if want fullscreen modes
+//   request_bitpp : bits per pixel
+// Return true if there are viable modes.
+boolean  VID_Query_Modelist( byte request_drawmode, byte request_fullscreen, byte request_bitpp )
+{
+    // No hardware draw modes.
+    if( request_drawmode >= DRM_opengl )
+        return false;
+
+    // Can draw any bpp that the engine can.
+    return V_CanDraw( request_bitpp );
+}
+
+
+// Setup HWR calls according to rendermode.
+int I_Rendermode_setup( void )
+{
+    // Software render only.
+    rendermode = render_soft;
+    return 1;
+}
+
+
+// Called once. Init with basic error message screen.
+void I_StartupGraphics(void)
+{
+    modenum_t  initialmode = {MODE_window,0};  // the initial mode
+    // pre-init by V_Init_VideoControl
+
+    vid.draw_ready = 0;  // disable print reaching console
+    graphics_state = VGS_startup;
+
+    // FIXME: catch other signals as well?
+    signal(SIGINT, (void (*)(int)) I_Quit);
+    signal(SIGTERM, (void (*)(int)) I_Quit); // shutdown gracefully if terminated
+
+    // Palette draw is the classic render.
+    native_drawmode = DRM_native;
+    native_bitpp = 8;
+    native_bytepp = 1;
+    vid.bitpp = 8;
+    vid.bytepp = 1;
+
+    if( M_CheckParm("-dumpframes") && M_IsNextParm() )
+    {
+        dump_interval = atoi( M_GetNextParm() );
+        if( dump_interval < 0 )
+            dump_interval = 0;
+#if defined( HAVE_ZLIB ) && ( HAVE_ZLIB == 1 )
+        dump_png = true;
+        if( M_IsNextParm() && strcasecmp( M_GetNextParm(), "ppm" ) == 0 )
+            dump_png = false;
+#endif
+        if( dump_interval )
+            GenPrintf(EMSG_info, "Dump every %i frames as %s\n",
+                      dump_interval, (dump_png? "PNG":"PPM") );
+    }
+
+    GenPrintf(EMSG_info, "Video null: %i bpp (%i bytes)\n", vid.bitpp, vid.bytepp);
+
+    create_screen();
+
+    if( verbose )
+        GenPrintf(EMSG_ver, "StartupGraphics completed\n" );
+
+    vid.modenum = initialmode;
+    vid.recalc = true;
+    graphics_state = VGS_active;
+}
+
+
+// Called to start rendering graphic screen according to the request switches.
+// Fullscreen modes are possible.
+// param: req_drawmode, req_bitpp, req_alt_bitpp, req_width, req_height.
+// Returns FAIL_select, FAIL_end, FAIL_create, of status_return_e, 1 on success;
+int I_RequestFullGraphics( byte select_fullscreen )
+{
+    modenum_t  initialmode;
+    byte  select_fullscreen_mode;
+
+    vid.draw_ready = 0;  // disable print reaching console
+    graphics_state = VGS_startup;
+
+    switch(req_drawmode)
+    {
+     case DRM_explicit_bpp:
+       if( ! V_CanDraw( req_bitpp ) )
+       {
+           GenPrintf(EMSG_error, "Cannot draw %i bpp\n", req_bitpp );
+           return FAIL_select;
+       }
+       vid.bitpp = req_bitpp;
+       vid.bytepp = (req_bitpp + 7) >> 3;
+       break;
+
+     case DRM_native:
+     default:
+       vid.bitpp = native_bitpp;
+       vid.bytepp = native_bytepp;
+       break;
+    }
+
+    select_fullscreen_mode = vid_mode_table[select_fullscreen];
+    initialmode = VID_GetModeForSize( req_width, req_height, select_fullscreen_mode );
+    if( VID_SetMode( initialmode ) < 0 )
+        return FAIL_create;
+
+    if( verbose )
+        GenPrintf(EMSG_ver, "RequestFullGraphics completed\n" );
+
+    vid.recalc = true;
+    graphics_state = VGS_fullactive;
+    return 1;
+}
+
+
+void I_ShutdownGraphics(void)
+{
+    if( graphics_state <= VGS_shutdown )
+        return;
+
+    graphics_state = VGS_shutdown;  // to catch some repeats due to errors
+
+    free_screen();
+
+    graphics_state = VGS_off;
+}
@@ -6302,6 +6302,7 @@ void M_Init (void)
     CV_RegisterVar(&cv_netrepair);
     CV_RegisterVar(&cv_SV_download_files);
     CV_RegisterVar(&cv_SV_download_savegame);
+    CV_RegisterVar(&cv_SV_filetx_rate);
     CV_RegisterVar(&cv_SV_netrepair);
     CV_RegisterVar(&cv_menusound);
     CV_RegisterVar(&cv_oof_2s);
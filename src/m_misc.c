@@ -850,6 +850,121 @@ write_fail:
 }
 
 
+// --------------------------------------------------------------------------
+// save frame images with PPM and PNG format
+// --------------------------------------------------------------------------
+
+// Write a 24 bit RGB image, as binary PPM.
+//   rgb : width*height pixels, each byte order (R,G,B), top row first
+boolean  Write_PPM( const char * filename, int width, int height, byte* rgb )
+{
+    int fd;
+    int hdr_len;
+    size_t count, size;
+    char hdr[40];
+
+    fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0666);
+    if (fd < 0)
+        return false;
+
+    hdr_len = snprintf( hdr, sizeof(hdr), "P6\n%d %d\n255\n", width, height );
+    count = write(fd, hdr, hdr_len);
+    if( count != hdr_len )  goto write_fail;
+
+    size = (size_t)width * height * 3;
+    count = write(fd, rgb, size);
+    if( count != size )  goto write_fail;
+
+    close(fd);
+    return true;
+
+write_fail:
+    close(fd);
+    return false;
+}
+
+#if defined( HAVE_ZLIB ) && ( HAVE_ZLIB == 1 )
+#include <zlib.h>
+
+// PNG is big-endian.
+static void  png_put32( byte * p, uint32_t v )
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+// Write a PNG chunk, the data is at buf+8, with room for the crc after it.
+static boolean  png_write_chunk( int fd, const char * type, byte * buf, uint32_t len )
+{
+    size_t count;
+
+    png_put32( &buf[0], len );
+    memcpy( &buf[4], type, 4 );
+    png_put32( &buf[8+len], crc32( crc32(0, NULL, 0), &buf[4], len+4 ) );
+    count = write(fd, buf, len+12);
+    return ( count == len+12 );
+}
+
+// Write a 24 bit RGB image, as PNG.
+//   rgb : width*height pixels, each byte order (R,G,B), top row first
+boolean  Write_PNG( const char * filename, int width, int height, byte* rgb )
+{
+    static const byte png_sig[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    int fd = -1;
+    int y;
+    size_t rowbytes = (size_t)width * 3;
+    size_t rawsize = (rowbytes + 1) * height;
+    uLongf zsize = compressBound( rawsize );
+    byte * raw = malloc( rawsize );
+    byte * chunk = malloc( zsize + 12 );
+    byte * rp;
+    boolean br = false;
+
+    if( !raw || !chunk )  goto done;
+
+    // Every row is prefixed by filter type 0, none.
+    rp = raw;
+    for( y=0; y<height; y++ )
+    {
+        *(rp++) = 0;
+        memcpy( rp, &rgb[ y * rowbytes ], rowbytes );
+        rp += rowbytes;
+    }
+
+    fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0666);
+    if (fd < 0)
+        goto done;
+
+    if( write(fd, png_sig, 8) != 8 )  goto done;
+
+    // IHDR: width, height, bit depth 8, color type 2 (RGB),
+    // compression 0, filter 0, no interlace.
+    png_put32( &chunk[8], width );
+    png_put32( &chunk[12], height );
+    chunk[16] = 8;
+    chunk[17] = 2;
+    chunk[18] = chunk[19] = chunk[20] = 0;
+    if( ! png_write_chunk( fd, "IHDR", chunk, 13 ) )  goto done;
+
+    // Fast compression, this is written every frame.
+    if( compress2( &chunk[8], &zsize, raw, rawsize, Z_BEST_SPEED ) != Z_OK )
+        goto done;
+    if( ! png_write_chunk( fd, "IDAT", chunk, zsize ) )  goto done;
+
+    if( ! png_write_chunk( fd, "IEND", chunk, 0 ) )  goto done;
+    br = true;
+
+done:
+    if( fd >= 0 )  close(fd);
+    if( raw )  free(raw);
+    if( chunk )  free(chunk);
+    return br;
+}
+#endif
+
+
 // indexed by drawmode:  DRAW8PAL, DRAW15, DRAW16, DRAW24, DRAW32
 
 //
@@ -91,6 +91,12 @@ boolean FIL_CheckExtension (const char * in);
 
 void M_ScreenShot (void);
 
+// Write 24 bit RGB images, (R,G,B) byte order.
+boolean  Write_PPM( const char * filename, int width, int height, byte* rgb );
+#if defined( HAVE_ZLIB ) && ( HAVE_ZLIB == 1 )
+boolean  Write_PNG( const char * filename, int width, int height, byte* rgb );
+#endif
+
 //===========================================================================
 
 extern char * configfile_main;
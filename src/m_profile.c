@@ -0,0 +1,282 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 2024 by DooM Legacy Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+//
+// DESCRIPTION:
+//      Profiling zones, and the nanosecond clock.
+//
+//   A zone records its name, start, and end clock into a ring buffer
+//   owned by the thread, so recording needs no lock.  When a ring is
+//   full the oldest zones are overwritten.
+//   The console command  profile start  clears the rings, and
+//   profile stop  writes them as a Chrome trace (chrome://tracing,
+//   or ui.perfetto.dev).
+//
+//-----------------------------------------------------------------------------
+
+#include "doomincl.h"
+#include "m_profile.h"
+
+#ifdef WIN32
+# include <windows.h>
+#else
+# include <time.h>
+# include <sys/time.h>
+#endif
+
+#ifdef PROFILE_ZONES
+#include "command.h"
+#include "console.h"
+#endif
+
+
+uint64_t  M_Time_ns( void )
+{
+#ifdef WIN32
+    static LARGE_INTEGER  freq = { 0 };
+    LARGE_INTEGER  count;
+    if( freq.QuadPart == 0 )
+        QueryPerformanceFrequency( &freq );
+    QueryPerformanceCounter( &count );
+    return (uint64_t)( (double)count.QuadPart * 1.0e9 / (double)freq.QuadPart );
+#elif defined( CLOCK_MONOTONIC )
+    struct timespec  ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ((uint64_t)ts.tv_sec * 1000000000) + ts.tv_nsec;
+#else
+    struct timeval  tv;
+    gettimeofday( &tv, NULL );
+    return ((uint64_t)tv.tv_sec * 1000000000) + ((uint64_t)tv.tv_usec * 1000);
+#endif
+}
+
+
+#ifdef PROFILE_ZONES
+
+#if defined( __GNUC__ )
+# define PROF_TLS   __thread
+# define PROF_ATOMIC_INC( var )   __sync_fetch_and_add( &(var), 1 )
+#elif defined( _MSC_VER )
+# define PROF_TLS   __declspec(thread)
+# define PROF_ATOMIC_INC( var )   (InterlockedIncrement( (LONG*)&(var) ) - 1)
+#else
+// Single thread only.
+# define PROF_TLS
+# define PROF_ATOMIC_INC( var )   ((var)++)
+#endif
+
+#define PROF_MAX_THREADS   32
+#define PROF_RING_SIZE     (64*1024)   // zones per thread, power of 2
+
+typedef struct {
+    const char * name;
+    uint64_t     start, end;
+} prof_event_t;
+
+typedef struct {
+    prof_event_t * events;  // PROF_RING_SIZE
+    unsigned int   head;    // count of zones recorded
+    byte           main;    // is the main thread
+} prof_ring_t;
+
+byte  prof_capture = 0;
+
+static prof_ring_t  prof_rings[PROF_MAX_THREADS];
+static volatile int  prof_num_rings = 0;
+
+static PROF_TLS prof_ring_t * prof_thread_ring = NULL;
+static PROF_TLS byte  prof_thread_main = 0;
+
+static uint64_t  prof_start_clock, prof_start_ns;
+
+
+static prof_ring_t *  prof_get_ring( void )
+{
+    prof_ring_t * rp;
+    int index = PROF_ATOMIC_INC( prof_num_rings );
+
+    if( index >= PROF_MAX_THREADS )
+        return NULL;
+
+    rp = & prof_rings[index];
+    // Not Z_Malloc, the zone is not thread safe.
+    rp->events = malloc( PROF_RING_SIZE * sizeof(prof_event_t) );
+    rp->head = 0;
+    rp->main = prof_thread_main;
+    prof_thread_ring = rp;
+    return rp;
+}
+
+void  M_Prof_Record( const char * name, uint64_t start, uint64_t end )
+{
+    prof_ring_t * rp = prof_thread_ring;
+    prof_event_t * ev;
+
+    if( ! prof_capture )
+        return;  // stopped during the zone
+
+    if( ! rp )
+    {
+        rp = prof_get_ring();
+        if( ! rp )
+            return;
+    }
+    if( ! rp->events )
+        return;
+
+    ev = & rp->events[ rp->head & (PROF_RING_SIZE-1) ];
+    ev->name = name;
+    ev->start = start;
+    ev->end = end;
+    rp->head++;
+}
+
+
+// The render threads only record while the main thread waits for them,
+// so the rings are not written during start and stop.
+static void  prof_start( void )
+{
+    int i;
+    int num_rings = prof_num_rings;
+
+    if( num_rings > PROF_MAX_THREADS )
+        num_rings = PROF_MAX_THREADS;
+    for( i=0; i<num_rings; i++ )
+        prof_rings[i].head = 0;
+
+    prof_start_ns = M_Time_ns();
+    prof_start_clock = M_Prof_Clock();
+    prof_capture = 1;
+    CONS_Printf( "Profile capture started\n" );
+}
+
+static void  prof_stop( const char * filename )
+{
+    FILE * fp;
+    double  clock_per_us;
+    uint64_t  end_clock, end_ns;
+    unsigned int  num_events = 0, num_lost = 0;
+    int i;
+    int num_rings = prof_num_rings;
+    byte  first = 1;
+
+    prof_capture = 0;
+    end_clock = M_Prof_Clock();
+    end_ns = M_Time_ns();
+
+#ifdef PROF_RDTSC
+    // Calibrate the cycle clock over the capture.
+    clock_per_us = ( end_ns > prof_start_ns )?
+       (double)(end_clock - prof_start_clock) * 1000.0 / (double)(end_ns - prof_start_ns)
+       : 1000.0;
+    if( clock_per_us <= 0.0 )
+        clock_per_us = 1000.0;
+#else
+    clock_per_us = 1000.0;
+#endif
+
+    fp = fopen( filename, "w" );
+    if( ! fp )
+    {
+        GenPrintf( EMSG_error, "Profile: cannot write %s\n", filename );
+        return;
+    }
+
+    if( num_rings > PROF_MAX_THREADS )
+        num_rings = PROF_MAX_THREADS;
+
+    fprintf( fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" );
+    for( i=0; i<num_rings; i++ )
+    {
+        prof_ring_t * rp = & prof_rings[i];
+        unsigned int  n, first_ev;
+
+        if( ! rp->events )
+            continue;
+
+        fprintf( fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%i,"
+                     "\"args\":{\"name\":\"%s %i\"}}",
+                 (first? "":",\n"), i, (rp->main? "main":"thread"), i );
+        first = 0;
+
+        first_ev = 0;
+        if( rp->head > PROF_RING_SIZE )
+        {
+            first_ev = rp->head - PROF_RING_SIZE;
+            num_lost += first_ev;
+        }
+        for( n = first_ev; n < rp->head; n++ )
+        {
+            prof_event_t * ev = & rp->events[ n & (PROF_RING_SIZE-1) ];
+            if( ev->start < prof_start_clock )
+                continue;  // started before the capture
+            fprintf( fp, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%i,"
+                         "\"ts\":%.3f,\"dur\":%.3f}",
+                     ev->name, i,
+                     (double)(ev->start - prof_start_clock) / clock_per_us,
+                     (double)(ev->end - ev->start) / clock_per_us );
+            num_events++;
+        }
+    }
+    fprintf( fp, "\n]}\n" );
+    fclose( fp );
+
+    CONS_Printf( "Profile: %u zones, %.3f sec, written to %s\n",
+                 num_events, (double)(end_ns - prof_start_ns) * 1.0e-9, filename );
+    if( num_lost )
+        CONS_Printf( "Profile: %u oldest zones were overwritten\n", num_lost );
+}
+
+// profile start
+// profile stop [file.json]
+static void  Command_Profile_f( void )
+{
+    COM_args_t  carg;
+
+    COM_Args( &carg );
+
+    if( carg.num >= 2 && strcasecmp( carg.arg[1], "start" ) == 0 )
+    {
+        prof_start();
+        return;
+    }
+
+    if( carg.num >= 2 && strcasecmp( carg.arg[1], "stop" ) == 0 )
+    {
+        if( ! prof_capture )
+        {
+            CONS_Printf( "Profile capture is not running\n" );
+            return;
+        }
+        prof_stop( (carg.num >= 3)? carg.arg[2] : "profile.json" );
+        return;
+    }
+
+    CONS_Printf( "profile start : start a capture of the profile zones\n"
+                 "profile stop [file.json] : stop, write a Chrome trace\n" );
+    if( prof_capture )
+        CONS_Printf( "Profile capture is running\n" );
+}
+
+// Called from the main thread.
+void  M_Profile_Register( void )
+{
+    prof_thread_main = 1;
+    COM_AddCommand( "profile", Command_Profile_f, CC_command );
+}
+
+#endif
@@ -0,0 +1,73 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 2024 by DooM Legacy Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+//
+// DESCRIPTION:
+//      Profiling zones, and the nanosecond clock.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef M_PROFILE_H
+#define M_PROFILE_H
+
+#include "doomdef.h"
+  // PROFILE_ZONES
+#include "doomtype.h"
+
+// Monotonic clock, in nanoseconds.
+uint64_t  M_Time_ns( void );
+
+#ifdef PROFILE_ZONES
+
+// Set while a capture is running.
+extern byte  prof_capture;
+
+// The zone clock, cpu cycles when there is rdtsc, otherwise nanoseconds.
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+#define PROF_RDTSC
+static inline uint64_t  M_Prof_Clock( void )
+{
+    return __builtin_ia32_rdtsc();
+}
+#else
+#define M_Prof_Clock()   M_Time_ns()
+#endif
+
+// Record a zone, with its start and end clock.
+// The name must be a static string.
+void  M_Prof_Record( const char * name, uint64_t start, uint64_t end );
+
+// Zone usage, the zone variable is 0 when not capturing.
+//   PROF_ZONE( zt );
+//   ...
+//   PROF_END( zt, "R_DrawSinglePlane" );
+#define PROF_ZONE( zvar )  \
+   uint64_t zvar = ( prof_capture )? M_Prof_Clock() : 0
+#define PROF_END( zvar, name )  \
+   { if( zvar )  M_Prof_Record( (name), zvar, M_Prof_Clock() ); }
+
+// The profile console command.
+void  M_Profile_Register( void );
+
+#else
+
+#define PROF_ZONE( zvar )
+#define PROF_END( zvar, name )
+
+#endif
+
+#endif
@@ -87,8 +87,10 @@ typedef struct
  *  - Added typecasts for unsigned target types
  */
 // Return blockmaphead = NULL on fail.
-void  P_create_blockmap(void)
+// Return the number of blockmaphead entries.
+int  P_create_blockmap(void)
 {
+    int count = 0;
     fixed_t minx = INT_MAX, miny = INT_MAX;
     fixed_t maxx = INT_MIN, maxy = INT_MIN;
     register int i, i1;
@@ -232,7 +234,7 @@ void  P_create_blockmap(void)
         // 4 words, unused if this routine is called, are reserved at the start.
         {
             // we need at least 1 word per block, plus reserved's
-            int count = blktot + 6;
+            count = blktot + 6;
 
             for (i = 0; i < blktot; i++)
             {
@@ -314,11 +316,12 @@ memory_fail:
 
         // [crispy] copied over from P_LoadBlockMap()
         // [MB] 2020-05-13: Modified to match "clear out mobj chains" of DooM Legacy
-        int count = sizeof(*blocklinks) * bmapwidth * bmapheight;
+        int bl_size = sizeof(*blocklinks) * bmapwidth * bmapheight;
 
-        blocklinks = Z_Malloc(count, PU_LEVEL, 0);
-        memset(blocklinks, 0, count);
+        blocklinks = Z_Malloc(bl_size, PU_LEVEL, 0);
+        memset(blocklinks, 0, bl_size);
     }
+    return count;
 }
 
 #endif  // GENERATE_BLOCKMAP
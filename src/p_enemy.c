@@ -88,6 +88,7 @@
 #include "m_random.h"
 #include "t_script.h"
 #include "dehacked.h"
+#include "z_zone.h"
 
 
 #include "hardware/hw3sound.h"
@@ -490,58 +491,186 @@ void DemoAdapt_p_enemy( void )
 
 
 //
-// Called by P_NoiseAlert.
-// Recursively traverse adjacent sectors,
-// sound blocking lines cut off traversal.
+// Sound propagation graph.
+// The edges of each sector are the lines of its linelist that have two
+// sides, in linelist order, with the sector on the other side.
+// Built at level load, after P_GroupLines.
 //
+typedef struct {
+    line_t   *  line;
+    sector_t *  other;
+} sound_edge_t;
 
-static mobj_t*         soundtarget;
+static sound_edge_t *  sound_edge;
+static uint32_t *  sound_edge_first;  // numsectors+1, index into sound_edge
 
-//  soundblocks : 0..1 number of sound blocking linedefs
-static void P_RecursiveSound ( sector_t*  sec, byte soundblocks )
+// Per sector generation counters, instead of validcount.
+static uint32_t *  sound_reach_gen;  // reached by this noise
+static uint32_t *  sound_seed_gen;   // queued behind a sound blocking line
+static uint32_t    sound_gen;
+static int      *  sound_queue;      // reached sectors, then seeds
+
+void P_Init_SoundGraph( void )
 {
-    int         i;
-    line_t*     check;
-    sector_t*   other;
+    int  numedges = 0;
+    int  i, j;
 
-    // wake up all monsters in this sector
-    if (sec->validcount == validcount
-        && sec->soundtraversed <= soundblocks+1)
+    for( i=0; i<numsectors; i++ )
     {
-        return;         // already flooded
+        sector_t * sec = &sectors[i];
+        for( j=0; j<sec->linecount; j++ )
+        {
+            if( sec->linelist[j]->sidenum[1] != NULL_INDEX )
+                numedges++;
+        }
     }
 
-    sec->validcount = validcount;
-    sec->soundtraversed = soundblocks+1;
-    SET_TARGET_REF( sec->soundtarget, soundtarget );
+    sound_edge = Z_Malloc( (numedges + 1) * sizeof(sound_edge_t), PU_LEVEL, NULL );
+    sound_edge_first = Z_Malloc( (numsectors + 1) * sizeof(uint32_t), PU_LEVEL, NULL );
+    sound_reach_gen = Z_Malloc( numsectors * sizeof(uint32_t), PU_LEVEL, NULL );
+    sound_seed_gen = Z_Malloc( numsectors * sizeof(uint32_t), PU_LEVEL, NULL );
+    sound_queue = Z_Malloc( (numsectors * 2) * sizeof(int), PU_LEVEL, NULL );
+    memset( sound_reach_gen, 0, numsectors * sizeof(uint32_t) );
+    memset( sound_seed_gen, 0, numsectors * sizeof(uint32_t) );
+    sound_gen = 0;
 
-    for (i=0 ; i<sec->linecount ; i++)
+    numedges = 0;
+    for( i=0; i<numsectors; i++ )
     {
-        // for each line of the sector linelist
-        check = sec->linelist[i];
-        if (! (check->flags & ML_TWOSIDED) )
-            continue;  // nothing on other side
+        sector_t * sec = &sectors[i];
+        sound_edge_first[i] = numedges;
+        for( j=0; j<sec->linecount; j++ )
+        {
+            line_t * ld = sec->linelist[j];
+            if( ld->sidenum[1] == NULL_INDEX )
+                continue;  // single sided, nothing on other side
+            sound_edge[numedges].line = ld;
+            // Same as P_RecursiveSound, which used the sides.
+            sound_edge[numedges].other =
+              ( sides[ ld->sidenum[0] ].sector == sec )?
+                sides[ ld->sidenum[1] ].sector
+              : sides[ ld->sidenum[0] ].sector;
+            numedges++;
+        }
+    }
+    sound_edge_first[numsectors] = numedges;
+}
 
-        P_LineOpening (check);
+// Return true when sound can pass the line.
+// Same result as P_LineOpening, openrange > 0.
+static inline boolean  sound_line_open( const line_t * ld )
+{
+    const sector_t * front = ld->frontsector;
+    const sector_t * back = ld->backsector;
 
-        if (openrange <= 0)
-            continue;   // closed door
+    if( front->ffloors || back->ffloors )
+    {
+        // 3d floors depend upon tm_thing, use the whole thing.
+        P_LineOpening( ld );
+        return (openrange > 0);
+    }
 
-        if ( sides[ check->sidenum[0] ].sector == sec)
-            other = sides[ check->sidenum[1] ].sector;
-        else
-            other = sides[ check->sidenum[0] ].sector;
+    // Current heights, so a moving door or floor is always seen as it is.
+    fixed_t  opentop = min( front->ceilingheight, back->ceilingheight );
+    fixed_t  openbottom = max( front->floorheight, back->floorheight );
+    return (opentop - openbottom > 0);
+}
+
+//
+// Called by P_NoiseAlert.
+// Flood adjacent sectors, sound blocking lines cut off traversal.
+// The sound crosses one sound blocking line, and is stopped by the second.
+//
+// Same result as the recursive Doom P_RecursiveSound, which reached every
+// sector that has a path with at most one sound blocking line, and left
+// the least count of sound blocking lines in soundtraversed.
+// Flood first without crossing any sound blocking line, then flood from
+// the sectors behind them, that were not already reached.
+//
+static void P_RecursiveSound( sector_t * sec, mobj_t * soundtarget )
+{
+    int  qhead, qtail, seedtail;
+    int  secnum = sec - sectors;
+    int  soundblocks;
+
+    sound_gen++;
+    if( sound_gen == 0 )
+    {
+        // wrap
+        memset( sound_reach_gen, 0, numsectors * sizeof(uint32_t) );
+        memset( sound_seed_gen, 0, numsectors * sizeof(uint32_t) );
+        sound_gen = 1;
+    }
+
+    // Reached sectors from the front of the queue,
+    // seeds behind sound blocking lines from the back.
+    qhead = qtail = 0;
+    seedtail = numsectors * 2;
 
-        if (check->flags & ML_SOUNDBLOCK)
+    sound_reach_gen[secnum] = sound_gen;
+    sound_queue[qtail++] = secnum;
+
+    for( soundblocks = 0; soundblocks < 2; soundblocks++ )
+    {
+        if( soundblocks == 1 )
         {
-            // Sound blocking linedef
-            // If 0, then continue recursion with 1 soundblock.
-            // If 1, then this is second, which blocks the sound.
-            if (soundblocks == 0)
-                P_RecursiveSound (other, 1);
+            // Seeds behind one sound blocking line, not reached without it.
+            int s;
+            for( s = numsectors * 2 - 1; s >= seedtail; s-- )
+            {
+                secnum = sound_queue[s];
+                if( sound_reach_gen[secnum] == sound_gen )
+                    continue;
+                sound_reach_gen[secnum] = sound_gen;
+                sound_queue[qtail++] = secnum;
+            }
+        }
+
+        while( qhead < qtail )
+        {
+            sector_t * sp;
+            uint32_t  e, e_end;
+
+            secnum = sound_queue[qhead++];
+            sp = &sectors[secnum];
+
+            // wake up all monsters in this sector
+            sp->validcount = validcount;
+            sp->soundtraversed = soundblocks+1;
+            SET_TARGET_REF( sp->soundtarget, soundtarget );
+
+            e_end = sound_edge_first[secnum+1];
+            for( e = sound_edge_first[secnum]; e < e_end; e++ )
+            {
+                line_t * check = sound_edge[e].line;
+                int othernum = sound_edge[e].other - sectors;
+
+                if( sound_reach_gen[othernum] == sound_gen )
+                    continue;  // already flooded, with fewer or same blocks
+
+                if( ! (check->flags & ML_TWOSIDED) )
+                    continue;  // nothing on other side
+
+                if( ! sound_line_open( check ) )
+                    continue;   // closed door
+
+                if( check->flags & ML_SOUNDBLOCK )
+                {
+                    // Sound blocking linedef
+                    // If 0, then continue with 1 soundblock.
+                    // If 1, then this is second, which blocks the sound.
+                    if( soundblocks == 0 && sound_seed_gen[othernum] != sound_gen )
+                    {
+                        sound_seed_gen[othernum] = sound_gen;
+                        sound_queue[--seedtail] = othernum;
+                    }
+                    continue;
+                }
+
+                sound_reach_gen[othernum] = sound_gen;
+                sound_queue[qtail++] = othernum;
+            }
         }
-        else
-            P_RecursiveSound (other, soundblocks);
     }
 }
 
@@ -554,9 +683,8 @@ static void P_RecursiveSound ( sector_t*  sec, byte soundblocks )
 //
 void P_NoiseAlert ( mobj_t* target, mobj_t* emmiter )
 {
-    soundtarget = target;
     validcount++;
-    P_RecursiveSound (emmiter->subsector->sector, 0);
+    P_RecursiveSound( emmiter->subsector->sector, target );
 }
 
 
@@ -2900,6 +3028,7 @@ boolean PIT_VileCheck (mobj_t*  thing)
         vilecheck_r_corpse->height = vilecheck_r_corpse->info->height; // revived height
         fixed_t corpse_radius = vilecheck_r_corpse->radius;
         vilecheck_r_corpse->radius = vilecheck_r_corpse->info->radius; // revived radius
+        P_ThingGrid_Radius( vilecheck_r_corpse->radius );
         int corpse_flags = vilecheck_r_corpse->flags;
         vilecheck_r_corpse->flags |= MF_SOLID; // revived would be SOLID
         check = P_CheckPosition (vilecheck_r_corpse, vilecheck_r_corpse->x, vilecheck_r_corpse->y);
@@ -2981,6 +3110,7 @@ raise_corpse:
         // fix vile revives crushed monster as ghost bug
         vilecheck_r_corpse->height = info->height;
         vilecheck_r_corpse->radius = info->radius;
+        P_ThingGrid_Radius( info->radius );
     }
     vilecheck_r_corpse->flags = info->flags & ~MF_FRIEND;
     vilecheck_r_corpse->health = info->spawnhealth;
@@ -3088,6 +3218,7 @@ raise_corpse:
         // fix vile revives crushed monster as ghost bug
         vilecheck_r_corpse->height = info->height;
         vilecheck_r_corpse->radius = info->radius;
+        P_ThingGrid_Radius( info->radius );
     }
     vilecheck_r_corpse->flags = info->flags & ~MF_FRIEND;
     vilecheck_r_corpse->health = info->spawnhealth;
@@ -37,6 +37,8 @@
 #include "p_local.h"
 #include "r_state.h"
 #include "p_fab.h"
+#include "p_reject.h"
+#include "p_lcache.h"
 #include "m_random.h"
 #include "dehacked.h"
   // thing_flags_valid_deh
@@ -379,6 +381,10 @@ void D_Register_MiscCommands (void)
 #ifdef GENERATE_BLOCKMAP
     CV_RegisterVar (&cv_blockmap_gen);
 #endif
+#ifdef GENERATE_REJECT
+    CV_RegisterVar (&cv_reject_gen);
+#endif
+    CV_RegisterVar (&cv_level_cache);
 }
 
 void  DemoAdapt_p_fab(void)  // local enables of p_fab
@@ -98,7 +98,8 @@ void DemoAdapt_p_floor( void )
 //
 //SoM: I had to copy the entire function from Boom because it was causing errors.
 // Move a floor or ceiling, update all affected structures.
-result_e T_MovePlane ( sector_t*     sector,
+static
+result_e  move_plane ( sector_t*     sector,
                        fixed_t       speed,
                        fixed_t       dest,
                        boolean       crush, // enables crushing damage
@@ -328,6 +329,23 @@ result_e T_MovePlane ( sector_t*     sector,
     return MP_ok;
 }
 
+result_e T_MovePlane ( sector_t*     sector,
+                       fixed_t       speed,
+                       fixed_t       dest,
+                       boolean       crush, // enables crushing damage
+                       int           floorOrCeiling,
+                       int           direction )
+{
+  fixed_t  floorheight = sector->floorheight;
+  fixed_t  ceilingheight = sector->ceilingheight;
+  result_e rtn = move_plane( sector, speed, dest, crush, floorOrCeiling, direction );
+
+  // Sight past this sector may have changed.
+  if( sector->floorheight != floorheight || sector->ceilingheight != ceilingheight )
+      P_Sight_Cache_Clear();
+  return rtn;
+}
+
 
 //
 // MOVE A FLOOR TO IT'S DESTINATION (UP OR DOWN)
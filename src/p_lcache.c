@@ -0,0 +1,273 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 2024 by DooM Legacy Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+//
+// DESCRIPTION:
+//      Level data cache files.
+//
+//   Data that is derived from the level map, and is slow to make, is kept
+//   in files in legacyhome/cache.  A file is named by a hash of the map
+//   lumps, and the kind of data.
+//   A file is used only when its header matches the cache format, the
+//   engine version, the data version, the map hash, and the size, and the
+//   data matches its checksum.  Any other file is stale, it is removed,
+//   and is written again when the data has been made.
+//   On Linux the file is memory mapped, and the caller copies from it.
+//
+//-----------------------------------------------------------------------------
+
+#include "doomincl.h"
+#include "p_lcache.h"
+
+#include <unistd.h>
+  // access, close
+#include <fcntl.h>
+  // open
+#include <sys/stat.h>
+#ifdef LINUX
+#include <sys/mman.h>
+  // mmap, munmap
+#endif
+
+#include "doomdata.h"
+  // ML_
+#include "d_main.h"
+  // legacyhome
+#include "i_system.h"
+  // I_mkdir
+#include "m_misc.h"
+  // cat_filename
+#include "m_swap.h"
+#include "p_setup.h"
+  // level_lumpnum
+#include "w_wad.h"
+#include "z_zone.h"
+
+
+consvar_t cv_level_cache = {"level_cache", "1", CV_SAVE, CV_OnOff, NULL};
+
+#define LCACHE_ENGINE_VERSION  ((DL_VER_MAJ * 10000) + (DL_VER_MIN * 100) + DL_VER_REV)
+
+// Cache file header, little endian.
+static const char lcache_id[8] = "LEGLC1";
+
+typedef struct {
+    char      id[8];
+    uint32_t  engine_version;
+    uint32_t  data_version;
+    uint32_t  key[2];      // map hash, low and high
+    uint32_t  size;        // of the data
+    uint32_t  checksum;    // of the data
+} lcache_header_t;
+
+static uint64_t  lc_key;
+static byte      lc_key_valid = 0;
+
+// The open file.
+static byte *  lc_data = NULL;  // the file
+static int     lc_data_size;
+static byte    lc_mapped;
+
+
+// FNV-1a
+static uint64_t  lc_hash( uint64_t h, const byte * p, int len )
+{
+    while( len-- > 0 )
+    {
+        h ^= *p++;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static uint32_t  lc_checksum( const byte * p, int len )
+{
+    uint64_t h = lc_hash( 14695981039346656037ULL, p, len );
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+void  P_Level_Cache_Init( void )
+{
+    P_Level_Cache_Close();
+    lc_key_valid = 0;
+}
+
+// The hash of the lumps that the level map geometry is made from.
+static uint64_t  lc_map_key( void )
+{
+    static const byte  key_lumps[] =
+     { ML_VERTEXES, ML_LINEDEFS, ML_SIDEDEFS, ML_SECTORS, ML_SEGS, ML_SSECTORS, ML_NODES };
+    uint64_t  key = 14695981039346656037ULL;
+    int i;
+
+    if( lc_key_valid )
+        return lc_key;
+
+    for( i=0; i<sizeof(key_lumps); i++ )
+    {
+        lumpnum_t lump = level_lumpnum + key_lumps[i];
+        int32_t len = W_LumpLength( lump );
+        int32_t le_len = LE_SWAP32( len );
+        key = lc_hash( key, (byte*)&le_len, sizeof(le_len) );
+        if( len > 0 )
+            key = lc_hash( key, W_CacheLumpNum( lump, PU_CACHE ), len );
+    }
+
+    lc_key = key;
+    lc_key_valid = 1;
+    return key;
+}
+
+static void  lc_filename( /*OUT*/ char * filename, const char * kind, boolean make_dir )
+{
+    char dirname[MAX_WADPATH];
+    char keyname[40];
+
+    cat_filename( dirname, legacyhome, "cache" );
+    if( make_dir && access( dirname, R_OK ) < 0 )
+        I_mkdir( dirname, 0700 );
+    snprintf( keyname, 39, "%016llx.%s", (unsigned long long) lc_map_key(), kind );
+    keyname[39] = 0;
+    cat_filename( filename, dirname, keyname );
+}
+
+// Return the cached data of the kind, for the level map, or NULL.
+const byte *  P_Level_Cache_Open( const char * kind, uint32_t version,
+                                  /*OUT*/ int * size )
+{
+    char filename[MAX_WADPATH];
+    lcache_header_t * hp;
+    struct stat  st;
+    uint64_t  key;
+    int  fd;
+
+    P_Level_Cache_Close();
+    *size = 0;
+
+    if( legacyhome == NULL || ! cv_level_cache.EV )
+        return NULL;
+
+    key = lc_map_key();
+    lc_filename( filename, kind, false );
+    fd = open( filename, O_RDONLY );
+    if( fd < 0 )
+        return NULL;
+
+    if( fstat( fd, &st ) < 0 || st.st_size < sizeof(lcache_header_t)
+        || st.st_size > 0x7FFFFFFF )
+        goto stale;
+
+    lc_data_size = st.st_size;
+#ifdef LINUX
+    lc_data = mmap( NULL, lc_data_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    if( lc_data == MAP_FAILED )
+        lc_data = NULL;
+    lc_mapped = ( lc_data != NULL );
+#endif
+    if( lc_data == NULL )
+    {
+        lc_data = malloc( lc_data_size );
+        if( lc_data == NULL
+            || read( fd, lc_data, lc_data_size ) != lc_data_size )
+            goto stale;
+    }
+    close( fd );
+    fd = -1;
+
+    hp = (lcache_header_t*) lc_data;
+    if( memcmp( hp->id, lcache_id, sizeof(hp->id) ) != 0
+        || LE_SWAP32( hp->engine_version ) != LCACHE_ENGINE_VERSION
+        || LE_SWAP32( hp->data_version ) != version
+        || LE_SWAP32( hp->key[0] ) != (uint32_t) key
+        || LE_SWAP32( hp->key[1] ) != (uint32_t)(key >> 32)
+        || LE_SWAP32( hp->size ) != lc_data_size - sizeof(lcache_header_t)
+        || LE_SWAP32( hp->checksum )
+           != lc_checksum( lc_data + sizeof(lcache_header_t), LE_SWAP32( hp->size ) ) )
+        goto stale;
+
+    GenPrintf(EMSG_ver, "Level cache %s\n", filename );
+    *size = lc_data_size - sizeof(lcache_header_t);
+    return lc_data + sizeof(lcache_header_t);
+
+stale:
+    if( fd >= 0 )
+        close( fd );
+    P_Level_Cache_Close();
+    GenPrintf(EMSG_ver, "Level cache %s: stale, removed\n", filename );
+    remove( filename );
+    return NULL;
+}
+
+void  P_Level_Cache_Close( void )
+{
+    if( lc_data )
+    {
+#ifdef LINUX
+        if( lc_mapped )
+            munmap( lc_data, lc_data_size );
+        else
+#endif
+            free( lc_data );
+    }
+    lc_data = NULL;
+    lc_mapped = 0;
+}
+
+void  P_Level_Cache_Write( const char * kind, uint32_t version,
+                           const void * data, int size )
+{
+    char filename[MAX_WADPATH];
+    char tmpname[MAX_WADPATH+8];
+    lcache_header_t  hdr;
+    uint64_t  key;
+    FILE * fp;
+
+    if( legacyhome == NULL || ! cv_level_cache.EV )
+        return;
+
+    key = lc_map_key();
+    memcpy( hdr.id, lcache_id, sizeof(hdr.id) );
+    hdr.engine_version = LE_SWAP32( LCACHE_ENGINE_VERSION );
+    hdr.data_version = LE_SWAP32( version );
+    hdr.key[0] = LE_SWAP32( (uint32_t) key );
+    hdr.key[1] = LE_SWAP32( (uint32_t)(key >> 32) );
+    hdr.size = LE_SWAP32( size );
+    hdr.checksum = LE_SWAP32( lc_checksum( data, size ) );
+
+    // Written to a temp file, so a partial file is never found.
+    lc_filename( filename, kind, true );
+    snprintf( tmpname, sizeof(tmpname)-1, "%s.tmp", filename );
+    tmpname[sizeof(tmpname)-1] = 0;
+    fp = fopen( tmpname, "wb" );
+    if( ! fp )
+    {
+        GenPrintf(EMSG_warn, "Level cache: cannot write %s\n", tmpname );
+        return;
+    }
+
+    if( fwrite( &hdr, sizeof(hdr), 1, fp ) != 1
+        || fwrite( data, size, 1, fp ) != 1 )
+    {
+        GenPrintf(EMSG_warn, "Level cache: write failed %s\n", tmpname );
+        fclose( fp );
+        remove( tmpname );
+        return;
+    }
+    fclose( fp );
+    if( rename( tmpname, filename ) < 0 )
+        remove( tmpname );
+}
@@ -0,0 +1,47 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 2024 by DooM Legacy Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+//
+// DESCRIPTION:
+//      Level data cache files.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef P_LCACHE_H
+#define P_LCACHE_H
+
+#include "doomtype.h"
+#include "command.h"
+  // consvar_t
+
+extern consvar_t cv_level_cache;
+
+// Called at the start of each level load, before the map lumps are used.
+void  P_Level_Cache_Init( void );
+
+// Return the cached data of the kind, for the level map, or NULL.
+// The data stays valid until P_Level_Cache_Close.
+//  kind : file extension, a few letters
+//  version : of the data format, a change makes the old files stale
+const byte *  P_Level_Cache_Open( const char * kind, uint32_t version,
+                                  /*OUT*/ int * size );
+void  P_Level_Cache_Close( void );
+
+void  P_Level_Cache_Write( const char * kind, uint32_t version,
+                           const void * data, int size );
+
+#endif
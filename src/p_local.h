@@ -270,6 +270,8 @@ extern  int *   spechit;                //SoM: 3/15/2000: Limit removal
 extern  int     numspechit;
 
 void P_NoiseAlert (mobj_t* target, mobj_t* emmiter);
+// Build the sector sound graph, after P_GroupLines.
+void P_Init_SoundGraph( void );
 boolean P_IsOnLift( const mobj_t* actor );
 int P_IsUnderDamage(mobj_t* actor);
 
@@ -316,6 +318,22 @@ void    P_SlideMove (mobj_t* mo);
 
 boolean P_CheckSight (mobj_t* t1, mobj_t* t2);
 boolean P_CheckSight2 (mobj_t* t1, mobj_t* t2, fixed_t x, fixed_t y, fixed_t z);	//added by AC for predicting
+#ifdef SIGHT_CACHE
+// Invalidate the P_CheckSight memo, every tic and when the map changes.
+void    P_Sight_Cache_Clear( void );
+// Start of level, clear the memo and the hit counts.
+void    P_Sight_Cache_Init( void );
+void    P_Sight_Register( void );
+#else
+# define P_Sight_Cache_Clear()
+#endif
+#ifdef SIGHT_THREADS
+extern consvar_t  cv_sight_threads;
+// Check the sights the monsters will need this tic, using threads.
+void    P_Sight_Prefetch( void );
+#else
+# define P_Sight_Prefetch()
+#endif
 void    P_UseLines (player_t* player);
 
 boolean P_CheckSector(sector_t* sector, boolean crunch);
@@ -324,6 +342,9 @@ boolean P_ChangeSector (sector_t* sector, boolean crunch);
 void    P_DelSeclist(msecnode_t *);
 void    P_Create_SecNodeList(mobj_t*,fixed_t,fixed_t);
 void    P_Init_Secnode( void );
+#ifdef SECNODE_CLEARBOX
+void    P_Secnode_Register( void );
+#endif
 
 extern fixed_t  got_friction;
 extern int      got_movefactor;  // return values of P_GetFriction and P_GetMoveFactor
@@ -88,6 +88,7 @@
 #include "g_game.h"
 #include "m_bbox.h"
 #include "m_random.h"
+#include "m_profile.h"
 #include "p_local.h"
 #include "p_inter.h"
 #include "r_state.h"
@@ -1562,7 +1563,7 @@ ret_blocked:
 //     the nearest ceiling or thing's bottom over tm_thing
 //
 // Use tm_ global vars, and return tmr_ global vars.
-boolean P_CheckPosition ( mobj_t* thing, fixed_t x, fixed_t y )
+static boolean check_position ( mobj_t* thing, fixed_t x, fixed_t y )
 {
     int xl, xh;
     int yl, yh;
@@ -1654,7 +1655,7 @@ boolean P_CheckPosition ( mobj_t* thing, fixed_t x, fixed_t y )
         for (bx=xl ; bx<=xh ; bx++)
         {
             for (by=yl ; by<=yh ; by++)
-                if (!P_BlockThingsIterator(bx,by,PIT_CheckThing))
+                if (!P_BlockThingsIterator_Box(bx,by,tm_bbox,PIT_CheckThing))
                     return false;
         }
     }
@@ -1677,6 +1678,15 @@ ret_blocked:
     return false;  // hit a line that stopped it
 }
 
+boolean P_CheckPosition ( mobj_t* thing, fixed_t x, fixed_t y )
+{
+    boolean result;
+    PROF_ZONE( zt );
+    result = check_position( thing, x, y );
+    PROF_END( zt, "P_CheckPosition" );
+    return result;
+}
+
 
 //==========================================================================
 //
@@ -3309,7 +3319,7 @@ fixed_t P_AimLineAttack ( mobj_t*       atkr, // attacker
     // starting with the mobj/linedef at the shortest distance...
     P_PathTraverse ( atkr->x, atkr->y,
                      x2, y2,
-                     PT_ADDLINES|PT_ADDTHINGS,
+                     PT_ADDLINES|PT_ADDTHINGS|PT_SORTED,
                      PTR_AimTraverse );
 
     //added:15-02-98: linetarget is only for mobjs, not for linedefs
@@ -3378,7 +3388,7 @@ void P_LineAttack ( mobj_t*       atkr,   // attacker
 #ifdef HEXEN
     if( P_PathTraverse ( atkr->x, atkr->y,
                      x2, y2,
-                     PT_ADDLINES|PT_ADDTHINGS,
+                     PT_ADDLINES|PT_ADDTHINGS|PT_SORTED,
                      PTR_ShootTraverse )  )
     {
         if( EN_hexen )
@@ -3407,7 +3417,7 @@ void P_LineAttack ( mobj_t*       atkr,   // attacker
 #else
     P_PathTraverse ( atkr->x, atkr->y,
                      x2, y2,
-                     PT_ADDLINES|PT_ADDTHINGS,
+                     PT_ADDLINES|PT_ADDTHINGS|PT_SORTED,
                      PTR_ShootTraverse );
 #endif    
 }
@@ -3576,11 +3586,11 @@ boolean PTR_NoWayTraverse( intercept_t* in )
 // In P_UseLines
     // From PrBoom
     // Make the "oof" sound work on 2s lines -- killough
-    if( P_PathTraverse ( x1, y1, x2, y2, PT_ADDLINES, PTR_UseTraverse ) )
+    if( P_PathTraverse ( x1, y1, x2, y2, PT_ADDLINES|PT_SORTED, PTR_UseTraverse ) )
     {
         // Hit nothing
         if( !comp[comp_sound]
-            && !P_PathTraverse ( x1, y1, x2, y2, PT_ADDLINES, PTR_NoWayTraverse ) )
+            && !P_PathTraverse ( x1, y1, x2, y2, PT_ADDLINES|PT_SORTED, PTR_NoWayTraverse ) )
             S_StartSound (usething, sfx_noway);
     }
 #endif
@@ -3608,14 +3618,14 @@ void P_UseLines (player_t* player)
     // Make the "oof" sound work on 2s lines
     // Avoid calling PathTraverse twice (like PrBoom) by doing it all the first time.
     oof_2s_hit = oof_2s_arm;  // 0 when enabled, 0x80 disabled ( !comp[comp_sound] )
-    if( P_PathTraverse ( x1, y1, x2, y2, PT_ADDLINES, PTR_UseTraverse ) )
+    if( P_PathTraverse ( x1, y1, x2, y2, PT_ADDLINES|PT_SORTED, PTR_UseTraverse ) )
     {
         // Did not hit any specials.
         if( oof_2s_hit == 2 )  // hit a 2s line
             S_StartObjSound (usething, sfx_noway);
     }
 #else
-    P_PathTraverse ( x1, y1, x2, y2, PT_ADDLINES, PTR_UseTraverse );
+    P_PathTraverse ( x1, y1, x2, y2, PT_ADDLINES|PT_SORTED, PTR_UseTraverse );
 #endif
 }
 
@@ -4102,11 +4112,22 @@ boolean P_CheckSector(sector_t* sector, boolean crunch)
 
 static msecnode_t* headsecnode = NULL;
 
+#ifdef SECNODE_CLEARBOX
+// Sector node lists, this level.
+static uint32_t  secnode_rebuilt, secnode_kept;
+#endif
+
 void P_Init_Secnode( void )
 {
     headsecnode = NULL;
+#ifdef SECNODE_CLEARBOX
+    secnode_rebuilt = secnode_kept = 0;
+#endif
 }
 
+// Nodes are allocated in chunks, so they are close together in memory.
+#define SECNODE_CHUNK  256
+
 // P_GetSecnode() retrieves a node from the freelist. The calling routine
 // should make sure it sets all fields properly.
 
@@ -4114,13 +4135,20 @@ msecnode_t* P_GetSecnode()
 {
   msecnode_t* node;
 
-  if (headsecnode)
+  if (headsecnode == NULL)
   {
-    node = headsecnode;
-    headsecnode = headsecnode->m_snext;
+    // Freelist in chunk order.
+    msecnode_t* chunk = Z_Malloc (SECNODE_CHUNK * sizeof(*node), PU_LEVEL, NULL);
+    int i;
+    for (i = SECNODE_CHUNK-1; i >= 0; i--)
+    {
+      chunk[i].m_snext = headsecnode;
+      headsecnode = &chunk[i];
+    }
   }
-  else
-    node = Z_Malloc (sizeof(*node), PU_LEVEL, NULL);
+
+  node = headsecnode;
+  headsecnode = headsecnode->m_snext;
   return(node);
 }
 
@@ -4279,6 +4307,80 @@ boolean PIT_GetSectors(line_t* ld)
 }
 
 
+#ifdef SECNODE_CLEARBOX
+// Clear box.
+// When no line crosses a box, any thing box within it touches only the
+// sector of its center, as the lines that cross a smaller box also cross
+// the larger box (P_BoxOnLineSide, and the line bbox test).
+// A thing with one sector node keeps a clear box around it, and while it
+// moves within that box, and stays in the same sector, the sector node
+// list would be rebuilt to the same list, so it is kept as is.
+#define SECNODE_CLEARBOX_MARGIN  (32*FRACUNIT)
+
+static fixed_t  clearbox[4];
+
+static boolean PIT_ClearBox(line_t* ld)
+{
+  if (clearbox[BOXRIGHT]  <= ld->bbox[BOXLEFT]   ||
+      clearbox[BOXLEFT]   >= ld->bbox[BOXRIGHT]  ||
+      clearbox[BOXTOP]    <= ld->bbox[BOXBOTTOM] ||
+      clearbox[BOXBOTTOM] >= ld->bbox[BOXTOP])
+    return true;
+
+  if (P_BoxOnLineSide(clearbox, ld) != -1)
+    return true;
+
+  return false;  // crosses the clear box
+}
+
+// Find a clear box around the tm_bbox, for the thing.
+static void set_secnode_clearbox( mobj_t* thing )
+{
+  int xl, xh;
+  int yl, yh;
+  int bx, by;
+
+  thing->secnode_box_valid = 0;
+
+  clearbox[BOXTOP]    = tm_bbox[BOXTOP] + SECNODE_CLEARBOX_MARGIN;
+  clearbox[BOXBOTTOM] = tm_bbox[BOXBOTTOM] - SECNODE_CLEARBOX_MARGIN;
+  clearbox[BOXRIGHT]  = tm_bbox[BOXRIGHT] + SECNODE_CLEARBOX_MARGIN;
+  clearbox[BOXLEFT]   = tm_bbox[BOXLEFT] - SECNODE_CLEARBOX_MARGIN;
+
+  validcount++;
+
+  xl = (clearbox[BOXLEFT] - bmaporgx)>>MAPBLOCKSHIFT;
+  xh = (clearbox[BOXRIGHT] - bmaporgx)>>MAPBLOCKSHIFT;
+  yl = (clearbox[BOXBOTTOM] - bmaporgy)>>MAPBLOCKSHIFT;
+  yh = (clearbox[BOXTOP] - bmaporgy)>>MAPBLOCKSHIFT;
+
+  for (bx=xl ; bx<=xh ; bx++)
+  {
+    for (by=yl ; by<=yh ; by++)
+    {
+      if (!P_BlockLinesIterator(bx, by, PIT_ClearBox))
+        return;  // a line crosses it
+    }
+  }
+
+  memcpy( thing->secnode_box, clearbox, sizeof(clearbox) );
+  thing->secnode_box_valid = 1;
+}
+
+static void Command_SecnodeStats_f( void )
+{
+  CONS_Printf( "Sector node lists rebuilt %u, kept %u", secnode_rebuilt, secnode_kept );
+  if( leveltime )
+    CONS_Printf( ", kept per tic %u", secnode_kept / leveltime );
+  CONS_Printf( "\n" );
+}
+
+void P_Secnode_Register( void )
+{
+  COM_AddCommand( "secnodestats", Command_SecnodeStats_f, CC_info );
+}
+#endif
+
 // P_Create_SecNodeList alters/creates the sector_list that shows what sectors
 // the object resides in.
 
@@ -4295,18 +4397,6 @@ void P_Create_SecNodeList( mobj_t* thing, fixed_t x, fixed_t y )
   // where it emulates the buggy behavior.
   // I have not found where tm_thing gets reused in this function.
 
-  // First, clear out the existing m_thing fields. As each node is
-  // added or verified as needed, m_thing will be set properly. When
-  // finished, delete all nodes where m_thing is still NULL. These
-  // represent the sectors the Thing has vacated.
-
-  node = sector_list;
-  while (node)
-  {
-    node->m_thing = NULL;
-    node = node->m_tnext;
-  }
-
   tm_thing = thing;
   tm_flags = thing->flags;
 
@@ -4320,6 +4410,35 @@ void P_Create_SecNodeList( mobj_t* thing, fixed_t x, fixed_t y )
 
   validcount++; // used to make sure we only process a line once
 
+#ifdef SECNODE_CLEARBOX
+  if( thing->secnode_box_valid
+      && sector_list && sector_list->m_tnext == NULL
+      && sector_list->m_sector == thing->subsector->sector
+      && tm_bbox[BOXTOP]    <= thing->secnode_box[BOXTOP]
+      && tm_bbox[BOXBOTTOM] >= thing->secnode_box[BOXBOTTOM]
+      && tm_bbox[BOXRIGHT]  <= thing->secnode_box[BOXRIGHT]
+      && tm_bbox[BOXLEFT]   >= thing->secnode_box[BOXLEFT] )
+  {
+    // Only the sector of the center, which already has the node.
+    sector_list->m_thing = thing;
+    secnode_kept++;
+    return;
+  }
+  secnode_rebuilt++;
+#endif
+
+  // First, clear out the existing m_thing fields. As each node is
+  // added or verified as needed, m_thing will be set properly. When
+  // finished, delete all nodes where m_thing is still NULL. These
+  // represent the sectors the Thing has vacated.
+
+  node = sector_list;
+  while (node)
+  {
+    node->m_thing = NULL;
+    node = node->m_tnext;
+  }
+
   xl = (tm_bbox[BOXLEFT] - bmaporgx)>>MAPBLOCKSHIFT;
   xh = (tm_bbox[BOXRIGHT] - bmaporgx)>>MAPBLOCKSHIFT;
   yl = (tm_bbox[BOXBOTTOM] - bmaporgy)>>MAPBLOCKSHIFT;
@@ -4350,6 +4469,13 @@ void P_Create_SecNodeList( mobj_t* thing, fixed_t x, fixed_t y )
     else
       node = node->m_tnext;
   }
+
+#ifdef SECNODE_CLEARBOX
+  if( sector_list->m_tnext == NULL )
+    set_secnode_clearbox( thing );  // only the sector of the center
+  else
+    thing->secnode_box_valid = 0;
+#endif
 }
 
 // heretic code
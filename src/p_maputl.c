@@ -70,6 +70,9 @@
 #include "p_maputl.h"
 #include "doomstat.h"
   // deathmatch
+#include "command.h"
+  // consvar_t
+#include "z_zone.h"
 
 //
 // P_AproxDistance
@@ -438,6 +441,266 @@ void P_LineOpening ( const line_t* linedef )
 // THING POSITION SETTING
 //
 
+#ifdef THING_GRID
+// Thing grid.
+// A finer grid of the things that are linked in blocklinks, so that
+// P_CheckPosition does not have to check every thing of a crowded block.
+// Each blockmap block is divided into 4x4 cells of 32 units.
+// The things of a block are visited in the blocklinks order, which is
+// the reverse of the link order, kept in bseq.  Demo sync requires the
+// same order, as PIT_CheckThing stops at the first blocking thing, and
+// picks up specials on the way.
+#define TGRID_SHIFT   (MAPBLOCKSHIFT-2)
+#define TGRID_DIV     4
+// Renumber the bseq well before they wrap.
+#define TGRID_SEQ_LIMIT  0xF0000000
+
+static void ThingGrid_OnChange( void );
+
+consvar_t cv_thing_grid = {"thing_grid", "1", CV_SAVE | CV_CALL, CV_OnOff, ThingGrid_OnChange};
+
+static mobj_t * *  thing_grid = NULL;  // PU_LEVEL
+static int       thing_grid_width;
+static uint32_t  thing_grid_seq;
+static fixed_t   thing_grid_maxradius;
+static int       thing_grid_depth;  // iterators in progress
+static boolean   thing_grid_renumber;
+
+static void thing_grid_link( mobj_t * thing )
+{
+    int gx = (thing->x - bmaporgx)>>TGRID_SHIFT;
+    int gy = (thing->y - bmaporgy)>>TGRID_SHIFT;
+    mobj_t * * headp = &thing_grid[ gy*thing_grid_width + gx ];
+
+    thing->bseq = ++thing_grid_seq;
+    if( thing_grid_seq >= TGRID_SEQ_LIMIT )
+        thing_grid_renumber = true;
+
+    if( thing->radius > thing_grid_maxradius )
+        thing_grid_maxradius = thing->radius;
+
+    thing->gprev = headp;
+    thing->gnext = *headp;
+    if( *headp ) {
+        (*headp)->gprev = & thing->gnext;
+    }
+    *headp = thing;
+}
+
+// Link all the blocklinks things into the thing grid, in blocklinks order.
+static void thing_grid_build( void )
+{
+    static mobj_t * *  blockthings = NULL;  // realloc
+    static int  max_blockthings = 0;
+    int  count = bmapwidth * bmapheight;
+    int  bn, i, n;
+    mobj_t * mo;
+
+    memset( thing_grid, 0, count * TGRID_DIV * TGRID_DIV * sizeof(mobj_t*) );
+    thing_grid_seq = 0;
+    thing_grid_renumber = false;
+
+    // A thing radius can be changed to the info radius without relinking.
+    thing_grid_maxradius = MAXRADIUS;
+    for( i=0; i<NUMMOBJTYPES; i++ )
+    {
+        if( mobjinfo[i].radius > thing_grid_maxradius )
+            thing_grid_maxradius = mobjinfo[i].radius;
+    }
+
+    for( bn=0; bn<count; bn++ )
+    {
+        n = 0;
+        for( mo = blocklinks[bn]; mo; mo = mo->bnext )
+        {
+            if( n >= max_blockthings )
+            {
+                max_blockthings = (max_blockthings)? max_blockthings*2 : 64;
+                blockthings = realloc( blockthings, max_blockthings * sizeof(mobj_t*) );
+                if( blockthings == NULL )
+                    I_Error( "Thing grid: allocation failure of %i things\n", max_blockthings );
+            }
+            blockthings[n++] = mo;
+        }
+        // Link the last first, so the grid lists have the blocklinks order.
+        while( n-- )
+            thing_grid_link( blockthings[n] );
+    }
+}
+
+// Called by P_SetupLevel, after the blockmap is loaded, before any things.
+void P_Init_ThingGrid( void )
+{
+    // The previous grid was PU_LEVEL.
+    thing_grid = NULL;
+    thing_grid_width = bmapwidth * TGRID_DIV;
+    thing_grid_depth = 0;
+
+    if( cv_thing_grid.EV )
+    {
+        thing_grid = Z_Malloc( bmapwidth * bmapheight * TGRID_DIV * TGRID_DIV * sizeof(mobj_t*),
+                               PU_LEVEL, NULL );
+        thing_grid_build();
+    }
+}
+
+// A thing radius was changed without a relink, by FraggleScript or
+// a revive, and the grid search must reach that far.
+void P_ThingGrid_Radius( fixed_t radius )
+{
+    if( radius > thing_grid_maxradius )
+        thing_grid_maxradius = radius;
+}
+
+static void ThingGrid_OnChange( void )
+{
+    int  bn;
+    mobj_t * mo;
+
+    if( gamestate != GS_LEVEL || blocklinks == NULL )
+        return;  // P_Init_ThingGrid will do it
+
+    if( cv_thing_grid.EV )
+    {
+        if( thing_grid == NULL )
+            P_Init_ThingGrid();
+        return;
+    }
+
+    if( thing_grid )
+    {
+        // Unlink everything, the grid is going away.
+        for( bn = 0; bn < bmapwidth * bmapheight; bn++ )
+        {
+            for( mo = blocklinks[bn]; mo; mo = mo->bnext )
+            {
+                mo->gprev = NULL;
+                mo->gnext = NULL;
+            }
+        }
+        Z_Free( thing_grid );
+        thing_grid = NULL;
+    }
+}
+
+//
+// P_BlockThingsIterator_Box
+// Same as P_BlockThingsIterator, but only for the things of the block
+// that can touch the box.  The box is that of a moving thing, and the
+// things are skipped only where func would reject them by distance
+// anyway, as PIT_CheckThing does.
+//
+boolean P_BlockThingsIterator_Box ( int x, int y, const fixed_t * box,
+                                    boolean(*func)(mobj_t*) )
+{
+    mobj_t * * cells[TGRID_DIV*TGRID_DIV];
+    mobj_t *   cur[TGRID_DIV*TGRID_DIV];
+    mobj_t *   mo;
+    uint32_t   last_seq;
+    int  gxl, gxh, gyl, gyh, gx, gy;
+    int  numcells, j, bj;
+    boolean  result = true;
+
+    if( thing_grid == NULL )
+        return P_BlockThingsIterator( x, y, func );
+
+    if ( x<0
+         || y<0
+         || x>= (int)bmapwidth
+         || y>= (int)bmapheight)
+    {
+        return true;
+    }
+
+    if( thing_grid_renumber && thing_grid_depth == 0 )
+        thing_grid_build();
+
+    // The grid cells of this block that can have a thing touching the box.
+    gxl = (box[BOXLEFT] - thing_grid_maxradius - bmaporgx)>>TGRID_SHIFT;
+    gxh = (box[BOXRIGHT] + thing_grid_maxradius - bmaporgx)>>TGRID_SHIFT;
+    gyl = (box[BOXBOTTOM] - thing_grid_maxradius - bmaporgy)>>TGRID_SHIFT;
+    gyh = (box[BOXTOP] + thing_grid_maxradius - bmaporgy)>>TGRID_SHIFT;
+    if( gxl < x*TGRID_DIV )  gxl = x*TGRID_DIV;
+    if( gxh > x*TGRID_DIV + (TGRID_DIV-1) )  gxh = x*TGRID_DIV + (TGRID_DIV-1);
+    if( gyl < y*TGRID_DIV )  gyl = y*TGRID_DIV;
+    if( gyh > y*TGRID_DIV + (TGRID_DIV-1) )  gyh = y*TGRID_DIV + (TGRID_DIV-1);
+
+    numcells = 0;
+    for( gy = gyl; gy <= gyh; gy++ )
+    {
+        for( gx = gxl; gx <= gxh; gx++ )
+        {
+            mobj_t * * cellp = &thing_grid[ gy*thing_grid_width + gx ];
+            if( *cellp == NULL )
+                continue;
+            cells[numcells] = cellp;
+            cur[numcells] = *cellp;
+            numcells++;
+        }
+    }
+
+    if( numcells == 0 )
+        return true;
+
+    thing_grid_depth++;
+
+    // Merge the cell lists in blocklinks order, highest bseq first.
+    // Things linked by func have a higher bseq and are not visited,
+    // and things unlinked by func are not visited, same as bnext.
+    last_seq = 0xFFFFFFFF;
+    for(;;)
+    {
+        mo = NULL;
+        bj = 0;
+        for( j = 0; j < numcells; j++ )
+        {
+            mobj_t * c = cur[j];
+            if( c && (c->gprev == NULL || c->bseq >= last_seq) )
+            {
+                // The next was unlinked, or relinked, by func.
+                for( c = *cells[j]; c && c->bseq >= last_seq; c = c->gnext )
+                    ;
+                cur[j] = c;
+            }
+            if( c && (mo == NULL || c->bseq > mo->bseq) )
+            {
+                mo = c;
+                bj = j;
+            }
+        }
+
+        if( mo == NULL )
+            break;
+
+        last_seq = mo->bseq;
+        cur[bj] = mo->gnext;
+        if( ! func( mo ) )
+        {
+            result = false;
+            break;
+        }
+
+        if( mo->gprev == NULL || mo->bseq != last_seq )
+        {
+            // func unlinked or relinked this thing.
+            // Continue from its bnext, as P_BlockThingsIterator does.
+            for( mo = mo->bnext; mo; mo = mo->bnext )
+            {
+                if( ! func( mo ) )
+                {
+                    result = false;
+                    break;
+                }
+            }
+            break;
+        }
+    }
+
+    thing_grid_depth--;
+    return result;
+}
+#endif
+
 
 //
 // P_UnsetThingPosition
@@ -498,11 +761,22 @@ void P_UnsetThingPosition (mobj_t* thing)
             thing->bprev = NULL;  // to be consistent with above test
 //            thing->bnext = NULL;  // safer, neater, but unnecessary
         }
+#ifdef THING_GRID
+        if( thing->gprev ) {
+            *(thing->gprev) = thing->gnext;
+            if( thing->gnext )
+                thing->gnext->gprev = thing->gprev;
+            thing->gprev = NULL;
+        }
+#endif
 
 #ifdef PARANOIA
         // Can set bnext and bprev to NULL, or not.
         thing->bnext = NULL;
         thing->bprev = NULL;
+# ifdef THING_GRID
+        thing->gnext = NULL;
+# endif
 #endif
 
 
@@ -609,6 +883,10 @@ void P_SetThingPosition (mobj_t* thing)
                 (*headp)->bprev = & thing->bnext;  // back ptr to thing link
             }
             *headp = thing;
+#ifdef THING_GRID
+            if( thing_grid )
+                thing_grid_link( thing );
+#endif
 
 #if 0  /* OLD CODE */
 // Link as in Vanilla Doom, Heretic, and Boom.
@@ -725,6 +1003,15 @@ divline_t       trace;
 boolean         earlyout;
 int             ptflags;
 
+// Traversal of PT_SORTED paths, 0=scan, 1=sort.
+// Both give the same order, see the -synccheck switch.
+CV_PossibleValue_t intercept_sort_cons_t[] = { {0,"scan"}, {1,"sort"}, {0,NULL} };
+consvar_t cv_intercept_sort = {"intercept_sort", "1", CV_SAVE, intercept_sort_cons_t};
+
+// Merge workspace for sorting the intercepts, kept between traces.
+static int max_intercept_sortbuf = 0;
+static intercept_t*  intercept_sortbuf = NULL;  // realloc
+
 
 
 //SoM: 4/6/2000: Remove limit on intercepts.
@@ -934,6 +1221,103 @@ boolean P_TraverseIntercepts ( traverser_t   func,
 }
 
 
+// Stable sort of the intercepts by frac.
+// Equal frac keep the order they were added, which is the order that
+// the closest intercept scan of P_TraverseIntercepts picks them.
+static void sort_intercepts( void )
+{
+    int  count = intercept_p - intercepts;
+    intercept_t * src;
+    intercept_t * dst;
+    intercept_t * tmp;
+    int  width, lo, i;
+
+    if( count < 2 )
+        return;
+
+    if( count <= 16 )
+    {
+        // insertion sort
+        for( i = 1; i < count; i++ )
+        {
+            intercept_t  in = intercepts[i];
+            int  j = i;
+            while( j > 0 && intercepts[j-1].frac > in.frac )
+            {
+                intercepts[j] = intercepts[j-1];
+                j--;
+            }
+            intercepts[j] = in;
+        }
+        return;
+    }
+
+    if( max_intercept_sortbuf < max_intercepts )
+    {
+        max_intercept_sortbuf = max_intercepts;
+        intercept_sortbuf = realloc(intercept_sortbuf, sizeof(intercept_t) * max_intercept_sortbuf);
+        if( intercept_sortbuf == NULL )
+            I_Error("sort_intercepts: allocation failure of %i intercepts\n", max_intercept_sortbuf);
+    }
+
+    // bottom up merge sort
+    src = intercepts;
+    dst = intercept_sortbuf;
+    for( width = 1; width < count; width *= 2 )
+    {
+        for( lo = 0; lo < count; lo += width*2 )
+        {
+            int  a = lo;
+            int  a_end = min( lo + width, count );
+            int  b = a_end;
+            int  b_end = min( lo + width*2, count );
+            int  k = lo;
+            while( a < a_end && b < b_end )
+            {
+                // take the left on equal, keeps it stable
+                dst[k++] = ( src[b].frac < src[a].frac )? src[b++] : src[a++];
+            }
+            while( a < a_end )
+                dst[k++] = src[a++];
+            while( b < b_end )
+                dst[k++] = src[b++];
+        }
+        tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    if( src != intercepts )
+        memcpy( intercepts, src, sizeof(intercept_t) * count );
+}
+
+//
+// P_TraverseSortedIntercepts
+// Same as P_TraverseIntercepts, but sorts the intercepts once instead of
+// scanning for the closest one for every call.
+// Returns true if the traverser function returns true
+// for all lines.
+//
+static boolean P_TraverseSortedIntercepts ( traverser_t   func,
+                                            fixed_t       maxfrac )
+{
+    intercept_t*        in;
+
+    sort_intercepts();
+
+    for( in = intercepts; in < intercept_p; in++ )
+    {
+        if (in->frac > maxfrac)
+            return true;        // checked everything in range
+
+        if ( !func (in) )
+            return false;       // don't bother going farther
+    }
+
+    return true;                // everything was traversed
+}
+
+
 
 
 //
@@ -1078,6 +1462,8 @@ boolean P_PathTraverse ( fixed_t       x1,
 
     }
     // go through the sorted list
+    if( (flags & PT_SORTED) && cv_intercept_sort.EV )
+        return P_TraverseSortedIntercepts ( trav, FRACUNIT );
     return P_TraverseIntercepts ( trav, FRACUNIT );
 }
 
@@ -97,10 +97,26 @@ void    P_LineOpening ( const line_t* linedef );
 
 boolean P_BlockLinesIterator (int x, int y, boolean(*func)(line_t*) );
 boolean P_BlockThingsIterator (int x, int y, boolean(*func)(mobj_t*) );
+#ifdef THING_GRID
+boolean P_BlockThingsIterator_Box ( int x, int y, const fixed_t * box,
+                                    boolean(*func)(mobj_t*) );
+void P_Init_ThingGrid( void );
+// Call when a thing radius, or an info radius, is raised without a relink.
+void P_ThingGrid_Radius( fixed_t radius );
+extern consvar_t  cv_thing_grid;
+#else
+# define P_BlockThingsIterator_Box( x, y, box, func )  P_BlockThingsIterator( (x), (y), (func) )
+# define P_ThingGrid_Radius( radius )
+#endif
 
 #define PT_ADDLINES     1
 #define PT_ADDTHINGS    2
 #define PT_EARLYOUT     4
+// Sort the intercepts once, for traces that cross many lines and things.
+#define PT_SORTED       8
+
+// Traversal of PT_SORTED, 0=scan, 1=sort.
+extern consvar_t  cv_intercept_sort;
 
 extern divline_t        trace;
 
@@ -464,9 +464,6 @@ typedef struct mobj_s
 #endif
     uint32_t            tflags; // translation, drawing, settings, mobjtflag_e
     uint32_t            eflags; //added:28-02-98: mobjeflag_e
-    // Heretic spcial
-    int                 special1;
-    int                 special2;
 
     int                 health;
     int                 tics;   // state tic counter
@@ -491,6 +488,25 @@ typedef struct mobj_s
     // a linked list of sectors where this object appears
     msecnode_t        * touching_sectorlist;
 
+    // [WDJ] The fields above are used by the movement, blockmap, and
+    // render loops, and fit the first three cache lines of a pool mobj.
+
+#ifdef THING_GRID
+    // Linking into the thing grid, same as bnext, bprev.
+    mobj_t *   gnext;
+    mobj_t * * gprev;
+    uint32_t   bseq;   // blockmap link order
+#endif
+#ifdef SECNODE_CLEARBOX
+    // No line crosses this box, see P_Create_SecNodeList.
+    fixed_t    secnode_box[4];
+    byte       secnode_box_valid;
+#endif
+
+    // Heretic spcial
+    int                 special1;
+    int                 special2;
+
     //Fab:02-08-98
     // Skin overrides 'sprite' when non NULL (currently hack for player
     // bodies so they 'remember' the skin).
@@ -596,6 +612,8 @@ void  P_dummy_RipperBlood( void );
 //spawn splash at surface of water in sector where the mobj resides
 void  P_SpawnSplash (mobj_t* mo, fixed_t z);
 
+// Return a cleared mobj, from the mobj pool.
+mobj_t*  P_Alloc_Mobj( void );
 mobj_t*  P_SpawnMobj ( fixed_t x, fixed_t y, fixed_t z, mobjtype_t type );
 
 // Morph control flags
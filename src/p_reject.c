@@ -0,0 +1,857 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 2024 by DooM Legacy Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+//
+// DESCRIPTION:
+//      REJECT table load, and generation.
+//
+//   Most node builders write an all zero REJECT, and then every sight
+//   check walks the BSP.  The generated table is built from portal
+//   visibility between sectors.  A portal is a two sided linedef.
+//   A sight line leaving a sector must cross one of its portals, and
+//   from then on stays on the far side of every portal it crossed.
+//   From each source sector, the portal chains are followed, and each
+//   next portal is clipped to what a straight line through the first
+//   portal and the last portal can reach.
+//
+//   The table must never say "not visible" when P_CheckSight could see.
+//   Everything is clipped loosely.  Portals are lengthened, because
+//   P_DivlineSide drops the fraction bits and a sight line can slip past
+//   the vertex of a wall.  A thing close to a thin wall can be seen from
+//   behind that wall, so sectors that close get each others visibility.
+//   Any doubt, and the sectors are visible.
+//   Sector heights are ignored, as they can move.
+//
+//   With LOAD_THREADS, the source sectors are flooded by threads while
+//   the level load goes on, and P_Load_Reject_Finish waits for them.
+//
+//-----------------------------------------------------------------------------
+
+#include "doomincl.h"
+#include "p_reject.h"
+
+#include "p_local.h"
+#include "p_setup.h"
+#include "r_state.h"
+#include "w_wad.h"
+#include "z_zone.h"
+
+#ifdef GENERATE_REJECT
+#include <math.h>
+#include <stdlib.h>
+#include <unistd.h>
+  // sysconf
+#include "m_profile.h"
+  // M_Time_ns
+#include "r_main.h"
+  // validcount
+#include "p_lcache.h"
+#endif
+
+#ifdef LOAD_THREADS
+#include <pthread.h>
+#endif
+
+
+#ifdef GENERATE_REJECT
+// Set when rejectmatrix is a generated table, not the map REJECT.
+byte  reject_generated = 0;
+
+CV_PossibleValue_t reject_gen_cons_t[]={{0,"Off"}, {1,"Generate"}, {2,"Cache"}, {0,NULL}};
+consvar_t cv_reject_gen = {"reject_gen", "2", CV_SAVE|CV_NETVAR, reject_gen_cons_t, NULL};
+
+
+// In map units.
+// Portals are lengthened at both ends, for the P_DivlineSide round off.
+#define PORTAL_SLACK   4.0
+// Clipping keeps this much on the wrong side of the clip line.
+#define CLIP_SLACK     1.0
+
+// The round off also misses a wall when an end of the sight line is
+// this close to it.  A thing by a thin wall is then seen from behind it.
+#define NEAR_WALL      8.0
+
+// When a source sector exceeds these, it sees every sector connected to it.
+#define SOURCE_STEP_LIMIT  100000
+#define PATH_DEPTH_LIMIT   512
+
+// Larger maps keep the wad REJECT, the table would be too large.
+#define MAX_GEN_SECTORS    16384
+
+typedef struct {
+    double  x, y;
+} rj_point_t;
+
+// A two sided linedef, crossed from one of its sectors.
+// The to_sector is on the left, looking from p[0] to p[1].
+typedef struct {
+    rj_point_t  p[2];
+    int   line;       // index into lines
+    int   to_sector;  // index into sectors
+    int   next;       // next portal out of the same sector, -1 ends
+} rj_portal_t;
+
+static rj_portal_t * rj_portal;
+static int  * rj_sector_portal;  // first portal out of each sector, -1 for none
+
+#ifdef LOAD_THREADS
+#define MAX_FLOOD_THREADS  16
+#else
+#define MAX_FLOOD_THREADS  1
+#endif
+
+// The flood of a range of source sectors, by one thread.
+typedef struct {
+    byte * line_on_path;  // linedefs crossed by the current chain
+    byte * seen;          // sectors seen from the current source
+    int    steps;
+    int    s1, s2;        // source sectors s1 .. s2-1
+    int    fallback_count;
+#ifdef LOAD_THREADS
+    pthread_t  thread;
+    byte   started;
+#endif
+} rj_flood_t;
+
+static rj_flood_t  rj_fl[MAX_FLOOD_THREADS];
+static int  rj_num_fl;
+
+// Pairs of sectors that are NEAR_WALL apart, across a one sided wall.
+static int  * rj_near_pair;
+static int    rj_num_near, rj_max_near;
+
+
+// Return signed distance of pt from the line a->b, positive on the left.
+static double  rj_side( const rj_point_t * a, const rj_point_t * b,
+                        const rj_point_t * pt )
+{
+    double dx = b->x - a->x;
+    double dy = b->y - a->y;
+    return (dx * (pt->y - a->y) - dy * (pt->x - a->x)) / sqrt( dx*dx + dy*dy );
+}
+
+// Clip the segment w to the left side of the line a->b.
+// Return false when nothing is left.
+static boolean  rj_clip( const rj_point_t * a, const rj_point_t * b,
+                         /*INOUT*/ rj_point_t w[2] )
+{
+    double d0 = rj_side( a, b, &w[0] ) + CLIP_SLACK;
+    double d1 = rj_side( a, b, &w[1] ) + CLIP_SLACK;
+    rj_point_t  mp;
+    double f;
+
+    if( d0 >= 0.0 && d1 >= 0.0 )
+        return true;
+    if( d0 < 0.0 && d1 < 0.0 )
+        return false;
+
+    f = d0 / (d0 - d1);
+    mp.x = w[0].x + f * (w[1].x - w[0].x);
+    mp.y = w[0].y + f * (w[1].y - w[0].y);
+    if( d0 < 0.0 )
+        w[0] = mp;
+    else
+        w[1] = mp;
+    return true;
+}
+
+// A line through a source endpoint and a pass endpoint, that has the
+// source and pass portals on opposite sides, is a separator.
+// Every straight line through both portals is beyond the pass portal on
+// the pass side of the separator.  Clip w to that side.
+// Return false when nothing is left.
+static boolean  rj_clip_separators( const rj_point_t src[2],
+                                    const rj_point_t pass[2],
+                                    /*INOUT*/ rj_point_t w[2] )
+{
+    const rj_point_t * a, * b;
+    double sa, sb, dx, dy;
+    int i, j;
+
+    for( i=0; i<2; i++ )
+    {
+        a = &src[i];
+        for( j=0; j<2; j++ )
+        {
+            b = &pass[j];
+            dx = b->x - a->x;
+            dy = b->y - a->y;
+            if( (dx*dx + dy*dy) < 1.0 )
+                continue;  // shared vertex
+
+            sa = rj_side( a, b, &src[i^1] );
+            sb = rj_side( a, b, &pass[j^1] );
+            if( sa > CLIP_SLACK && sb < -CLIP_SLACK )
+            {
+                if( ! rj_clip( b, a, w ) )  // keep the right of a->b
+                    return false;
+            }
+            else if( sa < -CLIP_SLACK && sb > CLIP_SLACK )
+            {
+                if( ! rj_clip( a, b, w ) )
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+// The sight line has crossed the src portal, then the pass portal,
+// and is in the sector secnum.
+//  src : NULL when pass is the first portal
+// Return false when the limits are exceeded.
+static boolean  rj_flood( rj_flood_t * fl,
+                          const rj_point_t * src, const rj_point_t * pass,
+                          int secnum, int depth )
+{
+    rj_portal_t * pp;
+    rj_point_t  w[2];
+    boolean  ok;
+    int pn;
+
+    for( pn = rj_sector_portal[secnum]; pn >= 0; pn = pp->next )
+    {
+        pp = &rj_portal[pn];
+        // A straight line crosses a linedef only once.
+        if( fl->line_on_path[pp->line] )
+            continue;
+
+        if( ++fl->steps > SOURCE_STEP_LIMIT || depth >= PATH_DEPTH_LIMIT )
+            return false;
+
+        w[0] = pp->p[0];
+        w[1] = pp->p[1];
+        // Must be on the far side of every portal crossed.
+        if( ! rj_clip( &pass[0], &pass[1], w ) )
+            continue;
+        if( src )
+        {
+            if( ! rj_clip( &src[0], &src[1], w ) )
+                continue;
+            if( ! rj_clip_separators( src, pass, w ) )
+                continue;
+        }
+
+        fl->seen[pp->to_sector] = 1;
+
+        fl->line_on_path[pp->line] = 1;
+        ok = rj_flood( fl, (src ? src : pass), w, pp->to_sector, depth+1 );
+        fl->line_on_path[pp->line] = 0;
+        if( ! ok )
+            return false;
+    }
+    return true;
+}
+
+
+static int  rj_find( int * group, int s )
+{
+    while( group[s] != s )
+    {
+        group[s] = group[group[s]];
+        s = group[s];
+    }
+    return s;
+}
+
+static void  rj_union( int * group, int s1, int s2 )
+{
+    s1 = rj_find( group, s1 );
+    s2 = rj_find( group, s2 );
+    if( s1 != s2 )
+        group[s2] = s1;
+}
+
+#define RJ_DOUBLE( fx )   ((double)(fx) / FRACUNIT)
+
+#define RJ_TEST( m, pnum )   ((m)[(pnum)>>3] & (1 << ((pnum)&7)))
+#define RJ_SET( m, pnum )    ((m)[(pnum)>>3] |= (1 << ((pnum)&7)))
+
+// Make the visible table symmetric.
+static void  rj_symmetric( byte * vis )
+{
+    int s1, s2;
+    for( s1=0; s1<numsectors; s1++ )
+    {
+        for( s2=s1+1; s2<numsectors; s2++ )
+        {
+            unsigned int p12 = s1*numsectors + s2;
+            unsigned int p21 = s2*numsectors + s1;
+            if( RJ_TEST( vis, p12 ) || RJ_TEST( vis, p21 ) )
+            {
+                RJ_SET( vis, p12 );
+                RJ_SET( vis, p21 );
+            }
+        }
+    }
+}
+
+// Give every sector of an alias group the visible row of the group.
+static void  rj_alias_rows( byte * vis, int * alias, byte * row )
+{
+    int s1, s2, g;
+    for( g=0; g<numsectors; g++ )
+    {
+        if( rj_find( alias, g ) != g )
+            continue;
+        // The group is g, and every sector that finds g.
+        memset( row, 0, numsectors );
+        for( s1=0; s1<numsectors; s1++ )
+        {
+            if( rj_find( alias, s1 ) != g )
+                continue;
+            for( s2=0; s2<numsectors; s2++ )
+            {
+                if( RJ_TEST( vis, s1*numsectors + s2 ) )
+                    row[s2] = 1;
+            }
+        }
+        for( s1=0; s1<numsectors; s1++ )
+        {
+            if( rj_find( alias, s1 ) != g )
+                continue;
+            for( s2=0; s2<numsectors; s2++ )
+            {
+                if( row[s2] )
+                    RJ_SET( vis, s1*numsectors + s2 );
+            }
+        }
+    }
+}
+
+// Return distance from pt to the segment a, b.
+static double  rj_point_seg_dist( const rj_point_t * pt,
+                                  const rj_point_t * a, const rj_point_t * b )
+{
+    double dx = b->x - a->x;
+    double dy = b->y - a->y;
+    double len2 = dx*dx + dy*dy;
+    double f = 0.0;
+
+    if( len2 > 0.0 )
+    {
+        f = ((pt->x - a->x) * dx + (pt->y - a->y) * dy) / len2;
+        if( f < 0.0 )  f = 0.0;
+        else if( f > 1.0 )  f = 1.0;
+    }
+    dx = pt->x - (a->x + f * dx);
+    dy = pt->y - (a->y + f * dy);
+    return sqrt( dx*dx + dy*dy );
+}
+
+static void  rj_line_points( const line_t * ld, /*OUT*/ rj_point_t pt[2] )
+{
+    pt[0].x = RJ_DOUBLE( ld->v1->x );
+    pt[0].y = RJ_DOUBLE( ld->v1->y );
+    pt[1].x = RJ_DOUBLE( ld->v2->x );
+    pt[1].y = RJ_DOUBLE( ld->v2->y );
+}
+
+static void  rj_add_near( int s1, int s2 )
+{
+    if( s1 == s2 )
+        return;
+    if( rj_num_near >= rj_max_near )
+    {
+        rj_max_near += 1024;
+        rj_near_pair = realloc( rj_near_pair, rj_max_near * 2 * sizeof(int) );
+        if( rj_near_pair == NULL )
+            I_Error( "P_Load_Reject: cannot alloc near pairs\n" );
+    }
+    rj_near_pair[rj_num_near*2] = s1;
+    rj_near_pair[rj_num_near*2 + 1] = s2;
+    rj_num_near++;
+}
+
+static line_t *    rj_wall;     // one sided wall being tested
+static rj_point_t  rj_wall_pt[2];
+
+static boolean  PIT_rj_near_wall( line_t * ld )
+{
+    rj_point_t  pt[2];
+    int wsec = rj_wall->frontsector - sectors;
+
+    if( ld == rj_wall )
+        return true;
+    if( ld->frontsector == rj_wall->frontsector
+        && (ld->backsector == NULL || ld->backsector == rj_wall->frontsector) )
+        return true;  // same sector
+
+    rj_line_points( ld, pt );
+    // Segments that cross also have an end near the other segment,
+    // unless they are long, so test the crossing too.
+    if( rj_point_seg_dist( &pt[0], &rj_wall_pt[0], &rj_wall_pt[1] ) > NEAR_WALL
+        && rj_point_seg_dist( &pt[1], &rj_wall_pt[0], &rj_wall_pt[1] ) > NEAR_WALL
+        && rj_point_seg_dist( &rj_wall_pt[0], &pt[0], &pt[1] ) > NEAR_WALL
+        && rj_point_seg_dist( &rj_wall_pt[1], &pt[0], &pt[1] ) > NEAR_WALL )
+    {
+        double s0 = rj_side( &pt[0], &pt[1], &rj_wall_pt[0] );
+        double s1 = rj_side( &pt[0], &pt[1], &rj_wall_pt[1] );
+        double s2 = rj_side( &rj_wall_pt[0], &rj_wall_pt[1], &pt[0] );
+        double s3 = rj_side( &rj_wall_pt[0], &rj_wall_pt[1], &pt[1] );
+        if( (s0 > 0.0) == (s1 > 0.0) || (s2 > 0.0) == (s3 > 0.0) )
+            return true;  // not near
+    }
+
+    if( ld->frontsector )
+        rj_add_near( wsec, ld->frontsector - sectors );
+    if( ld->backsector )
+        rj_add_near( wsec, ld->backsector - sectors );
+    return true;
+}
+
+// Find the sectors near every one sided wall, using the blockmap.
+static void  rj_find_near_walls( void )
+{
+    fixed_t  near_fx = (fixed_t)(NEAR_WALL * FRACUNIT);
+    int i, bx, by;
+
+    for( i=0; i<numlines; i++ )
+    {
+        line_t * ld = &lines[i];
+        int bx1, bx2, by1, by2;
+
+        if( (ld->flags & ML_TWOSIDED) && ld->backsector )
+            continue;
+        if( ! ld->frontsector )
+            continue;
+
+        rj_wall = ld;
+        rj_line_points( ld, rj_wall_pt );
+        bx1 = (min( ld->v1->x, ld->v2->x ) - near_fx - bmaporgx) >> MAPBLOCKSHIFT;
+        bx2 = (max( ld->v1->x, ld->v2->x ) + near_fx - bmaporgx) >> MAPBLOCKSHIFT;
+        by1 = (min( ld->v1->y, ld->v2->y ) - near_fx - bmaporgy) >> MAPBLOCKSHIFT;
+        by2 = (max( ld->v1->y, ld->v2->y ) + near_fx - bmaporgy) >> MAPBLOCKSHIFT;
+
+        validcount++;
+        for( bx=bx1; bx<=bx2; bx++ )
+        {
+            for( by=by1; by<=by2; by++ )
+                P_BlockLinesIterator( bx, by, PIT_rj_near_wall );
+        }
+    }
+}
+
+// Give each sector of a near pair the visible row of the other.
+// From a copy of the rows, so it does not pass along a chain of pairs.
+static void  rj_near_rows( byte * vis, byte * vis_copy, int vis_size )
+{
+    int i, t;
+
+    memcpy( vis_copy, vis, vis_size );
+    for( i=0; i<rj_num_near; i++ )
+    {
+        int s1 = rj_near_pair[i*2];
+        int s2 = rj_near_pair[i*2 + 1];
+        for( t=0; t<numsectors; t++ )
+        {
+            if( RJ_TEST( vis_copy, s2*numsectors + t ) )
+                RJ_SET( vis, s1*numsectors + t );
+            if( RJ_TEST( vis_copy, s1*numsectors + t ) )
+                RJ_SET( vis, s2*numsectors + t );
+        }
+    }
+}
+
+// The level cache kind, and the version of the table.
+#define REJECT_CACHE_KIND     "rej"
+#define REJECT_CACHE_VERSION  1
+
+// The REJECT being generated, from P_Load_Reject to P_Load_Reject_Finish.
+static byte *  rj_reject = NULL;  // the table, NULL when not generating
+static int     rj_reject_size;
+static boolean rj_write_cache;
+static uint64_t  rj_start_ns;
+static byte *  rj_vis;   // bit set when visible
+static byte *  rj_line_has_seg;
+static int  *  rj_alias; // subsector sector and seg sectors
+static int  *  rj_group; // connected through portals, and aliases
+static boolean rj_has_alias;
+static int     rj_numportals;
+
+static void  rj_gen_free( void )
+{
+    int i;
+
+    for( i=0; i<rj_num_fl; i++ )
+    {
+        if( rj_fl[i].seen )  Z_Free( rj_fl[i].seen );
+        if( rj_fl[i].line_on_path )  Z_Free( rj_fl[i].line_on_path );
+        rj_fl[i].seen = rj_fl[i].line_on_path = NULL;
+    }
+    rj_num_fl = 0;
+    if( rj_vis )  Z_Free( rj_vis );
+    if( rj_portal )  Z_Free( rj_portal );
+    if( rj_sector_portal )  Z_Free( rj_sector_portal );
+    if( rj_group )  Z_Free( rj_group );
+    if( rj_alias )  Z_Free( rj_alias );
+    if( rj_line_has_seg )  Z_Free( rj_line_has_seg );
+    if( rj_near_pair )  free( rj_near_pair );
+    rj_near_pair = NULL;
+    rj_num_near = rj_max_near = 0;
+    rj_vis = NULL;
+    rj_portal = NULL;
+    rj_sector_portal = NULL;
+    rj_group = NULL;
+    rj_alias = NULL;
+    rj_line_has_seg = NULL;
+    rj_reject = NULL;
+}
+
+// Find the aliases and the portals.
+// Return false when the map cannot be trusted.
+static boolean  rj_gen_setup( void )
+{
+    int i, s;
+
+    rj_has_alias = false;
+    rj_numportals = 0;
+
+    rj_line_has_seg = Z_Malloc( numlines, PU_STATIC, NULL );
+    memset( rj_line_has_seg, 0, numlines );
+    rj_alias = Z_Malloc( numsectors * sizeof(int), PU_STATIC, NULL );
+    rj_group = Z_Malloc( numsectors * sizeof(int), PU_STATIC, NULL );
+    for( s=0; s<numsectors; s++ )
+        rj_alias[s] = rj_group[s] = s;
+
+    // A thing is in the sector of its subsector.  When the segs of a
+    // subsector are of other sectors, as with self referencing sector
+    // tricks, the sectors are aliases.
+    for( i=0; i<numsubsectors; i++ )
+    {
+        subsector_t * ss = &subsectors[i];
+        seg_t * seg = &segs[ss->firstline];
+        int n;
+        if( ss->sector == NULL )
+            return false;
+        for( n = ss->numlines; n > 0; n--, seg++ )
+        {
+            if( seg->linedef == NULL )
+                continue;  // miniseg
+            rj_line_has_seg[ seg->linedef - lines ] = 1;
+            if( seg->frontsector && seg->frontsector != ss->sector )
+            {
+                rj_union( rj_alias, ss->sector - sectors, seg->frontsector - sectors );
+                rj_union( rj_group, ss->sector - sectors, seg->frontsector - sectors );
+                rj_has_alias = true;
+            }
+        }
+    }
+
+    // Portals, two per two sided linedef.
+    rj_portal = Z_Malloc( numlines * 2 * sizeof(rj_portal_t), PU_STATIC, NULL );
+    rj_sector_portal = Z_Malloc( numsectors * sizeof(int), PU_STATIC, NULL );
+    for( s=0; s<numsectors; s++ )
+        rj_sector_portal[s] = -1;
+
+    for( i=0; i<numlines; i++ )
+    {
+        line_t * ld = &lines[i];
+        rj_point_t  v1, v2;
+        double dx, dy, len;
+        int side;
+
+        v1.x = RJ_DOUBLE( ld->v1->x );
+        v1.y = RJ_DOUBLE( ld->v1->y );
+        v2.x = RJ_DOUBLE( ld->v2->x );
+        v2.y = RJ_DOUBLE( ld->v2->y );
+        dx = v2.x - v1.x;
+        dy = v2.y - v1.y;
+        len = sqrt( dx*dx + dy*dy );
+        if( len < 0.01 )
+            continue;  // cannot block, or be crossed
+
+        if( !(ld->flags & ML_TWOSIDED) || !ld->frontsector || !ld->backsector )
+        {
+            // Blocks sight, but only when P_CheckSight finds it in the BSP.
+            if( ! rj_line_has_seg[i] )
+            {
+                GenPrintf(EMSG_info, "REJECT not generated, linedef %i has no segs\n", i );
+                return false;
+            }
+            continue;
+        }
+
+        rj_union( rj_group, ld->frontsector - sectors, ld->backsector - sectors );
+
+        // Lengthen at both ends.
+        dx *= PORTAL_SLACK / len;
+        dy *= PORTAL_SLACK / len;
+        v1.x -= dx;  v1.y -= dy;
+        v2.x += dx;  v2.y += dy;
+
+        // Front sector is on the right of v1->v2, back sector on the left.
+        for( side=0; side<2; side++ )
+        {
+            rj_portal_t * pp = &rj_portal[rj_numportals];
+            int from = ((side)? ld->backsector : ld->frontsector) - sectors;
+            pp->p[0] = (side)? v2 : v1;
+            pp->p[1] = (side)? v1 : v2;
+            pp->line = i;
+            pp->to_sector = ((side)? ld->frontsector : ld->backsector) - sectors;
+            pp->next = rj_sector_portal[from];
+            rj_sector_portal[from] = rj_numportals;
+            rj_numportals++;
+        }
+    }
+
+
+    // Flatten the groups, so the flood threads only read them.
+    for( s=0; s<numsectors; s++ )
+        rj_group[s] = rj_find( rj_group, s );
+    return true;
+}
+
+// Flood from each source sector of the range, and set its visible row.
+static void  rj_flood_sources( rj_flood_t * fl )
+{
+    int s, t;
+
+    for( s = fl->s1; s < fl->s2; s++ )
+    {
+        boolean  ok = true;
+        int pn;
+
+        memset( fl->seen, 0, numsectors );
+        fl->seen[s] = 1;
+        fl->steps = 0;
+
+        for( pn = rj_sector_portal[s]; pn >= 0; pn = rj_portal[pn].next )
+        {
+            rj_portal_t * pp = &rj_portal[pn];
+            fl->seen[pp->to_sector] = 1;
+            fl->line_on_path[pp->line] = 1;
+            ok = rj_flood( fl, NULL, pp->p, pp->to_sector, 1 );
+            fl->line_on_path[pp->line] = 0;
+            if( ! ok )
+                break;
+        }
+
+        if( ! ok )
+        {
+            // Too much to follow, sees all that it is connected to.
+            int sg = rj_group[s];
+            memset( fl->line_on_path, 0, numlines );
+            for( t=0; t<numsectors; t++ )
+            {
+                if( rj_group[t] == sg )
+                    fl->seen[t] = 1;
+            }
+            fl->fallback_count++;
+        }
+
+        for( t=0; t<numsectors; t++ )
+        {
+            if( fl->seen[t] )
+                RJ_SET( rj_vis, s*numsectors + t );
+        }
+    }
+}
+
+#ifdef LOAD_THREADS
+static void * rj_flood_thread( void * arg )
+{
+    rj_flood_sources( (rj_flood_t*) arg );
+    return NULL;
+}
+#endif
+
+// Start the flood of all source sectors.
+// With LOAD_THREADS the flood threads run while the level load goes on.
+static void  rj_gen_start( void )
+{
+    int n = 1;
+    int i, range;
+
+    rj_vis = Z_Malloc( rj_reject_size, PU_STATIC, NULL );
+    memset( rj_vis, 0, rj_reject_size );
+
+#ifdef LOAD_THREADS
+    n = sysconf( _SC_NPROCESSORS_ONLN );
+    if( n > MAX_FLOOD_THREADS )
+        n = MAX_FLOOD_THREADS;
+    // Small maps are not worth a thread.
+    if( n > numsectors / 64 )
+        n = numsectors / 64;
+    if( n < 1 )
+        n = 1;
+#endif
+
+    // Each range starts at a multiple of 8 sectors, so its rows start on
+    // a byte, and no two threads write the same byte of the table.
+    range = (((numsectors + n - 1) / n) + 7) & ~7;
+    rj_num_fl = 0;
+    for( i=0; i<n; i++ )
+    {
+        rj_flood_t * fl = &rj_fl[rj_num_fl];
+        fl->s1 = i * range;
+        fl->s2 = min( fl->s1 + range, numsectors );
+        if( fl->s1 >= fl->s2 )
+            break;
+        fl->seen = Z_Malloc( numsectors, PU_STATIC, NULL );
+        fl->line_on_path = Z_Malloc( numlines, PU_STATIC, NULL );
+        memset( fl->line_on_path, 0, numlines );
+        fl->fallback_count = 0;
+        rj_num_fl++;
+    }
+
+    for( i=0; i<rj_num_fl; i++ )
+    {
+#ifdef LOAD_THREADS
+        rj_fl[i].started =
+         ( pthread_create( &rj_fl[i].thread, NULL, rj_flood_thread, &rj_fl[i] ) == 0 );
+        if( rj_fl[i].started )
+            continue;
+#endif
+        rj_flood_sources( &rj_fl[i] );
+    }
+}
+
+// Wait for the flood, and finish the REJECT generation.
+void P_Load_Reject_Finish( void )
+{
+    int fallback_count = 0;
+    int i;
+
+    if( rj_reject == NULL )
+        return;
+
+    for( i=0; i<rj_num_fl; i++ )
+    {
+#ifdef LOAD_THREADS
+        if( rj_fl[i].started )
+            pthread_join( rj_fl[i].thread, NULL );
+        rj_fl[i].started = 0;
+#endif
+        fallback_count += rj_fl[i].fallback_count;
+    }
+
+    // The reject is the work space for the near rows.
+    // Twice, so a sight line can have an alias or near wall at both ends.
+    rj_find_near_walls();
+    rj_symmetric( rj_vis );
+    for( i=0; i<2; i++ )
+    {
+        if( rj_has_alias )
+            rj_alias_rows( rj_vis, rj_alias, rj_fl[0].seen );
+        rj_near_rows( rj_vis, rj_reject, rj_reject_size );
+        rj_symmetric( rj_vis );
+    }
+
+    // REJECT bit is set when not visible.
+    for( i=0; i<rj_reject_size; i++ )
+        rj_reject[i] = ~rj_vis[i];
+
+    GenPrintf(EMSG_info, "REJECT generated: %i sectors, %i portals, %i limited, %i threads, %i ms\n",
+              numsectors, rj_numportals, fallback_count, rj_num_fl,
+              (int)((M_Time_ns() - rj_start_ns) / 1000000) );
+
+    if( rj_write_cache )
+        P_Level_Cache_Write( REJECT_CACHE_KIND, REJECT_CACHE_VERSION, rj_reject, rj_reject_size );
+
+    rj_gen_free();
+}
+#endif
+
+
+// Load the REJECT table into rejectmatrix.
+//  lumpnum : the REJECT lump, NO_LUMP when the map does not have one
+void P_Load_Reject( lumpnum_t lumpnum )
+{
+    int reject_size = ((numsectors * numsectors) + 7) / 8;
+    int lumplen = ( VALID_LUMP(lumpnum) )? W_LumpLength( lumpnum ) : 0;
+    int i;
+
+#ifdef GENERATE_REJECT
+    reject_generated = 0;
+#endif
+
+    if( lumplen >= reject_size )
+    {
+        rejectmatrix = W_CacheLumpNum( lumpnum, PU_LEVEL );
+    }
+    else
+    {
+        // [WDJ] Short REJECT lump would read past the end.
+        // Pad with zeros, as in Boom.
+        rejectmatrix = Z_Malloc( reject_size, PU_LEVEL, NULL );
+        memset( rejectmatrix, 0, reject_size );
+        if( lumplen > 0 )
+            W_ReadLumpHeader( lumpnum, rejectmatrix, lumplen );
+    }
+
+    // A REJECT with any bit set was made for this map, keep it.
+    for( i=0; i<reject_size; i++ )
+    {
+        if( rejectmatrix[i] )
+            return;
+    }
+
+#ifdef GENERATE_REJECT
+    if( cv_reject_gen.EV == 0 )
+        return;
+
+    // The Boom sleeping sergeant bug emulation lets sight through walls.
+    if( EN_sleeping_sarg_bug )
+        return;
+
+    if( numsectors > MAX_GEN_SECTORS )
+        return;
+
+    {
+        byte * reject;
+
+        if( lumplen >= reject_size )
+        {
+            // Release the wad lump, and make a table that can be written.
+            Z_ChangeTag( rejectmatrix, PU_CACHE );
+            rejectmatrix = Z_Malloc( reject_size, PU_LEVEL, NULL );
+            memset( rejectmatrix, 0, reject_size );
+        }
+        reject = rejectmatrix;
+        reject_generated = 1;
+
+        if( cv_reject_gen.EV == 2 )
+        {
+            int cache_size;
+            const byte * cp = P_Level_Cache_Open( REJECT_CACHE_KIND, REJECT_CACHE_VERSION, &cache_size );
+            if( cp && cache_size == reject_size )
+            {
+                memcpy( reject, cp, reject_size );
+                P_Level_Cache_Close();
+                GenPrintf(EMSG_ver, "REJECT from cache\n" );
+                return;
+            }
+            P_Level_Cache_Close();
+        }
+
+        rj_reject = reject;
+        rj_reject_size = reject_size;
+        rj_write_cache = ( cv_reject_gen.EV == 2 );
+        rj_start_ns = M_Time_ns();
+        if( ! rj_gen_setup() )
+        {
+            // The table is left all zero.
+            rj_gen_free();
+            return;
+        }
+
+        // Finished by P_Load_Reject_Finish.
+        rj_gen_start();
+    }
+#endif
+}
@@ -0,0 +1,53 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 2024 by DooM Legacy Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+//
+// DESCRIPTION:
+//      REJECT table load, and generation.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef P_REJECT_H
+#define P_REJECT_H
+
+#include "doomdef.h"
+  // GENERATE_REJECT
+#include "doomtype.h"
+#include "command.h"
+  // consvar_t
+
+#ifdef GENERATE_REJECT
+extern consvar_t cv_reject_gen;
+// Set when rejectmatrix is a generated table, not the map REJECT.
+extern byte  reject_generated;
+#endif
+
+// Load the REJECT table into rejectmatrix.
+// When the lump is missing, or all zero, a table may be generated.
+// Needs the sectors, lines, segs, subsectors, and blockmap.
+// Call after P_GroupLines.
+//  lumpnum : the REJECT lump, NO_LUMP when the map does not have one
+void P_Load_Reject( lumpnum_t lumpnum );
+
+#ifdef GENERATE_REJECT
+// Finish the REJECT generation started by P_Load_Reject.
+void P_Load_Reject_Finish( void );
+#else
+#define P_Load_Reject_Finish()
+#endif
+
+#endif
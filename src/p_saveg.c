@@ -1126,6 +1126,8 @@ void P_UnArchiveWorld(void)
             secp->floorheight = READFIXED(get);
         if (diff & SD_CEILHT)
             secp->ceilingheight = READFIXED(get);
+        if (diff & (SD_FLOORHT|SD_CEILHT))
+            P_Sight_Cache_Clear();
         if (diff & SD_FLOORPIC)
         {
             secp->floorpic = P_AddLevelFlat((char *)get);  // find id
@@ -2250,8 +2252,7 @@ void P_UnArchiveThinkers(void)
         {
             case tc_mobj:
 
-                mobj = Z_Malloc(sizeof(mobj_t), PU_LEVEL, NULL);
-                memset(mobj, 0, sizeof(mobj_t));
+                mobj = P_Alloc_Mobj();
 
                 diff = READU32(save_p);
                 // [WDJ] initializing the lookup for GetMobjPointer and READ_MobjPointerID(),
@@ -3471,7 +3472,7 @@ void P_UnArchive_Bots()
 static
 void P_ArchiveMisc()
 {
-    uint32_t pig = 0;
+    uint64_t pig = 0;
     int i;
 
     WRITEBYTE(save_p, gameskill);
@@ -3479,9 +3480,13 @@ void P_ArchiveMisc()
     WRITEBYTE(save_p, gamemap);
 
     for (i = 0; i < MAXPLAYERS; i++)
-        pig |= (playeringame[i] != 0) << i;
+        pig |= ((uint64_t)(playeringame[i] != 0)) << i;
 
-    WRITEU32(save_p, pig);
+    WRITEU32(save_p, (uint32_t)pig);
+#if MAXPLAYERS > 32
+    // LARGE_LOBBY savegame, players 33..64
+    WRITEU32(save_p, (uint32_t)(pig >> 32));
+#endif
 
     WRITEU32(save_p, leveltime);
     WRITEBYTE(save_p, P_Rand_GetIndex());
@@ -3498,7 +3503,7 @@ void P_ArchiveMisc()
 static
 boolean P_UnArchiveMisc()
 {
-    uint32_t pig;
+    uint64_t pig;
     int i;
 
     SG_Readbuf();
@@ -3507,10 +3512,14 @@ boolean P_UnArchiveMisc()
     gamemap = READBYTE(save_p);
 
     pig = READU32(save_p);
+#if MAXPLAYERS > 32
+    // LARGE_LOBBY savegame, players 33..64
+    pig |= ((uint64_t)READU32(save_p)) << 32;
+#endif
 
     for (i = 0; i < MAXPLAYERS; i++)
     {
-        playeringame[i] = (pig & (1 << i)) != 0;
+        playeringame[i] = (pig & (((uint64_t)1) << i)) != 0;
         player_state[i] = (playeringame[i])? PS_player_from_savegame : 0;
         players[i].playerstate = PST_REBORN;
     }
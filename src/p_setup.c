@@ -157,6 +157,8 @@
 #ifdef DEEPSEA_EXTENDED_NODES
 #include "p_extnodes.h"  // [MB] 2020-04-21: For import of extended nodes
 #endif
+#include "p_reject.h"
+#include "p_lcache.h"
 #include "p_spec.h"
 #include "p_info.h"
 #include "g_game.h"
@@ -168,6 +170,10 @@
   // I_PlayCD()..
 #include "i_system.h"
   // I_Sleep
+#include "m_argv.h"
+  // M_CheckParm
+#include "m_profile.h"
+  // M_Time_ns
 
 #include "r_data.h"
 #include "r_things.h"
@@ -1398,6 +1404,10 @@ void P_LoadSideDefs2(int lump)
 
 
 #ifdef GENERATE_BLOCKMAP
+// The level cache kind, and the version of the generated blockmap.
+#define BLOCKMAP_CACHE_KIND     "bmap"
+#define BLOCKMAP_CACHE_VERSION  1
+
 CV_PossibleValue_t blockmap_gen_cons_t[]={{0,"Vanilla"}, {1,"Large"}, {2,"Generate"}, {3, "Auto"}, {0,NULL}};
 consvar_t cv_blockmap_gen = {"blockmap_gen", "3", CV_SAVE|CV_NETVAR, blockmap_gen_cons_t, NULL};
 #endif
@@ -1806,12 +1816,53 @@ generate_blockmap:
      Z_Free(wadblockmaplump);
   }
 
+  // A blockmap generated for this map before.
+  {
+      int cache_size;
+      const uint32_t * cp = (const uint32_t*)
+         P_Level_Cache_Open( BLOCKMAP_CACHE_KIND, BLOCKMAP_CACHE_VERSION, &cache_size );
+      count = cache_size / sizeof(uint32_t);
+      if( cp && count > 4
+          && (LE_SWAP32(cp[2]) * LE_SWAP32(cp[3])) + 4 < count )
+      {
+          blockmaphead = Z_Malloc(sizeof(*blockmaphead) * count, PU_LEVEL, NULL);
+          for( i=0; i<count; i++ )
+              blockmaphead[i] = LE_SWAP32( cp[i] );
+          P_Level_Cache_Close();
+
+          bmaporgx = blockmaphead[0]<<FRACBITS;
+          bmaporgy = blockmaphead[1]<<FRACBITS;
+          bmapwidth = blockmaphead[2];
+          bmapheight = blockmaphead[3];
+          GenPrintf( EMSG_ver, "Blockmap from cache\n" );
+          goto activate_blockmap;
+      }
+      P_Level_Cache_Close();
+  }
+
   // Create a new blockmap.
   GenPrintf( EMSG_warn, "Generate blockmap\n" );
-  P_create_blockmap();
+  count = P_create_blockmap();
   if( ! blockmaphead )
       goto blockmap_failed;
 
+  {
+#ifdef __BIG_ENDIAN__
+      uint32_t * le_bmap = malloc( sizeof(*blockmaphead) * count );
+      if( le_bmap )
+      {
+          for( i=0; i<count; i++ )
+              le_bmap[i] = LE_SWAP32( blockmaphead[i] );
+          P_Level_Cache_Write( BLOCKMAP_CACHE_KIND, BLOCKMAP_CACHE_VERSION,
+                               le_bmap, sizeof(*blockmaphead) * count );
+          free( le_bmap );
+      }
+#else
+      P_Level_Cache_Write( BLOCKMAP_CACHE_KIND, BLOCKMAP_CACHE_VERSION,
+                           blockmaphead, sizeof(*blockmaphead) * count );
+#endif
+  }
+
   // success, activate the blockmap
   goto activate_blockmap;
 #endif
@@ -2158,6 +2209,21 @@ void P_Setup_LevelSky (void)
 lumpnum_t  level_lumpnum = 0;  // for info and comparative savegame
 char*  level_mapname = NULL;  // to savegame and info
 
+// Level load timing, -levelload_timing.
+static byte      levelload_timing = 0;
+static uint64_t  levelload_start_ns, levelload_stage_ns;
+
+// Print the time of the stage that just ended.
+static void P_Load_Stage( const char * name )
+{
+    uint64_t now_ns = M_Time_ns();
+
+    if( levelload_timing )
+        CONS_Printf( "  %-16s %7.2f ms\n", name,
+                     (double)(now_ns - levelload_stage_ns) / 1000000.0 );
+    levelload_stage_ns = now_ns;
+}
+
 //  to_episode : change to episode num
 //  to_map : change to map number
 //  to_skill : change to skill
@@ -2176,8 +2242,14 @@ boolean P_SetupLevel (int      to_episode,
     GenPrintf( (verbose? (EMSG_ver|EMSG_now) : (EMSG_console|EMSG_now)),
                "Setup Level\n" );
 
+    levelload_timing = M_CheckParm( "-levelload_timing" );
+    levelload_start_ns = levelload_stage_ns = M_Time_ns();
+
     //Initialize Boom sector node list.
     P_Init_Secnode();
+#ifdef SIGHT_CACHE
+    P_Sight_Cache_Init();
+#endif
 
     // Clear existing level variables and reclaim memory.
     totalkills = totalitems = totalsecret = wminfo.maxfrags = 0;
@@ -2246,6 +2318,7 @@ boolean P_SetupLevel (int      to_episode,
     // UNUSED W_Profile ();
     
     P_Init_Thinkers ();
+    P_Load_Stage( "free level" );
 
     // Loading new level map.
 
@@ -2283,6 +2356,7 @@ boolean P_SetupLevel (int      to_episode,
     if(level_mapname)   Z_Free(level_mapname);
     level_mapname = Z_Strdup(sl_mapname, PU_STATIC, 0);  // MAP01 or E1M1, etc.
     level_lumpnum = W_GetNumForName(sl_mapname);
+    P_Level_Cache_Init();
 
     leveltime = 0;
 
@@ -2312,6 +2386,7 @@ boolean P_SetupLevel (int      to_episode,
     P_Init_PicAnims ();
     P_Init_Lava ();
     P_Setup_LevelSky ();
+    P_Load_Stage( "level info" );
 
     // SoM: WOO HOO!
     // SoM: DOH!
@@ -2354,10 +2429,12 @@ boolean P_SetupLevel (int      to_episode,
     P_LoadVertexes (level_lumpnum+ML_VERTEXES);
     P_LoadSectors  (level_lumpnum+ML_SECTORS);
     P_LoadSideDefs (level_lumpnum+ML_SIDEDEFS);
+    P_Load_Stage( "vertexes, sectors" );
 
     P_LoadLineDefs (level_lumpnum+ML_LINEDEFS);
     P_LoadSideDefs2(level_lumpnum+ML_SIDEDEFS);
     P_LoadLineDefs2();
+    P_Load_Stage( "linedefs" );
 
     // Generate blockmap needs vertexes and linedefs.
     // PrBoom has here after, instead of before as in Vanilla.
@@ -2367,6 +2444,7 @@ boolean P_SetupLevel (int      to_episode,
         errstr = "Blockmap error";
         goto load_reject;
     }
+    P_Load_Stage( "blockmap" );
 
 #ifdef DEEPSEA_EXTENDED_NODES
     // [MB] 2020-04-21: Hook in code imported from woof 1.2.0 (p_extnodes.c)
@@ -2390,14 +2468,25 @@ boolean P_SetupLevel (int      to_episode,
         P_LoadNodes (level_lumpnum+ML_NODES);
         P_LoadSegs (level_lumpnum+ML_SEGS);
     }
+    P_Load_Stage( "nodes" );
 
-    rejectmatrix = W_CacheLumpNum (level_lumpnum+ML_REJECT,PU_LEVEL);
     P_GroupLines ();
+    P_Load_Stage( "group lines" );
+    P_Init_SoundGraph ();
+#ifdef THING_GRID
+    P_Init_ThingGrid ();
+#endif
+    P_Load_Stage( "sound, thing grid" );
+    // A generated REJECT is finished by P_Load_Reject_Finish.
+    P_Load_Reject( (P_CheckLumpName( level_lumpnum+ML_REJECT, ML_REJECT ) == ML_REJECT)?
+                   level_lumpnum+ML_REJECT : NO_LUMP );
+    P_Load_Stage( "reject" );
 
 #ifdef HWRENDER
     if( rendermode != render_soft )
     {
         HWR_SetupLevel();
+        P_Load_Stage( "hw setup" );
     }
 #endif
 
@@ -2414,10 +2503,12 @@ boolean P_SetupLevel (int      to_episode,
     P_OpenWeapons ();
     P_LoadThings (level_lumpnum+ML_THINGS);
     P_CloseWeapons ();
+    P_Load_Stage( "things" );
 
     // set up world state
     P_SpawnSpecials ();
     P_Init_BrainTarget();
+    P_Load_Stage( "specials" );
 
     //BP: spawnplayers after all structures are inititialized
     for (i=0 ; i<MAXPLAYERS ; i++)
@@ -2460,21 +2551,34 @@ boolean P_SetupLevel (int      to_episode,
     if( rendermode != render_soft )
     {
         HWR_Preload_Graphics();
+        P_Load_Stage( "hw preload" );
     }
 #endif
 
     if (precache)
+    {
         R_PrecacheLevel ();
+        P_Load_Stage( "precache" );
+    }
 
 
 #ifdef FRAGGLESCRIPT
     T_Init_FSArrayList();         // Setup FS array list
     T_PreprocessScripts();        // preprocess FraggleScript scripts
+    P_Load_Stage( "scripts" );
 #endif
 
     script_camera_on = false;
 
     B_Init_Nodes();  //added by AC for acbot
+    P_Load_Stage( "bot nodes" );
+
+    P_Load_Reject_Finish();
+    P_Load_Stage( "reject finish" );
+
+    if( levelload_timing )
+        CONS_Printf( "  %-16s %7.2f ms\n", "level load",
+                     (double)(M_Time_ns() - levelload_start_ns) / 1000000.0 );
 
     //debug_Printf("P_SetupLevel: %d vertexs %d segs %d subsector\n",numvertexes,numsegs,numsubsectors);
     return true;
@@ -115,6 +115,7 @@ extern boolean  newlevel;
 extern boolean  doom1level;
 
 // Create a blockmap.
-void P_create_blockmap( void );
+// Return the number of blockmaphead entries.
+int P_create_blockmap( void );
 
 #endif
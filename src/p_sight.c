@@ -41,9 +41,25 @@
 
 #include "doomincl.h"
 #include "doomstat.h"
+#include "m_profile.h"
 #include "p_local.h"
 #include "r_state.h"
 #include "r_main.h"
+#include "p_reject.h"
+  // reject_generated
+#ifdef SIGHT_CACHE
+#include "command.h"
+#include "console.h"
+#endif
+#ifdef SIGHT_THREADS
+#include <pthread.h>
+#include "p_tick.h"
+  // thinkercap
+#include "action.h"
+  // A_Look, A_Chase
+#include "g_game.h"
+  // players
+#endif
 
 //
 // P_CheckSight
@@ -52,13 +68,22 @@
 fixed_t         see_topslope;
 fixed_t         see_bottomslope;   // slopes to top and bottom of target
 
-// Check Sight internal global vars
-static divline_t       cs_trace;        // from t1 to t2
-static subsector_t *   cs_t2_subsector; // location of t2
-static fixed_t         cs_t2x, cs_t2y;
-static fixed_t         cs_startz;       // eye z of looker
+// Check Sight trace state.
+// The main thread uses cs_main, which marks the lines with validcount.
+// A sight thread has its own, with its own line marks.
+typedef struct {
+    divline_t       trace;        // from t1 to t2
+    subsector_t *   t2_subsector; // location of t2
+    fixed_t         t2x, t2y;
+    fixed_t         startz;       // eye z of looker
+    fixed_t         topslope, bottomslope;  // slopes to top and bottom of target
+    fixed_t         prev_frac;    // sight trace frac from last linedef crossing
+    uint32_t *      linemark;     // per line, NULL uses line validcount
+    uint32_t        markgen;
+    int             sightcounts[2];  // ??? debugging
+} sight_trace_t;
 
-static int             cs_sightcounts[2];  // ??? debugging
+static sight_trace_t  cs_main;
 
 
 //
@@ -123,11 +148,9 @@ static fixed_t P_InterceptVector2( divline_t* v2, divline_t* v1 )
 }
 
 
-static fixed_t  prev_frac;  // sight trace frac from last linedef crossing
-
 // Clip the sight line with the solid 3dfloors.
-// At the position along the cs_trace sight line, at frac.
-static void intercept_ffloor( subsector_t * ssec, fixed_t frac )
+// At the position along the sight trace line, at frac.
+static void intercept_ffloor( sight_trace_t * st, subsector_t * ssec, fixed_t frac )
 {
     fixed_t  t_slope, b_slope;
     fixed_t  clip_frac_t, clip_frac_b;
@@ -148,57 +171,57 @@ static void intercept_ffloor( subsector_t * ssec, fixed_t frac )
         th = *ff->topheight;
         bh = *ff->bottomheight;
 
-        if( cs_startz > th )
+        if( st->startz > th )
         {
            // look down on floor
            clip_frac_t = frac;
-           clip_frac_b = prev_frac;
+           clip_frac_b = st->prev_frac;
         }
-        else if ( cs_startz < bh )
+        else if ( st->startz < bh )
         {
            // look up at floor
-           clip_frac_t = prev_frac;
+           clip_frac_t = st->prev_frac;
            clip_frac_b = frac;
         }
         else
         {
            // edge of floor at eye height
-           clip_frac_t = prev_frac;
-           clip_frac_b = prev_frac;
+           clip_frac_t = st->prev_frac;
+           clip_frac_b = st->prev_frac;
         }
         // Quick rejects.
-        if( FixedMul( see_bottomslope, clip_frac_t ) > (th - cs_startz) )
+        if( FixedMul( st->bottomslope, clip_frac_t ) > (th - st->startz) )
            continue;  // bottom sight is above highest part of floor
-        if( FixedMul( see_topslope, clip_frac_b ) < (bh - cs_startz) )
+        if( FixedMul( st->topslope, clip_frac_b ) < (bh - st->startz) )
            continue;  // top sight is below lowest part of floor
        
         // Compare the occlusion slopes to the sight line slopes.
-        t_slope = FixedDiv (th - cs_startz , clip_frac_t);
-        b_slope = FixedDiv (bh - cs_startz , clip_frac_b);
+        t_slope = FixedDiv (th - st->startz , clip_frac_t);
+        b_slope = FixedDiv (bh - st->startz , clip_frac_b);
 
         // Assume t_slope > b_slope.
-        // Assume see_topslope > see_bottomslope.
-        // Assume b_slope < see_topslope and t_slope > see_bottomslope.
-        if( b_slope <= see_bottomslope )
+        // Assume st->topslope > st->bottomslope.
+        // Assume b_slope < st->topslope and t_slope > st->bottomslope.
+        if( b_slope <= st->bottomslope )
         {
-            if( t_slope >= see_topslope )
+            if( t_slope >= st->topslope )
             {
                 // This occurs most often, so make it first test.
-                see_bottomslope = FIXED_MAX; // total occlusion
-                see_topslope = FIXED_MIN;
+                st->bottomslope = FIXED_MAX; // total occlusion
+                st->topslope = FIXED_MIN;
                 break;
             }
-            // (t_slope < see_topslope)
-            see_bottomslope = t_slope;  // th clips bottom sight
+            // (t_slope < st->topslope)
+            st->bottomslope = t_slope;  // th clips bottom sight
         }
         else
         {
-            // (b_slope > see_bottomslope).
+            // (b_slope > st->bottomslope).
             // If this is simplified there will be overflow math errors in
-            // (see_topslope - t_slope) when near the viewer (t_slope -> FIXED_MAX).
-            if( t_slope >= see_topslope )
+            // (st->topslope - t_slope) when near the viewer (t_slope -> FIXED_MAX).
+            if( t_slope >= st->topslope )
             {
-                see_topslope = b_slope;  // bh clips top sight
+                st->topslope = b_slope;  // bh clips top sight
             }
             else
             {
@@ -206,17 +229,17 @@ static void intercept_ffloor( subsector_t * ssec, fixed_t frac )
                 // Trying to clip both top and bottom will loose everything.
                 // Keep only the largest gap in the sight lines.
                 // Block the 3dfloor and lose the other sight gap.
-                if( (see_topslope - t_slope) > (b_slope - see_bottomslope) )
+                if( (st->topslope - t_slope) > (b_slope - st->bottomslope) )
                 {
-                    see_bottomslope = t_slope;  // th clips bottom sight
+                    st->bottomslope = t_slope;  // th clips bottom sight
                 }
-                else if( b_slope < see_topslope )
+                else if( b_slope < st->topslope )
                 {
-                    see_topslope = b_slope;  // bh clips top sight
+                    st->topslope = b_slope;  // bh clips top sight
                 }
             }
         }
-        if (see_topslope <= see_bottomslope)  break;  // cannot see
+        if (st->topslope <= st->bottomslope)  break;  // cannot see
     }
 }
 
@@ -224,9 +247,9 @@ static void intercept_ffloor( subsector_t * ssec, fixed_t frac )
 //
 // P_CrossSubsector
 // Returns true
-//  if cs_trace crosses the given subsector successfully.
+//  if the sight trace crosses the given subsector successfully.
 //
-static boolean P_CrossSubsector (int num)
+static boolean P_CrossSubsector ( sight_trace_t * st, int num )
 {
     seg_t  * seg;
     line_t * line;
@@ -247,16 +270,16 @@ static boolean P_CrossSubsector (int num)
 #endif
 
     sub = &subsectors[num];
-    if( sub == cs_t2_subsector )
+    if( sub == st->t2_subsector )
     {
         // This is the subsector that t2 is within, so there cannot be
         // any new linedef crossings.
         if( sub->sector->ffloors )
         {
             // Clip for the 3dfloors.
-            intercept_ffloor( sub, FRACUNIT );
+            intercept_ffloor( st, sub, FRACUNIT );
 
-            if (see_topslope <= see_bottomslope)
+            if (st->topslope <= st->bottomslope)
                return false;               // stop
         }
 
@@ -275,10 +298,20 @@ static boolean P_CrossSubsector (int num)
         line = seg->linedef;
 
         // already checked other side?
-        if (line->validcount == validcount)
-            continue;
+        if( st->linemark )
+        {
+            uint32_t * mark = & st->linemark[ line - lines ];
+            if( *mark == st->markgen )
+                continue;
+            *mark = st->markgen;
+        }
+        else
+        {
+            if (line->validcount == validcount)
+                continue;
 
-        line->validcount = validcount;
+            line->validcount = validcount;
+        }
        
         // [WDJ] PrBoom does bounding box check here, but it causes the
         // original Doom demos to lose sync. We also lose sync because
@@ -287,19 +320,19 @@ static boolean P_CrossSubsector (int num)
         // Check the vertex of the line segment against the sight trace.
         v1 = line->v1;
         v2 = line->v2;
-        s1 = P_DivlineSide (v1->x, v1->y, &cs_trace);
-        s2 = P_DivlineSide (v2->x, v2->y, &cs_trace);
+        s1 = P_DivlineSide (v1->x, v1->y, &st->trace);
+        s2 = P_DivlineSide (v2->x, v2->y, &st->trace);
 
         // line isn't crossed?
         if (s1 == s2)
-            continue;  // both vertex of the linedef are on same side of cs_trace
+            continue;  // both vertex of the linedef are on same side of st->trace
 
         divl.x = v1->x;
         divl.y = v1->y;
         divl.dx = v2->x - v1->x;
         divl.dy = v2->y - v1->y;
-        s1 = P_DivlineSide (cs_trace.x, cs_trace.y, &divl);
-        s2 = P_DivlineSide (cs_t2x, cs_t2y, &divl);
+        s1 = P_DivlineSide (st->trace.x, st->trace.y, &divl);
+        s2 = P_DivlineSide (st->t2x, st->t2y, &divl);
 
         // line isn't crossed?
         if (s1 == s2)
@@ -343,44 +376,44 @@ static boolean P_CrossSubsector (int num)
         // Fraction of the sight trace covered.
 #if 0
         frac = ((EV_legacy > 0)?
-                P_InterceptVector2(&cs_trace, &divl)
+                P_InterceptVector2(&st->trace, &divl)
                 : ( (demoversion < 212)?  // < prboom 4
-                    P_InterceptVector2(&cs_trace, &divl)
+                    P_InterceptVector2(&st->trace, &divl)
                     : (demoversion >= 213 && demoversion <= 214)?  // prboom 5, prboom 6
-                    P_InterceptVector2(&cs_trace, &divl)
-                    : P_InterceptVector_64(&cs_trace, &divl)
+                    P_InterceptVector2(&st->trace, &divl)
+                    : P_InterceptVector_64(&st->trace, &divl)
                   )
 
 #else
-        frac = P_InterceptVector2 (&cs_trace, &divl);
+        frac = P_InterceptVector2 (&st->trace, &divl);
 #endif
 
         if (front->floorheight != back->floorheight)
         {
-            slope = FixedDiv (openbottom - cs_startz , frac);
-            if (slope > see_bottomslope)
-                see_bottomslope = slope;
+            slope = FixedDiv (openbottom - st->startz , frac);
+            if (slope > st->bottomslope)
+                st->bottomslope = slope;
         }
 
         if (front->ceilingheight != back->ceilingheight)
         {
-            slope = FixedDiv (opentop - cs_startz , frac);
-            if (slope < see_topslope)
-                see_topslope = slope;
+            slope = FixedDiv (opentop - st->startz , frac);
+            if (slope < st->topslope)
+                st->topslope = slope;
         }
 
-        if (see_topslope <= see_bottomslope)
+        if (st->topslope <= st->bottomslope)
             return false;               // stop
 
         if( sub->sector->ffloors )
         {
             // Clip for the 3dfloors.
-            intercept_ffloor( sub, frac );
+            intercept_ffloor( st, sub, frac );
 
-            if (see_topslope <= see_bottomslope)
+            if (st->topslope <= st->bottomslope)
                return false;               // stop
         }
-        prev_frac = frac;
+        st->prev_frac = frac;
     }
 
     // passed the subsector ok
@@ -392,9 +425,9 @@ static boolean P_CrossSubsector (int num)
 //
 // P_CrossBSPNode
 // Returns true
-//  if cs_trace crosses the given node successfully.
+//  if the sight trace crosses the given node successfully.
 //
-static boolean P_CrossBSPNode (int bspnum)
+static boolean P_CrossBSPNode ( sight_trace_t * st, int bspnum )
 {
   node_t * bsp;
   int      side;
@@ -405,12 +438,12 @@ static boolean P_CrossBSPNode (int bspnum)
     bsp = &nodes[bspnum];
 
     // decide which side the start point is on
-    side = P_DivlineSide (cs_trace.x, cs_trace.y, (divline_t *)bsp);
+    side = P_DivlineSide (st->trace.x, st->trace.y, (divline_t *)bsp);
     side &= 0x01;  // 2 ==> 0, an "on" should cross both sides
 
     // [WDJ] As in PrBoom and EternityEngine.
     // The partition plane is crossed here.
-    if( side == P_DivlineSide( cs_t2x, cs_t2y, (divline_t *)bsp) )
+    if( side == P_DivlineSide( st->t2x, st->t2y, (divline_t *)bsp) )
     {
         // cross the starting side, using loop
         bspnum = bsp->children[side]; // the line doesn't touch the other side
@@ -418,7 +451,7 @@ static boolean P_CrossBSPNode (int bspnum)
     else
     {
         // the partition plane is crossed here
-        if( !P_CrossBSPNode( bsp->children[side]) )
+        if( !P_CrossBSPNode( st, bsp->children[side]) )
             return false;   // cross the starting side
 
         // cross the ending side, using loop
@@ -427,9 +460,43 @@ static boolean P_CrossBSPNode (int bspnum)
   }
 
   if( bspnum == -1 )
-      return P_CrossSubsector (0);
+      return P_CrossSubsector (st, 0);
    
-  return P_CrossSubsector( bspnum & ~NF_SUBSECTOR );
+  return P_CrossSubsector( st, bspnum & ~NF_SUBSECTOR );
+}
+
+
+// Start a new sight trace, the lines crossed are marked with a new mark.
+static inline void sight_trace_newmark( sight_trace_t * st )
+{
+    if( st->linemark == NULL )
+    {
+        validcount++;
+        return;
+    }
+
+    st->markgen++;
+    if( st->markgen == 0 )
+    {
+        // wrap
+        memset( st->linemark, 0, numlines * sizeof(uint32_t) );
+        st->markgen = 1;
+    }
+}
+
+// Run the sight trace through the BSP.
+static boolean sight_trace_cross( sight_trace_t * st )
+{
+    // the head node is the last node output
+    boolean result = P_CrossBSPNode( st, numnodes-1 );
+
+    if( st == &cs_main )
+    {
+        // Check Sight global return vars
+        see_topslope = st->topslope;
+        see_bottomslope = st->bottomslope;
+    }
+    return result;
 }
 
 
@@ -440,7 +507,7 @@ static boolean P_CrossBSPNode (int bspnum)
 //  if a straight line between t1 and t2 is unobstructed.
 // Uses REJECT.
 //
-boolean P_CheckSight( mobj_t* t1, mobj_t* t2 )
+static boolean check_sight( sight_trace_t * st, mobj_t* t1, mobj_t* t2 )
 {
     const sector_t * s1p = t1->subsector->sector;
     const sector_t * s2p = t2->subsector->sector;
@@ -457,7 +524,7 @@ boolean P_CheckSight( mobj_t* t1, mobj_t* t2 )
     // Check in REJECT table.
     if (rejectmatrix[bytenum]&bitnum)
     {
-        cs_sightcounts[0]++;
+        st->sightcounts[0]++;
 
         // can't possibly be connected
         goto ret_false;
@@ -521,9 +588,9 @@ boolean P_CheckSight( mobj_t* t1, mobj_t* t2 )
         //
         // check precisely
         //              
-        cs_startz = t1->z + t1->height - (t1->height>>2);
-        see_topslope = (t2->z+t2->height) - cs_startz;
-        see_bottomslope = (t2->z) - cs_startz;
+        st->startz = t1->z + t1->height - (t1->height>>2);
+        st->topslope = (t2->z+t2->height) - st->startz;
+        st->bottomslope = (t2->z) - st->startz;
         
         return P_SightPathTraverse ( t1->x, t1->y, t2->x, t2->y );
     }
@@ -538,29 +605,28 @@ boolean P_CheckSight( mobj_t* t1, mobj_t* t2 )
 
     // An unobstructed LOS is possible.
     // Now look from eyes of t1 to any part of t2.
-    cs_sightcounts[1]++;
+    st->sightcounts[1]++;
 
-    validcount++;
+    sight_trace_newmark( st );
 
-    cs_startz = t1->z + t1->height - (t1->height>>2);  // eyes at 3/4
+    st->startz = t1->z + t1->height - (t1->height>>2);  // eyes at 3/4
     // Slope is (height / horz.), where horz. is measured such that the
     // the distance from eyes to target = 1.  Slope here is (height/1).
-    see_bottomslope = t2->z - cs_startz;           // feet of target
-    see_topslope = see_bottomslope + t2->height;   // head of target
-
-    cs_trace.x = t1->x;
-    cs_trace.y = t1->y;
-    cs_t2x = t2->x;
-    cs_t2y = t2->y;
-    cs_trace.dx = t2->x - t1->x;
-    cs_trace.dy = t2->y - t1->y;
-    cs_t2_subsector = t2->subsector;  // location of t2
+    st->bottomslope = t2->z - st->startz;           // feet of target
+    st->topslope = st->bottomslope + t2->height;   // head of target
+
+    st->trace.x = t1->x;
+    st->trace.y = t1->y;
+    st->t2x = t2->x;
+    st->t2y = t2->y;
+    st->trace.dx = t2->x - t1->x;
+    st->trace.dy = t2->y - t1->y;
+    st->t2_subsector = t2->subsector;  // location of t2
    
     // Setup for 3dfloor sight tests
-    prev_frac = 0;
+    st->prev_frac = 0;
 
-    // the head node is the last node output
-    return P_CrossBSPNode (numnodes-1);
+    return sight_trace_cross( st );
 
 ret_true:
     return true;
@@ -569,6 +635,409 @@ ret_false:
     return false;
 }
 
+#ifdef SIGHT_CACHE
+// Memo of P_CheckSight results.
+// Monsters ask for the same sight many times in a tic.
+// The result only depends upon the positions of t1 and t2, and upon the
+// sector heights.  An entry is valid for one sight_cache_gen, which changes
+// every tic, and whenever a plane moves.  A cached answer is the same as
+// the BSP walk would return, and nothing else depends upon the walk, so
+// demo sync is kept.
+#define SIGHT_CACHE_SIZE  1024   // power of 2
+
+typedef struct {
+    const mobj_t *  t1, * t2;
+    const subsector_t * ss1, * ss2;
+    fixed_t   x1, y1, z1, h1;
+    fixed_t   x2, y2, z2, h2;
+    uint32_t  gen;
+    boolean   result;
+} sight_cache_t;
+
+static sight_cache_t  sight_cache[SIGHT_CACHE_SIZE];
+static uint32_t  sight_cache_gen = 1;
+
+static uint32_t  sc_checks, sc_hits;  // this level
+
+// The entry is the sight of t1 to t2, as they are now.
+static inline boolean sight_cache_match( const sight_cache_t * scp,
+                                         const mobj_t * t1, const mobj_t * t2 )
+{
+    return scp->gen == sight_cache_gen
+        && scp->t1 == t1 && scp->t2 == t2
+        && scp->x1 == t1->x && scp->y1 == t1->y
+        && scp->z1 == t1->z && scp->h1 == t1->height
+        && scp->x2 == t2->x && scp->y2 == t2->y
+        && scp->z2 == t2->z && scp->h2 == t2->height
+        && scp->ss1 == t1->subsector && scp->ss2 == t2->subsector;
+}
+
+static void sight_cache_set( sight_cache_t * scp,
+                             const mobj_t * t1, const mobj_t * t2 )
+{
+    scp->t1 = t1;
+    scp->t2 = t2;
+    scp->ss1 = t1->subsector;
+    scp->ss2 = t2->subsector;
+    scp->x1 = t1->x;
+    scp->y1 = t1->y;
+    scp->z1 = t1->z;
+    scp->h1 = t1->height;
+    scp->x2 = t2->x;
+    scp->y2 = t2->y;
+    scp->z2 = t2->z;
+    scp->h2 = t2->height;
+    scp->gen = sight_cache_gen;
+}
+
+#ifdef SIGHT_THREADS
+// Sight threads, sight_threads.
+// Before the thinkers run, the sight checks that the monsters about to
+// act (A_Look, A_Chase) will most likely make, are done by worker threads.
+// Nothing in the world changes while they run.  The thinkers then run
+// in order, as always, and P_CheckSight uses a prefetched result only
+// under the same rule as the memo: same t1, t2, positions, and plane
+// generation.  Anything else is checked as before, so the results, and
+// the P_Random calls, are the same, and demo sync is kept.
+#define MAX_SIGHT_THREADS  16
+
+CV_PossibleValue_t sight_threads_cons_t[] = { {0, "MIN"}, {MAX_SIGHT_THREADS, "MAX"}, {0, NULL} };
+// 0,1 = no prefetch, otherwise the number of threads, with the main thread.
+consvar_t cv_sight_threads = {"sight_threads", "0", CV_SAVE, sight_threads_cons_t};
+
+// Prefetch hash table, linear probing, t1 NULL is empty.
+static sight_cache_t *  sight_pre = NULL;  // realloc
+static int  sight_pre_size = 0;  // power of 2
+static int  sight_pre_count = 0;
+static uint32_t  sight_pre_gen = 0;  // sight_cache_gen of the prefetch
+
+static uint32_t  sc_pre_hits;  // this level
+
+typedef struct {
+    pthread_t  thread;
+    sight_trace_t  st;
+    int  max_linemark;
+    int  first, last;  // sight_pre slots
+    unsigned int  generation;  // last prefetch done, under sight_mutex
+} sight_worker_t;
+
+// Worker 0 is the main thread.
+static sight_worker_t  sight_worker[MAX_SIGHT_THREADS];
+static int  sight_num_threads = 1;  // main thread and workers started
+
+static pthread_mutex_t  sight_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   sight_start_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t   sight_done_cond = PTHREAD_COND_INITIALIZER;
+static unsigned int  sight_generation = 0;  // one per prefetch
+static int  sight_pending = 0;  // workers still checking
+
+static inline uint32_t sight_pre_hash( const mobj_t * t1, const mobj_t * t2 )
+{
+    return ((uint32_t)(uintptr_t)t1 >> 4) * 2654435761u
+      ^ ((uint32_t)(uintptr_t)t2 >> 4) * 40503u;
+}
+
+static sight_cache_t * sight_pre_find( const mobj_t * t1, const mobj_t * t2 )
+{
+    int  mask = sight_pre_size - 1;
+    int  h = sight_pre_hash( t1, t2 ) & mask;
+
+    for(;;)
+    {
+        sight_cache_t * scp = &sight_pre[h];
+        if( scp->t1 == NULL
+            || (scp->t1 == t1 && scp->t2 == t2) )
+            return scp;
+        h = (h + 1) & mask;
+    }
+}
+
+static void sight_pre_alloc( int size )
+{
+    sight_pre = realloc( sight_pre, size * sizeof(sight_cache_t) );
+    if( sight_pre == NULL )
+        I_Error( "Sight threads: table alloc failed\n" );
+    sight_pre_size = size;
+    memset( sight_pre, 0, size * sizeof(sight_cache_t) );
+}
+
+// Queue the sight check of t1 to t2.
+static void sight_pre_add( const mobj_t * t1, const mobj_t * t2 )
+{
+    sight_cache_t * scp;
+
+    if( sight_pre_count * 2 >= sight_pre_size )
+    {
+        // Grow, and put the entries back.
+        sight_cache_t * old = sight_pre;
+        int  old_size = sight_pre_size;
+        int  i;
+
+        sight_pre = NULL;
+        sight_pre_alloc( old_size * 2 );
+        for( i = 0; i < old_size; i++ )
+        {
+            if( old[i].t1 )
+                *sight_pre_find( old[i].t1, old[i].t2 ) = old[i];
+        }
+        free( old );
+    }
+
+    scp = sight_pre_find( t1, t2 );
+    if( scp->t1 )
+        return;  // already queued
+    sight_cache_set( scp, t1, t2 );
+    sight_pre_count++;
+}
+
+static void sight_pre_check( sight_worker_t * wp )
+{
+    sight_cache_t * scp = & sight_pre[ wp->first ];
+    sight_cache_t * end = & sight_pre[ wp->last ];
+
+    if( wp->max_linemark < numlines )
+    {
+        wp->st.linemark = realloc( wp->st.linemark, numlines * sizeof(uint32_t) );
+        if( wp->st.linemark == NULL )
+            I_Error( "Sight threads: line mark alloc failed\n" );
+        memset( wp->st.linemark, 0, numlines * sizeof(uint32_t) );
+        wp->max_linemark = numlines;
+    }
+
+    for( ; scp < end; scp++ )
+    {
+        if( scp->t1 )
+            scp->result = check_sight( &wp->st, (mobj_t*)scp->t1, (mobj_t*)scp->t2 );
+    }
+}
+
+static void * sight_worker_func( void * arg )
+{
+    sight_worker_t * wp = (sight_worker_t*) arg;
+
+    for(;;)
+    {
+        // Started with the current generation, so a new worker waits
+        // for the next prefetch, and its first, last.
+        pthread_mutex_lock( &sight_mutex );
+        while( sight_generation == wp->generation )
+            pthread_cond_wait( &sight_start_cond, &sight_mutex );
+        wp->generation = sight_generation;
+        pthread_mutex_unlock( &sight_mutex );
+
+        sight_pre_check( wp );
+
+        pthread_mutex_lock( &sight_mutex );
+        if( --sight_pending == 0 )
+            pthread_cond_signal( &sight_done_cond );
+        pthread_mutex_unlock( &sight_mutex );
+    }
+    return NULL;
+}
+
+//
+// P_Sight_Prefetch
+// Called by P_Ticker, before the thinkers run.
+//
+void P_Sight_Prefetch( void )
+{
+    int  num_threads = cv_sight_threads.EV;
+    thinker_t * th;
+    int  i, p;
+    PROF_ZONE( zt );
+
+    sight_pre_count = 0;
+    if( num_threads < 2 )
+        goto done;
+
+    // Start more workers when needed, they are never stopped.
+    while( sight_num_threads < num_threads )
+    {
+        sight_worker_t * wp = & sight_worker[sight_num_threads];
+        int  err;
+        wp->first = wp->last = 0;
+        pthread_mutex_lock( &sight_mutex );
+        wp->generation = sight_generation;
+        err = pthread_create( &wp->thread, NULL, sight_worker_func, wp );
+        pthread_mutex_unlock( &sight_mutex );
+        if( err )
+        {
+            GenPrintf( EMSG_warn, "Sight threads: only %i threads started\n", sight_num_threads );
+            cv_sight_threads.EV = sight_num_threads;
+            num_threads = sight_num_threads;
+            if( num_threads < 2 )
+                goto done;
+            break;
+        }
+        pthread_detach( wp->thread );
+        sight_num_threads++;
+    }
+
+    if( sight_pre == NULL )
+        sight_pre_alloc( 1024 );
+    else
+        memset( sight_pre, 0, sight_pre_size * sizeof(sight_cache_t) );
+    sight_pre_gen = sight_cache_gen;
+
+    // The monsters that will act this tic.
+    for( th = thinkercap.next; th != &thinkercap; th = th->next )
+    {
+        mobj_t * mo;
+        actionf_p1  action;
+
+        if( th->function.acp1 != (actionf_p1) P_MobjThinker )
+            continue;
+
+        mo = (mobj_t*) th;
+        if( mo->tics != 1 )
+            continue;  // no state change this tic
+
+        action = states[ mo->state->nextstate ].action.acp1;
+        if( action == (actionf_p1) A_Look )
+        {
+            mobj_t * targ = mo->subsector->sector->soundtarget;
+            if( targ && (targ->flags & MF_SHOOTABLE) && (mo->flags & MF_AMBUSH) )
+                sight_pre_add( mo, targ );
+        }
+        else if( action == (actionf_p1) A_Chase )
+        {
+            // P_CheckMissileRange, P_CheckMeleeRange
+            if( mo->target )
+                sight_pre_add( mo, mo->target );
+            continue;
+        }
+        else
+            continue;
+
+        // P_LookForPlayers
+        for( p = 0; p < MAXPLAYERS; p++ )
+        {
+            if( playeringame[p] && players[p].mo && players[p].health > 0 )
+                sight_pre_add( mo, players[p].mo );
+        }
+    }
+
+    if( sight_pre_count == 0 )
+        goto done;
+
+    // Each thread checks a part of the table, the main thread is 0.
+    for( i = 0; i < sight_num_threads; i++ )
+    {
+        sight_worker_t * wp = & sight_worker[i];
+        if( i < num_threads )
+        {
+            wp->first = (i * sight_pre_size) / num_threads;
+            wp->last = ((i+1) * sight_pre_size) / num_threads;
+        }
+        else
+        {
+            wp->first = wp->last = 0;  // empty
+        }
+    }
+
+    pthread_mutex_lock( &sight_mutex );
+    sight_pending = sight_num_threads - 1;
+    sight_generation++;
+    pthread_cond_broadcast( &sight_start_cond );
+    pthread_mutex_unlock( &sight_mutex );
+
+    sight_pre_check( & sight_worker[0] );
+
+    pthread_mutex_lock( &sight_mutex );
+    while( sight_pending > 0 )
+        pthread_cond_wait( &sight_done_cond, &sight_mutex );
+    pthread_mutex_unlock( &sight_mutex );
+
+done:
+    PROF_END( zt, "P_Sight_Prefetch" );
+}
+#endif
+
+void P_Sight_Cache_Clear( void )
+{
+    sight_cache_gen++;
+    if( sight_cache_gen == 0 )
+    {
+        // wrap, entries of gen 0 would be valid
+        memset( sight_cache, 0, sizeof(sight_cache) );
+        sight_cache_gen = 1;
+    }
+}
+
+void P_Sight_Cache_Init( void )
+{
+    P_Sight_Cache_Clear();
+    sc_checks = sc_hits = 0;
+#ifdef SIGHT_THREADS
+    sight_pre_count = 0;
+    sc_pre_hits = 0;
+#endif
+}
+
+static void Command_SightStats_f( void )
+{
+    CONS_Printf( "Sight checks %u, cached %u", sc_checks, sc_hits );
+    if( sc_checks )
+        CONS_Printf( " (%u%%)", (unsigned int)(((uint64_t)sc_hits * 100) / sc_checks) );
+#ifdef SIGHT_THREADS
+    CONS_Printf( ", prefetched %u", sc_pre_hits );
+#endif
+    CONS_Printf( "\n" );
+}
+
+void P_Sight_Register( void )
+{
+    COM_AddCommand( "sightstats", Command_SightStats_f, CC_info );
+#ifdef SIGHT_THREADS
+    CV_RegisterVar( &cv_sight_threads );
+#endif
+}
+#endif
+
+boolean P_CheckSight( mobj_t* t1, mobj_t* t2 )
+{
+    boolean result;
+#ifdef SIGHT_CACHE
+    uint32_t hash = ((uint32_t)(uintptr_t)t1 >> 4) * 2654435761u
+      ^ ((uint32_t)(uintptr_t)t2 >> 4) * 40503u
+      ^ (uint32_t)(t1->x ^ t2->y) >> FRACBITS;
+    sight_cache_t * scp = &sight_cache[ hash & (SIGHT_CACHE_SIZE-1) ];
+
+    sc_checks++;
+    if( sight_cache_match( scp, t1, t2 ) )
+    {
+        sc_hits++;
+        return scp->result;
+    }
+
+#ifdef SIGHT_THREADS
+    if( sight_pre_count && sight_pre_gen == sight_cache_gen )
+    {
+        sight_cache_t * pre = sight_pre_find( t1, t2 );
+        if( sight_cache_match( pre, t1, t2 ) )
+        {
+            sc_pre_hits++;
+            result = pre->result;
+            goto set_cache;
+        }
+    }
+#endif
+#endif
+
+    PROF_ZONE( zt );
+    result = check_sight( &cs_main, t1, t2 );
+    PROF_END( zt, "P_CheckSight" );
+
+#ifdef SIGHT_CACHE
+#ifdef SIGHT_THREADS
+set_cache:
+#endif
+    sight_cache_set( scp, t1, t2 );
+    scp->result = result;
+#endif
+    return result;
+}
+
 //	added by AC for missle prediction
 // Only called by bots, and when cv_predicting_monsters is on.
 // P_CheckSight2
@@ -578,14 +1047,24 @@ ret_false:
 //
 boolean P_CheckSight2( mobj_t* t1, mobj_t* t2, fixed_t px, fixed_t py, fixed_t pz )
 {
+    sight_trace_t * st = &cs_main;
     const sector_t * s1p = t1->subsector->sector;
     const sector_t * s2p = t2->subsector->sector;
+    const sector_t * rs2p = s2p;  // REJECT sector of the sight end
 
     // First check for trivial rejection.
 
+#ifdef GENERATE_REJECT
+    // The sight line goes to the predicted point, which can be in another
+    // sector than t2.  A generated table would reject it.
+    // A map REJECT keeps the t2 sector, as before, for demo sync.
+    if( reject_generated )
+        rs2p = R_PointInSubsector( px, py )->sector;
+#endif
+
     // Determine subsector entries in REJECT table.
     int s1 = (s1p - sectors);
-    int s2 = (s2p - sectors);
+    int s2 = (rs2p - sectors);
     unsigned int pnum = s1*numsectors + s2;
     unsigned int bytenum = pnum>>3;
     unsigned int bitnum = 1 << (pnum&7);
@@ -593,10 +1072,10 @@ boolean P_CheckSight2( mobj_t* t1, mobj_t* t2, fixed_t px, fixed_t py, fixed_t p
     // Check in REJECT table.
     if (rejectmatrix[bytenum]&bitnum)
     {
-        cs_sightcounts[0]++;
+        st->sightcounts[0]++;
 
         // can't possibly be connected
-        goto ret_false;	
+        goto ret_false;
     }
 
     // [WDJ] From PrBoom
@@ -657,9 +1136,9 @@ boolean P_CheckSight2( mobj_t* t1, mobj_t* t2, fixed_t px, fixed_t py, fixed_t p
         //
         // check precisely
         //              
-        cs_startz = t1->z + t1->height - (t1->height>>2);
-        see_topslope = (t2->z+t2->height) - cs_startz;
-        see_bottomslope = (t2->z) - cs_startz;
+        st->startz = t1->z + t1->height - (t1->height>>2);
+        st->topslope = (t2->z+t2->height) - st->startz;
+        st->bottomslope = (t2->z) - st->startz;
         
         return P_SightPathTraverse ( t1->x, t1->y, t2->x, t2->y );
     }
@@ -674,26 +1153,25 @@ boolean P_CheckSight2( mobj_t* t1, mobj_t* t2, fixed_t px, fixed_t py, fixed_t p
 
     // An unobstructed LOS is possible.
     // Now look from eyes of t1 to any part of t2.
-    cs_sightcounts[1]++;
+    st->sightcounts[1]++;
 
-    validcount++;
+    sight_trace_newmark( st );
 
-    cs_startz = t1->z + t1->height - (t1->height>>2);
-    see_bottomslope = (pz) - cs_startz;           // feet of target
-    see_topslope = see_bottomslope + t2->height;   // head of target
+    st->startz = t1->z + t1->height - (t1->height>>2);
+    st->bottomslope = (pz) - st->startz;           // feet of target
+    st->topslope = st->bottomslope + t2->height;   // head of target
 
-    cs_trace.x = t1->x;
-    cs_trace.y = t1->y;
-    cs_t2x = px;
-    cs_t2y = py;
-    cs_trace.dx = px - t1->x;
-    cs_trace.dy = py - t1->y;
+    st->trace.x = t1->x;
+    st->trace.y = t1->y;
+    st->t2x = px;
+    st->t2y = py;
+    st->trace.dx = px - t1->x;
+    st->trace.dy = py - t1->y;
 
     // Setup for 3dfloor sight tests
-    prev_frac = 0;
+    st->prev_frac = 0;
     
-    // the head node is the last node output
-    return P_CrossBSPNode (numnodes-1);
+    return sight_trace_cross( st );
 
 ret_true:
     return true;
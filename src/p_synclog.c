@@ -0,0 +1,230 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 2024 by DooM Legacy Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+//
+// DESCRIPTION:
+//      Demo sync log, a game state hash for every tic.
+//
+//   -synclog file    writes the hash of every tic.
+//   -synccheck file  compares every tic to a log written by -synclog,
+//                    and reports the first tic that differs.
+//                    Any difference is an error exit.
+//   Play the same demo with both, to verify that a playsim change,
+//   such as thinker_dispatch, keeps demo sync.
+//
+//   The hash covers leveltime, the P_Random index, the players,
+//   every mobj, and the sector heights and lights.
+//
+//-----------------------------------------------------------------------------
+
+#include "doomincl.h"
+#include "p_synclog.h"
+
+#include "doomstat.h"
+#include "g_game.h"
+#include "m_argv.h"
+#include "m_random.h"
+#include "p_local.h"
+#include "p_tick.h"
+#include "r_state.h"
+
+
+byte  synclog_active = 0;
+
+static FILE *  synclog_file = NULL;
+static byte    synclog_check = 0;
+static unsigned int  synclog_tics = 0;
+static unsigned int  synclog_diffs = 0;
+static unsigned int  synclog_first_diff = 0;
+
+
+// FNV-1a
+#define SYNC_HASH_INIT  2166136261u
+static inline uint32_t  sync_hash( uint32_t h, uint32_t v )
+{
+    int i;
+    for( i=0; i<4; i++ )
+    {
+        h = (h ^ (v & 0xFF)) * 16777619u;
+        v >>= 8;
+    }
+    return h;
+}
+
+// Hash of the game state, for the sync log, and for benchmarks
+// that compare playsim variations.
+uint32_t  P_SyncLog_Hash( void )
+{
+    thinker_t * th;
+    mobj_t * mo;
+    sector_t * sec;
+    int i;
+    uint32_t  h = SYNC_HASH_INIT;
+
+    h = sync_hash( h, leveltime );
+    h = sync_hash( h, P_Rand_GetIndex() );
+
+    for( i=0; i<MAXPLAYERS; i++ )
+    {
+        player_t * p = &players[i];
+        if( ! playeringame[i] )
+            continue;
+        h = sync_hash( h, i );
+        h = sync_hash( h, p->health );
+        h = sync_hash( h, p->armorpoints );
+        h = sync_hash( h, p->readyweapon );
+        h = sync_hash( h, p->viewz );
+    }
+
+    for( th = thinkercap.next; th != &thinkercap; th = th->next )
+    {
+        if( th->function.acp1 != (actionf_p1) P_MobjThinker )
+            continue;
+        mo = (mobj_t*) th;
+        h = sync_hash( h, mo->type );
+        h = sync_hash( h, mo->x );
+        h = sync_hash( h, mo->y );
+        h = sync_hash( h, mo->z );
+        h = sync_hash( h, mo->momx );
+        h = sync_hash( h, mo->momy );
+        h = sync_hash( h, mo->momz );
+        h = sync_hash( h, mo->angle );
+        h = sync_hash( h, mo->health );
+        h = sync_hash( h, mo->tics );
+        h = sync_hash( h, mo->flags );
+        h = sync_hash( h, (mo->state)? (mo->state - states) : -1 );
+    }
+
+    for( i=0, sec=sectors; i<numsectors; i++, sec++ )
+    {
+        h = sync_hash( h, sec->floorheight );
+        h = sync_hash( h, sec->ceilingheight );
+        h = sync_hash( h, sec->lightlevel );
+        h = sync_hash( h, sec->special );
+    }
+    return h;
+}
+
+
+// Check for -synclog file, and -synccheck file.
+void  P_SyncLog_Init( void )
+{
+    const char * filename = NULL;
+
+    if( M_CheckParm( "-synclog" ) && M_IsNextParm() )
+    {
+        filename = M_GetNextParm();
+        synclog_file = fopen( filename, "w" );
+        synclog_check = 0;
+    }
+    else if( M_CheckParm( "-synccheck" ) && M_IsNextParm() )
+    {
+        filename = M_GetNextParm();
+        synclog_file = fopen( filename, "r" );
+        synclog_check = 1;
+    }
+    else
+        return;
+
+    if( ! synclog_file )
+    {
+        GenPrintf( EMSG_error, "Sync log: cannot open %s\n", filename );
+        return;
+    }
+    synclog_tics = synclog_diffs = synclog_first_diff = 0;
+    synclog_active = 1;
+}
+
+static void  sync_check_differ( void )
+{
+    if( synclog_diffs == 0 )
+    {
+        synclog_first_diff = leveltime;
+        GenPrintf( EMSG_warn, "Sync check: differs at tic %u\n", leveltime );
+    }
+    synclog_diffs++;
+}
+
+// Called at the end of each P_Ticker.
+void  P_SyncLog_Tic( void )
+{
+    uint32_t  hash;
+    unsigned int  log_tic;
+    uint32_t  log_hash;
+
+    if( ! synclog_file )
+        return;
+
+    hash = P_SyncLog_Hash();
+    synclog_tics++;
+
+    if( ! synclog_check )
+    {
+        fprintf( synclog_file, "%u %08x\n", leveltime, hash );
+        return;
+    }
+
+    if( fscanf( synclog_file, "%u %x", &log_tic, &log_hash ) != 2 )
+    {
+        // The demo runs longer than the log.
+        GenPrintf( EMSG_warn, "Sync check: log ended at tic %u\n", leveltime );
+        sync_check_differ();
+        P_SyncLog_Close();  // No return
+        return;
+    }
+    if( log_tic != leveltime || log_hash != hash )
+        sync_check_differ();
+}
+
+// At the end of the demo, report the check, and close the file.
+// A check that differs is an error exit, so a script can test it.
+void  P_SyncLog_Close( void )
+{
+    unsigned int  log_tic;
+    uint32_t  log_hash;
+
+    if( ! synclog_file )
+        return;
+
+    if( synclog_check )
+    {
+        if( synclog_diffs == 0
+            && fscanf( synclog_file, "%u %x", &log_tic, &log_hash ) == 2 )
+        {
+            // The log runs longer than the demo.
+            GenPrintf( EMSG_warn, "Sync check: demo ended before log tic %u\n", log_tic );
+            synclog_first_diff = log_tic;
+            synclog_diffs++;
+        }
+    }
+
+    fclose( synclog_file );
+    synclog_file = NULL;
+    synclog_active = 0;
+
+    if( synclog_check )
+    {
+        if( synclog_diffs )
+            I_Error( "Sync check: %u of %u tics differ, first at tic %u\n",
+                     synclog_diffs, synclog_tics, synclog_first_diff );
+        GenPrintf( EMSG_info, "Sync check: %u tics in sync\n", synclog_tics );
+    }
+    else
+    {
+        GenPrintf( EMSG_info, "Sync log: %u tics\n", synclog_tics );
+    }
+}
@@ -0,0 +1,41 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 2024 by DooM Legacy Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+//
+// DESCRIPTION:
+//      Demo sync log, a game state hash for every tic.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef P_SYNCLOG_H
+#define P_SYNCLOG_H
+
+#include "doomtype.h"
+
+// Set when -synclog or -synccheck is active.
+extern byte  synclog_active;
+
+// Check for -synclog file, and -synccheck file.
+void  P_SyncLog_Init( void );
+// Called at the end of each P_Ticker.
+void  P_SyncLog_Tic( void );
+// At the end of the demo, report the check, and close the file.
+void  P_SyncLog_Close( void );
+// Hash of the game state, as logged each tic.
+uint32_t  P_SyncLog_Hash( void );
+
+#endif
@@ -40,10 +40,14 @@
 
 #include "doomstat.h"
 #include "p_tick.h"
+#include "i_system.h"
 #include "g_game.h"
+#include "m_profile.h"
 #include "p_local.h"
 #include "z_zone.h"
+#include "command.h"
 #include "t_script.h"
+#include "p_synclog.h"
 
 
 
@@ -70,6 +74,35 @@ thinker_t  thinkerclasscap[NUMTHCLASS];
 static byte  newthinkerpresent = true;
 #endif
 
+// [WDJ] Thinker dispatch from an array, thinker_dispatch.
+// The array is kept in the same order as the thinker list.  The list is
+// only changed by appending new thinkers, and by a thinker removing
+// itself on its own turn, so the array order stays the list order.
+// The thinkers cannot be run class by class, as the shared P_Random
+// sequence, and the thinker interactions, depend upon the list order.
+CV_PossibleValue_t thinker_dispatch_cons_t[] = { {0,"list"}, {1,"array"}, {0,NULL} };
+consvar_t cv_thinker_dispatch = {"thinker_dispatch", "0", CV_SAVE, thinker_dispatch_cons_t};
+
+static thinker_t * * thinker_array = NULL;
+static int  thinker_array_count = 0;
+static int  thinker_array_alloc = 0;
+// The array is not kept by the list dispatch, and must be rebuilt.
+static byte  thinker_array_valid = 0;
+
+static void  thinker_array_append( thinker_t * thinker )
+{
+    if( thinker_array_count >= thinker_array_alloc )
+    {
+        int newalloc = ( thinker_array_alloc )? thinker_array_alloc * 2 : 1024;
+        thinker_t ** newarray = realloc( thinker_array, newalloc * sizeof(thinker_t*) );
+        if( newarray == NULL )
+            I_Error( "Failed realloc for thinker array\n" );
+        thinker_array = newarray;
+        thinker_array_alloc = newalloc;
+    }
+    thinker_array[ thinker_array_count++ ] = thinker;
+}
+
 
 //
 // P_Init_Thinkers
@@ -84,6 +117,9 @@ void P_Init_Thinkers (void)
       thinkerclasscap[i].cprev = thinkerclasscap[i].cnext = &thinkerclasscap[i];
 
     thinkercap.prev = thinkercap.next  = &thinkercap;
+
+    thinker_array_count = 0;
+    thinker_array_valid = 1;
 }
 
 
@@ -99,6 +135,9 @@ void P_AddThinker (thinker_t* thinker)
     thinker->next = &thinkercap;
     thinker->prev = thinkercap.prev;
     thinkercap.prev = thinker;
+
+    if( thinker_array_valid )
+        thinker_array_append( thinker );
    
     // From MBF, PrBoom
 #ifdef REFERENCE_COUNTING
@@ -142,11 +181,12 @@ void P_RemoveThinker (thinker_t* thinker)
 // In PrBoom, MBF, this is called P_RemoveThinkerDelayed, and is more
 // complicated, using reference counts and modifying currentthinker.
 // Our RunThinker handles removal better.
-void T_RemoveThinker( thinker_t* remthink )
+// Return true when the thinker was deleted.
+static boolean  remove_thinker( thinker_t* remthink )
 {
     // [WDJ] MBF, from MBF, PrBoom
 #ifdef REFERENCE_COUNTING
-    if( remthink->references )  return;
+    if( remthink->references )  return false;
 #endif
     
     // Remove from current class-list, if in one.
@@ -156,6 +196,12 @@ void T_RemoveThinker( thinker_t* remthink )
     remthink->next->prev = remthink->prev;
     remthink->prev->next = remthink->next;
     Z_Free (remthink);  // mobj, etc.
+    return true;
+}
+
+void T_RemoveThinker( thinker_t* remthink )
+{
+    remove_thinker( remthink );
 }
 
 
@@ -301,6 +347,66 @@ void P_SetReference(mobj_t * rm_mo, mobj_t * add_mo)
 #endif
 
 
+//
+// Run the thinkers from the thinker array.
+// Same order as the list walk, including the list walk quirk that
+// thinkers added by the last thinker do not run until the next tic.
+// The mobj thinker, most of the thinkers, is called directly.
+static void run_thinker_array (void)
+{
+    thinker_t * th;
+    actionf_p1  func;
+    byte  last;
+    int  rd = 0;  // read index
+    int  wr = 0;  // write index, compacting deleted thinkers
+
+    if( ! thinker_array_valid )
+    {
+        // Rebuild the array from the list.
+        thinker_array_count = 0;
+        for( th = thinkercap.next; th != &thinkercap; th = th->next )
+            thinker_array_append( th );
+        thinker_array_valid = 1;
+    }
+
+    while( rd < thinker_array_count )
+    {
+        th = thinker_array[rd];
+        last = ( rd + 1 == thinker_array_count );
+#ifdef __GNUC__
+        if( rd + 4 < thinker_array_count )
+            __builtin_prefetch( thinker_array[rd + 4] );
+#endif
+#ifdef THINKER_INTERPOLATIONS
+        if (newthinkerpresent)
+            R_ActivateThinkerInterpolations(th);
+#endif
+        rd++;
+        func = th->function.acp1;
+        if( func == (actionf_p1) P_MobjThinker )
+        {
+            P_MobjThinker( (mobj_t*) th );
+        }
+        else if( func == (actionf_p1) T_RemoveThinker )
+        {
+            if( remove_thinker( th ) )
+                goto next;  // deleted
+        }
+        else if( func )
+        {
+            func( th );
+        }
+        thinker_array[wr++] = th;
+     next:
+        if( last )
+            break;
+    }
+    // Thinkers added by the last thinker, run next tic.
+    while( rd < thinker_array_count )
+        thinker_array[wr++] = thinker_array[rd++];
+    thinker_array_count = wr;
+}
+
 //
 // P_RunThinkers
 //
@@ -308,6 +414,16 @@ void P_RunThinkers (void)
 {
     thinker_t*  currentthinker;
     thinker_t*  next_thinker;
+    PROF_ZONE( zt );
+
+    if( cv_thinker_dispatch.EV )
+    {
+        run_thinker_array();
+        goto done;
+    }
+
+    // The array is not kept while removing in the list walk.
+    thinker_array_valid = 0;
 
     currentthinker = thinkercap.next;
     while (currentthinker != &thinkercap)
@@ -323,9 +439,12 @@ void P_RunThinkers (void)
         }
         currentthinker = next_thinker;
     }
+
+ done:
 #ifdef THINKER_INTERPOLATIONS
     newthinkerpresent = false;
 #endif
+    PROF_END( zt, "P_RunThinkers" );
 }
 
 
@@ -356,6 +475,8 @@ void P_Ticker (void)
     R_UpdateInterpolations();
 #endif
 
+    P_Sight_Cache_Clear();
+
     // From PrBoom, EternityEngine, may affect demo sync.
     // Not if this is an intermission screen.
     if( gamestate == GS_LEVEL || gamestate == GS_DEDICATEDSERVER )
@@ -367,6 +488,7 @@ void P_Ticker (void)
         }
     }
 
+    P_Sight_Prefetch();  // uses threads, when enabled
     P_RunThinkers ();
     P_UpdateSpecials ();
     if( cv_itemrespawn.EV )  P_RespawnSpecials ();
@@ -376,6 +498,9 @@ void P_Ticker (void)
     // for par times
     leveltime++;
 
+    if( synclog_active )
+        P_SyncLog_Tic();  // demo sync verify
+
 #ifdef FRAGGLESCRIPT
     // SoM: Update FraggleScript...
     T_DelayedScripts();
@@ -37,6 +37,8 @@
 #include "doomtype.h"
   // tic_t
 #include "d_think.h"
+#include "command.h"
+  // consvar_t
 
 #ifdef __GNUG__
 #pragma interface
@@ -73,6 +75,9 @@ typedef enum {
 
 // both the head and tail of the thinker list
 extern  thinker_t  thinkercap;
+
+// Thinker dispatch, 0=list, 1=array.
+extern consvar_t  cv_thinker_dispatch;
 extern  thinker_t  thinkerclasscap[];
 
 
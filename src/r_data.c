@@ -111,6 +111,8 @@
 #include "z_zone.h"
 #include "v_video.h" //pLocalPalette
 #include "m_swap.h"
+#include "m_profile.h"
+  // M_Time_ns
 
 
 // [WDJ] debug flat
@@ -178,6 +180,15 @@ int             flatmemory;
 int             spritememory;
 int             texturememory;	// all textures
 
+// Keep the generated textures until the level ends, instead of purgeable.
+consvar_t cv_texcache_keep = {"r_texcache_keep", "1", CV_SAVE, CV_OnOff};
+
+// Texture generation stats, since the level precache.
+static byte      texgen_precaching = 0;
+static uint32_t  texgen_pre_count, texgen_later_count;
+static uint32_t  texgen_pre_bytes, texgen_later_bytes;
+static uint64_t  texgen_pre_ns, texgen_later_ns;
+
 
 //faB: highcolor stuff
 // [WDJ] 2012-02-06 shared for DRAW15, DRAW16, DRAW24, DRAW32
@@ -1003,6 +1014,7 @@ byte* R_GenerateTexture2 ( int texnum, texture_render_t *  texren, byte  texture
     int postlength;  // length of current post
     int segnxt_y, segbot_y; // may be negative
     int bottom;		// next y in column
+    uint64_t  gen_start_ns = M_Time_ns();
 
 
     texture = textures[texnum];
@@ -1852,12 +1864,45 @@ done:
    
     // Now that the texture has been built in column cache,
     //  texture cache is purgable from zone memory.
-    Z_ChangeTag (txcblock, PU_PRIV_CACHE);  // priority because of expense
+    // With r_texcache_keep, it stays until the level is exited, so it is
+    // not generated again after memory is short.
+    Z_ChangeTag (txcblock, (cv_texcache_keep.EV)? PU_LEVEL : PU_PRIV_CACHE);  // priority because of expense
     texturememory += txcblocksize;  // global
 
+    if( texgen_precaching )
+    {
+        texgen_pre_count ++;
+        texgen_pre_bytes += txcblocksize;
+        texgen_pre_ns += M_Time_ns() - gen_start_ns;
+    }
+    else
+    {
+        texgen_later_count ++;
+        texgen_later_bytes += txcblocksize;
+        texgen_later_ns += M_Time_ns() - gen_start_ns;
+    }
+
     return txcblock;
 }
 
+static void Command_TexCache_f( void )
+{
+    CONS_Printf( "Textures precached: %u, %u KB, %u.%03u ms\n",
+                 texgen_pre_count, texgen_pre_bytes >> 10,
+                 (unsigned int)(texgen_pre_ns / 1000000),
+                 (unsigned int)((texgen_pre_ns / 1000) % 1000) );
+    CONS_Printf( "Textures generated later: %u, %u KB, %u.%03u ms\n",
+                 texgen_later_count, texgen_later_bytes >> 10,
+                 (unsigned int)(texgen_later_ns / 1000000),
+                 (unsigned int)((texgen_later_ns / 1000) % 1000) );
+}
+
+void R_Data_Register( void )
+{
+    CV_RegisterVar (&cv_texcache_keep);
+    COM_AddCommand ("r_texcache", Command_TexCache_f, CC_info);
+}
+
 
 // Public
 //  texture_req : requirement,  TM_none, TM_masked, TM_picture, or TM_picture_column
@@ -3746,6 +3791,10 @@ void R_PrecacheLevel (void)
 
     //int numgenerated;  //faB:debug
 
+    texgen_pre_count = texgen_later_count = 0;
+    texgen_pre_bytes = texgen_later_bytes = 0;
+    texgen_pre_ns = texgen_later_ns = 0;
+
     if (demoplayback)
         return;
 
@@ -3799,6 +3848,7 @@ void R_PrecacheLevel (void)
     //    GenPrintf(EMSG_dev, "Generating textures..\n");
 
     texturememory = 0;  // global
+    texgen_precaching = 1;
     for (i=FIRST_TEXTURE ; i<numtextures ; i++)
     {
         if (!texturepresent[i])
@@ -3813,6 +3863,7 @@ void R_PrecacheLevel (void)
         //       obsolete since we now cache entire composite textures
     }
     //debug_Printf("total mem for %d textures: %d k\n",numgenerated,texturememory>>10);
+    texgen_precaching = 0;
     free(texturepresent);
 
     //
@@ -244,6 +244,9 @@ byte* R_GetFlat (int  flatnum);
 void R_Load_Data (void);
 void R_PrecacheLevel (void);
 
+extern consvar_t  cv_texcache_keep;
+void R_Data_Register( void );
+
 void R_Init_rdata(void);
 // Upon change in rendermode.
 void R_rdata_setup_rendermode( void );
@@ -119,27 +119,27 @@ byte*           yhlookup[MAXVIDWIDTH];
 int             hcolumnofs[MAXVIDHEIGHT];
 #endif
 
-byte            dr_alpha;  // translucent and fog alpha, 0..255
+RTLS byte            dr_alpha;  // translucent and fog alpha, 0..255
 #ifdef ENABLE_DRAW_ALPHA
-byte            dr_alpha_mode;  // alpha combine modes
-byte            dr_alpha_background;  // alpha applied to background
-byte            dr_color8;
-RGBA_t          dr_color;  // draw alpha
+RTLS byte            dr_alpha_mode;  // alpha combine modes
+RTLS byte            dr_alpha_background;  // alpha applied to background
+RTLS byte            dr_color8;
+RTLS RGBA_t          dr_color;  // draw alpha
 #endif
 
 // =========================================================================
 //                      COLUMN DRAWING CODE STUFF
 // =========================================================================
 
-lighttable_t*           dc_colormap;
-int                     dc_x;
-int                     dc_yl;
-int                     dc_yh;
+RTLS lighttable_t*           dc_colormap;
+RTLS int                     dc_x;
+RTLS int                     dc_yl;
+RTLS int                     dc_yh;
 
-fixed_t                 dc_iscale;
-fixed_t                 dc_texturemid;
+RTLS fixed_t                 dc_iscale;
+RTLS fixed_t                 dc_texturemid;
 
-byte*                   dc_source;
+RTLS byte*                   dc_source;
 
 
 // -----------------------
@@ -151,8 +151,8 @@ byte*                   dc_source;
 byte*                   translucenttables;    // translucency tables
 
 // R_DrawTransColumn uses this
-byte*                   dc_translucentmap;    // one of the translucency tables
-byte                    dc_translucent_index;
+RTLS byte*                   dc_translucentmap;    // one of the translucency tables
+RTLS byte                    dc_translucent_index;
 
 
 // ----------------------
@@ -164,39 +164,39 @@ byte                    dc_translucent_index;
 byte*                   skintranstables;  // player skin translation tables
 
 // R_DrawTranslatedColumn uses this
-byte*                   dc_skintran; // ptr to one skintranstables table
+RTLS byte*                   dc_skintran; // ptr to one skintranstables table
 
 
 struct r_lightlist_s*   dc_lightlist = NULL;
 int                     dc_numlights = 0;
 int                     dc_maxlights;
 
-int     dc_texheight;
+RTLS int     dc_texheight;
 
 // =========================================================================
 //                      SPAN DRAWING CODE STUFF
 // =========================================================================
 
-int                     ds_y;
-int                     ds_x1;
-int                     ds_x2;
+RTLS int                     ds_y;
+RTLS int                     ds_x1;
+RTLS int                     ds_x2;
 
-lighttable_t*           ds_colormap;
+RTLS lighttable_t*           ds_colormap;
 
-fixed_t                 ds_xfrac;
-fixed_t                 ds_yfrac;
-fixed_t                 ds_xstep;
-fixed_t                 ds_ystep;
+RTLS fixed_t                 ds_xfrac;
+RTLS fixed_t                 ds_yfrac;
+RTLS fixed_t                 ds_xstep;
+RTLS fixed_t                 ds_ystep;
 
-byte*                   ds_source;      // start of a 64*64 tile image
-byte*                   ds_translucentmap;    // one of the translucency tables
+RTLS byte*                   ds_source;      // start of a 64*64 tile image
+RTLS byte*                   ds_translucentmap;    // one of the translucency tables
 
 // Variable flat sizes SSNTails 06-10-2003
 unsigned int flatsize;
 unsigned int flatbitsz;  // flat bit size, flatsize = 2**flatbitsz
-unsigned int flatfracbits; // FRACBITS - flatbitsz
-unsigned int flat_ymask;   // index mask, = (flatsize-1)<<flatbitsz
-fixed_t      flat_imask;   // index mask, = (flatsize<<FRACBITS) - 1
+RTLS unsigned int flatfracbits; // FRACBITS - flatbitsz
+RTLS unsigned int flat_ymask;   // index mask, = (flatsize-1)<<flatbitsz
+RTLS fixed_t      flat_imask;   // index mask, = (flatsize<<FRACBITS) - 1
 
 
 // ==========================================================================
@@ -729,7 +729,7 @@ void R_DrawColumnShadowed(void)
 
         if (dc_yh > realyh)
             dc_yh = realyh;
-        basecolfunc();  // R_DrawColumn_x
+        DRAW_COLUMN( basecolfunc );  // R_DrawColumn_x
         if (solid)
             dc_yl = bheight;
         else
@@ -739,7 +739,7 @@ void R_DrawColumnShadowed(void)
     }
     dc_yh = realyh;
     if (dc_yl <= realyh)
-        basecolfunc();  // R_DrawColumn_x
+        DRAW_COLUMN( basecolfunc );  // R_DrawColumn_x
 }
 
 
@@ -776,3 +776,12 @@ void R_DrawColumnShadowed(void)
 #include "r_draw32.c"
 #endif
 
+
+// ==========================================================================
+//                   INCLUDE SIMD DRAWING CODE HERE
+// ==========================================================================
+
+#ifdef ENABLE_DRAW_SIMD
+#include "r_drawsimd.c"
+#endif
+
@@ -51,7 +51,7 @@
 #define R_DRAW_H
 
 #include "doomdef.h"
-  // HORIZONTALDRAW
+  // HORIZONTALDRAW, RENDER_THREADS
 #include "doomtype.h"
 #include "r_defs.h"
 
@@ -69,12 +69,20 @@ extern byte*            yhlookup[MAXVIDWIDTH];
 extern int              hcolumnofs[MAXVIDHEIGHT];
 #endif
 
-extern byte             dr_alpha;  // translucent and fog alpha, 0..255
+// [WDJ] The draw state is thread local when render threads replay
+// the queued draws, see r_thread.c.
+#ifdef RENDER_THREADS
+#define RTLS  __thread
+#else
+#define RTLS
+#endif
+
+extern RTLS byte             dr_alpha;  // translucent and fog alpha, 0..255
 #ifdef ENABLE_DRAW_ALPHA
-extern byte             dr_alpha_mode;  // alpha combine modes
-extern byte             dr_alpha_background;  // alpha applied to background
-extern byte             dr_color8;
-extern RGBA_t           dr_color;  // draw alpha
+extern RTLS byte             dr_alpha_mode;  // alpha combine modes
+extern RTLS byte             dr_alpha_background;  // alpha applied to background
+extern RTLS byte             dr_color8;
+extern RTLS RGBA_t           dr_color;  // draw alpha
 #endif
 
 
@@ -82,27 +90,27 @@ extern RGBA_t           dr_color;  // draw alpha
 // COLUMN DRAWING CODE STUFF
 // -------------------------
 
-extern lighttable_t*    dc_colormap;
-extern int              dc_x;
-extern int              dc_yl;
-extern int              dc_yh;
-extern fixed_t          dc_iscale;
-extern fixed_t          dc_texturemid;
+extern RTLS lighttable_t*    dc_colormap;
+extern RTLS int              dc_x;
+extern RTLS int              dc_yl;
+extern RTLS int              dc_yh;
+extern RTLS fixed_t          dc_iscale;
+extern RTLS fixed_t          dc_texturemid;
 
-extern byte*            dc_source;      // first pixel in a column
+extern RTLS byte*            dc_source;      // first pixel in a column
 
 // translucency stuff here
 extern byte*            translucenttables;   // translucency tables, should be (*transtables)[5][256][256]
-extern byte*            dc_translucentmap;   // ptr to selected table
-extern byte             dc_translucent_index;
+extern RTLS byte*            dc_translucentmap;   // ptr to selected table
+extern RTLS byte             dc_translucent_index;
 
 
 // Variable flat sizes SSNTails 06-10-2003
 extern unsigned int flatsize;
 extern unsigned int flatbitsz;  // flat bit size, flatsize = 2**flatbitsz
-extern unsigned int flatfracbits; // FRACBITS - flatbitsz
-extern unsigned int flat_ymask;   // index mask, = (flatsize-1)<<flatbitsz
-extern fixed_t      flat_imask;   // index mask, = (flatsize<<flatbitsz) - 1
+extern RTLS unsigned int flatfracbits; // FRACBITS - flatbitsz
+extern RTLS unsigned int flat_ymask;   // index mask, = (flatsize-1)<<flatbitsz
+extern RTLS fixed_t      flat_imask;   // index mask, = (flatsize<<flatbitsz) - 1
 
 // translation stuff here
 
@@ -110,7 +118,7 @@ extern fixed_t      flat_imask;   // index mask, = (flatsize<<flatbitsz) - 1
 // Does not translate color 0
 // Boom calls these TRANSLATION, but that confuses with translucent.
 extern byte*            skintranstables;  // player skin translation tables
-extern byte*            dc_skintran;  // ptr to selected skin table
+extern RTLS byte*            dc_skintran;  // ptr to selected skin table
 
 // for skin = 1..(MAXSKINNUM-1), skin=0 does not use translation
 #define SKIN_TO_SKINMAP( skin )  (&skintranstables[ ((skin)-1)<<8 ])
@@ -133,26 +141,26 @@ extern int                        dc_numlights;
 extern int                        dc_maxlights;
 
 //Fix TUTIFRUTI
-extern int      dc_texheight;
+extern RTLS int      dc_texheight;
 
 
 // -----------------------
 // SPAN DRAWING CODE STUFF
 // -----------------------
 
-extern int              ds_y;
-extern int              ds_x1;
-extern int              ds_x2;
+extern RTLS int              ds_y;
+extern RTLS int              ds_x1;
+extern RTLS int              ds_x2;
 
-extern lighttable_t*    ds_colormap;
+extern RTLS lighttable_t*    ds_colormap;
 
-extern fixed_t          ds_xfrac;
-extern fixed_t          ds_yfrac;
-extern fixed_t          ds_xstep;
-extern fixed_t          ds_ystep;
+extern RTLS fixed_t          ds_xfrac;
+extern RTLS fixed_t          ds_yfrac;
+extern RTLS fixed_t          ds_xstep;
+extern RTLS fixed_t          ds_ystep;
 
-extern byte*            ds_source;      // start of a 64*64 tile image
-extern byte*            ds_translucentmap; // ptr to one translucent map
+extern RTLS byte*            ds_source;      // start of a 64*64 tile image
+extern RTLS byte*            ds_translucentmap; // ptr to one translucent map
 
 
 // viewborder patches lump numbers
@@ -195,6 +203,14 @@ void    R_DrawViewBorder (void);
 // [WDJ] Generic
 void    R_DrawColumnShadowed (void);
 
+#ifdef ENABLE_DRAW_SIMD
+// Replace drawers with SIMD drawers, after the drawmode drawers are set.
+void    R_Setup_SIMD_Drawers (void);
+// -simdcheck, compare the SIMD drawers to the C drawers.
+// Return 0 when all match.
+int     R_SIMD_Check (void);
+#endif
+
 // -----------------
 // 8bpp DRAWING CODE
 // -----------------
@@ -0,0 +1,928 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 2024 by DooM Legacy Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+//
+// DESCRIPTION:
+//      SIMD span and column drawers, included in r_draw.c.
+//
+//   Each must draw exactly the same pixels as the C drawer it replaces.
+//   The span u,v steps are computed for several pixels at once.  The
+//   flat, colormap, and palette lookups stay table lookups.
+//   The 32bpp blends work on all three colors of a pixel at once,
+//   and keep the dest alpha byte, like the C drawers.
+//
+//-----------------------------------------------------------------------------
+
+#ifdef ENABLE_DRAW_SIMD
+
+#include "m_argv.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86
+#include <immintrin.h>
+// The build does not need -msse2 or -mavx2, each drawer is compiled for
+// its own instruction set, and only used when the cpu has it.
+#define TARGET_SSE2  __attribute__((target("sse2")))
+#define TARGET_AVX2  __attribute__((target("avx2")))
+#endif
+
+#ifdef __aarch64__
+#define SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+// Flat index of the span u,v, as the C span drawers.
+#define SPAN_SPOT( xf, yf ) \
+   ( (((uint32_t)(yf) >> flatfracbits) & flat_ymask) | (((uint32_t)(xf) & flat_imask) >> FRACBITS) )
+
+// The pixel32_t alpha byte, which the blends do not change.
+#ifdef __BIG_ENDIAN__
+#define PIX32_ALPHA_MASK  0x000000FF
+#else
+#define PIX32_ALPHA_MASK  0xFF000000
+#endif
+
+static const char * simd_drawer_name = NULL;
+
+#ifdef ENABLE_DRAW32
+// (d * wd + c * wc) >> 8 for b,g,r of one pixel, as the C drawers.
+static inline void blend_pix32( uint32_t * p32, uint32_t c, unsigned int wd, unsigned int wc )
+{
+    pixel32_t * pp = (pixel32_t*)p32;
+    pixelunion32_t c32;
+    c32.ui32 = c;
+    pp->b = (((unsigned int)pp->b * wd) + (c32.pix32.b * wc)) >> 8;
+    pp->g = (((unsigned int)pp->g * wd) + (c32.pix32.g * wc)) >> 8;
+    pp->r = (((unsigned int)pp->r * wd) + (c32.pix32.r * wc)) >> 8;
+}
+#endif
+
+
+// ==========================================================================
+//                      SSE2 and AVX2
+// ==========================================================================
+
+#ifdef SIMD_X86
+
+typedef struct {
+    __m128i  xv, yv;  // u,v of 4 pixels
+    __m128i  xstep4, ystep4;
+    __m128i  imask, ymask, fracbits;
+} span4_sse2_t;
+
+TARGET_SSE2
+static inline void span4_init_sse2( span4_sse2_t * sp, uint32_t xfrac, uint32_t yfrac )
+{
+    uint32_t xs = ds_xstep, ys = ds_ystep;
+    sp->xv = _mm_set_epi32( xfrac + 3*xs, xfrac + 2*xs, xfrac + xs, xfrac );
+    sp->yv = _mm_set_epi32( yfrac + 3*ys, yfrac + 2*ys, yfrac + ys, yfrac );
+    sp->xstep4 = _mm_set1_epi32( 4*xs );
+    sp->ystep4 = _mm_set1_epi32( 4*ys );
+    sp->imask = _mm_set1_epi32( flat_imask );
+    sp->ymask = _mm_set1_epi32( flat_ymask );
+    sp->fracbits = _mm_cvtsi32_si128( flatfracbits );
+}
+
+// Flat index of the next 4 pixels, and step u,v.
+TARGET_SSE2
+static inline void span4_spots_sse2( span4_sse2_t * sp, uint32_t * spot )
+{
+    __m128i  yi = _mm_and_si128( _mm_srl_epi32( sp->yv, sp->fracbits ), sp->ymask );
+    __m128i  xi = _mm_srli_epi32( _mm_and_si128( sp->xv, sp->imask ), FRACBITS );
+    _mm_store_si128( (__m128i*)spot, _mm_or_si128( yi, xi ) );
+    sp->xv = _mm_add_epi32( sp->xv, sp->xstep4 );
+    sp->yv = _mm_add_epi32( sp->yv, sp->ystep4 );
+}
+
+TARGET_SSE2
+static void R_DrawSpan_8_SSE2( void )
+{
+    byte *  dest = ylookup[ds_y] + columnofs[ds_x1];
+    int     count = ds_x2 - ds_x1 + 1;
+    uint32_t  xfrac = ds_xfrac;
+    uint32_t  yfrac = ds_yfrac;
+    uint32_t  spot[4] __attribute__((aligned(16)));
+    span4_sse2_t  sp;
+
+    span4_init_sse2( &sp, xfrac, yfrac );
+    while( count >= 4 )
+    {
+        span4_spots_sse2( &sp, spot );
+        dest[0] = ds_colormap[ds_source[spot[0]]];
+        dest[1] = ds_colormap[ds_source[spot[1]]];
+        dest[2] = ds_colormap[ds_source[spot[2]]];
+        dest[3] = ds_colormap[ds_source[spot[3]]];
+        dest += 4;
+        xfrac += 4 * (uint32_t)ds_xstep;
+        yfrac += 4 * (uint32_t)ds_ystep;
+        count -= 4;
+    }
+    while( count-- )
+    {
+        *(dest++) = ds_colormap[ds_source[SPAN_SPOT( xfrac, yfrac )]];
+        xfrac += ds_xstep;
+        yfrac += ds_ystep;
+    }
+}
+
+#ifdef ENABLE_DRAW32
+TARGET_SSE2
+static void R_DrawSpan_32_SSE2( void )
+{
+    uint32_t *  p32 = (uint32_t*)( ylookup[ds_y] + columnofs[ds_x1] );
+    int     count = ds_x2 - ds_x1 + 1;
+    uint32_t  xfrac = ds_xfrac;
+    uint32_t  yfrac = ds_yfrac;
+    uint32_t  spot[4] __attribute__((aligned(16)));
+    span4_sse2_t  sp;
+
+    span4_init_sse2( &sp, xfrac, yfrac );
+    while( count >= 4 )
+    {
+        span4_spots_sse2( &sp, spot );
+        _mm_storeu_si128( (__m128i*)p32,
+           _mm_set_epi32( color8.to32[ ds_colormap[ds_source[spot[3]]] ],
+                          color8.to32[ ds_colormap[ds_source[spot[2]]] ],
+                          color8.to32[ ds_colormap[ds_source[spot[1]]] ],
+                          color8.to32[ ds_colormap[ds_source[spot[0]]] ] ));
+        p32 += 4;
+        xfrac += 4 * (uint32_t)ds_xstep;
+        yfrac += 4 * (uint32_t)ds_ystep;
+        count -= 4;
+    }
+    while( count-- )
+    {
+        *(p32++) = color8.to32[ ds_colormap[ds_source[SPAN_SPOT( xfrac, yfrac )]] ];
+        xfrac += ds_xstep;
+        yfrac += ds_ystep;
+    }
+}
+
+// (d * wd + s * ws) >> shift, for b,g,r of 4 pixels.  Keeps the dest alpha.
+// The weights are at most 255 together, so the 16 bit sum cannot overflow.
+TARGET_SSE2
+static inline __m128i blend4_sse2( __m128i d, __m128i s,
+                                   __m128i wd, __m128i ws, __m128i shift )
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha_mask = _mm_set1_epi32( PIX32_ALPHA_MASK );
+    __m128i lo = _mm_add_epi16( _mm_mullo_epi16( _mm_unpacklo_epi8( d, zero ), wd ),
+                                _mm_mullo_epi16( _mm_unpacklo_epi8( s, zero ), ws ) );
+    __m128i hi = _mm_add_epi16( _mm_mullo_epi16( _mm_unpackhi_epi8( d, zero ), wd ),
+                                _mm_mullo_epi16( _mm_unpackhi_epi8( s, zero ), ws ) );
+    __m128i r = _mm_packus_epi16( _mm_srl_epi16( lo, shift ), _mm_srl_epi16( hi, shift ) );
+    return _mm_or_si128( _mm_andnot_si128( alpha_mask, r ), _mm_and_si128( alpha_mask, d ) );
+}
+
+TARGET_SSE2
+static void R_DrawTranslucentSpan_32_SSE2( void )
+{
+    uint32_t *  p32 = (uint32_t*)( ylookup[ds_y] + columnofs[ds_x1] );
+    int     count = ds_x2 - ds_x1 + 1;
+    uint32_t  xfrac = ds_xfrac;
+    uint32_t  yfrac = ds_yfrac;
+    uint32_t  spot[4] __attribute__((aligned(16)));
+    unsigned int alpha_d = dr_alpha;
+    unsigned int alpha_r = 255 - alpha_d;
+    __m128i  wd = _mm_set1_epi16( alpha_r );
+    __m128i  ws = _mm_set1_epi16( alpha_d );
+    __m128i  shift = _mm_cvtsi32_si128( 8 );
+    span4_sse2_t  sp;
+
+    span4_init_sse2( &sp, xfrac, yfrac );
+    while( count >= 4 )
+    {
+        span4_spots_sse2( &sp, spot );
+        __m128i s = _mm_set_epi32( color8.to32[ ds_colormap[ds_source[spot[3]]] ],
+                                   color8.to32[ ds_colormap[ds_source[spot[2]]] ],
+                                   color8.to32[ ds_colormap[ds_source[spot[1]]] ],
+                                   color8.to32[ ds_colormap[ds_source[spot[0]]] ] );
+        __m128i d = _mm_loadu_si128( (__m128i*)p32 );
+        _mm_storeu_si128( (__m128i*)p32, blend4_sse2( d, s, wd, ws, shift ) );
+        p32 += 4;
+        xfrac += 4 * (uint32_t)ds_xstep;
+        yfrac += 4 * (uint32_t)ds_ystep;
+        count -= 4;
+    }
+    while( count-- )
+    {
+        blend_pix32( p32++, color8.to32[ ds_colormap[ds_source[SPAN_SPOT( xfrac, yfrac )]] ],
+                     alpha_r, alpha_d );
+        xfrac += ds_xstep;
+        yfrac += ds_ystep;
+    }
+}
+
+// Fog: (d * alpha_r + fogcolor * alpha_d) >> 8, with alpha_r < 255 - alpha_d.
+TARGET_SSE2
+static void R_DrawFogSpan_32_SSE2( void )
+{
+    uint32_t *  p32 = (uint32_t*)( ylookup[ds_y] + columnofs[ds_x1] );
+    int     count = ds_x2 - ds_x1 + 1;
+    unsigned int alpha_d = dr_alpha;
+    unsigned int alpha_r = (255 - alpha_d) * 0.84;  // cloudy fog, as R_DrawFogSpan_32
+    uint32_t  fogcolor = color8.to32[ ds_colormap[ ds_source[fog_index] ]];
+    __m128i  s = _mm_set1_epi32( fogcolor );
+    __m128i  wd = _mm_set1_epi16( alpha_r );
+    __m128i  ws = _mm_set1_epi16( alpha_d );
+    __m128i  shift = _mm_cvtsi32_si128( 8 );
+
+    while( count >= 4 )
+    {
+        __m128i d = _mm_loadu_si128( (__m128i*)p32 );
+        _mm_storeu_si128( (__m128i*)p32, blend4_sse2( d, s, wd, ws, shift ) );
+        p32 += 4;
+        count -= 4;
+    }
+    while( count-- )
+        blend_pix32( p32++, fogcolor, alpha_r, alpha_d );
+}
+
+// Translucent column, blending the three colors of a pixel at once.
+// The fire and fx1 effects test the translucent map per pixel,
+// and use the C drawer.
+TARGET_SSE2
+static void R_DrawTranslucentColumn_32_SSE2( void )
+{
+    fixed_t texheight = dc_texheight << FRACBITS;  // any texture size
+    int     count;
+    byte *  dest;  // within screen buffer
+    fixed_t frac;
+    fixed_t fracstep;
+    unsigned int  wd, ws, sh;
+    __m128i  wdv, wsv, shv;
+
+    switch( dc_translucent_index )
+    {
+     case 0:  // alpha translucent, by dr_alpha
+        ws = dr_alpha;
+        wd = 255 - ws;
+        sh = 8;
+        break;
+     case TRANSLU_more: // 25/75
+        wd = 3;  ws = 1;  sh = 2;
+        break;
+     case TRANSLU_hi:   // 15/85
+        wd = 7;  ws = 1;  sh = 3;
+        break;
+     case TRANSLU_75:   // 75/25
+        wd = 1;  ws = 3;  sh = 2;
+        break;
+     case TRANSLU_fire:
+     case TRANSLU_fx1:
+        R_DrawTranslucentColumn_32();
+        return;
+     case TRANSLU_med:  // 50/50
+     default:
+        wd = 1;  ws = 1;  sh = 1;
+        break;
+    }
+
+    count = dc_yh - dc_yl;
+    if (count < 0)
+        return;
+
+    dest = ylookup[dc_yl] + columnofs[dc_x];
+
+    fracstep = dc_iscale;
+    frac = dc_texturemid + (dc_yl-centery)*fracstep;
+    if (texheight > 0)  // hangs when texheight==0
+    {
+        // From Boom, to fix the odd frac
+        if (frac < 0)
+            while ((frac += texheight) < 0);
+        else
+            while (frac >= texheight)  frac -= texheight;
+    }
+    if( fracstep < 0 )
+       I_Error( "DrawTranslucent: fracstep < 0\n");
+
+    wdv = _mm_set1_epi16( wd );
+    wsv = _mm_set1_epi16( ws );
+    shv = _mm_cvtsi32_si128( sh );
+    do
+    {
+        __m128i s = _mm_cvtsi32_si128( color8.to32[dc_colormap[dc_source[frac>>FRACBITS]]] );
+        __m128i d = _mm_cvtsi32_si128( *(uint32_t*)dest );
+        *(uint32_t*)dest = _mm_cvtsi128_si32( blend4_sse2( d, s, wdv, wsv, shv ) );
+        dest += vid.ybytes;
+        frac += fracstep;
+        if( frac >= texheight )
+            frac -= texheight;
+    } while (count--);
+}
+
+
+// AVX2: 8 pixels, and the palette lookup is a gather.
+
+typedef struct {
+    __m256i  xv, yv;  // u,v of 8 pixels
+    __m256i  xstep8, ystep8;
+    __m256i  imask, ymask;
+    __m128i  fracbits;
+} span8_avx2_t;
+
+TARGET_AVX2
+static inline void span8_init_avx2( span8_avx2_t * sp, uint32_t xfrac, uint32_t yfrac )
+{
+    const __m256i lane = _mm256_set_epi32( 7, 6, 5, 4, 3, 2, 1, 0 );
+    sp->xv = _mm256_add_epi32( _mm256_set1_epi32( xfrac ),
+                 _mm256_mullo_epi32( lane, _mm256_set1_epi32( ds_xstep ) ) );
+    sp->yv = _mm256_add_epi32( _mm256_set1_epi32( yfrac ),
+                 _mm256_mullo_epi32( lane, _mm256_set1_epi32( ds_ystep ) ) );
+    sp->xstep8 = _mm256_set1_epi32( 8 * (uint32_t)ds_xstep );
+    sp->ystep8 = _mm256_set1_epi32( 8 * (uint32_t)ds_ystep );
+    sp->imask = _mm256_set1_epi32( flat_imask );
+    sp->ymask = _mm256_set1_epi32( flat_ymask );
+    sp->fracbits = _mm_cvtsi32_si128( flatfracbits );
+}
+
+// Palette colors of the next 8 pixels, and step u,v.
+TARGET_AVX2
+static inline __m256i span8_colors_avx2( span8_avx2_t * sp )
+{
+    uint32_t  spot[8] __attribute__((aligned(32)));
+    __m256i  yi = _mm256_and_si256( _mm256_srl_epi32( sp->yv, sp->fracbits ), sp->ymask );
+    __m256i  xi = _mm256_srli_epi32( _mm256_and_si256( sp->xv, sp->imask ), FRACBITS );
+    __m256i  ci;
+    _mm256_store_si256( (__m256i*)spot, _mm256_or_si256( yi, xi ) );
+    sp->xv = _mm256_add_epi32( sp->xv, sp->xstep8 );
+    sp->yv = _mm256_add_epi32( sp->yv, sp->ystep8 );
+    ci = _mm256_set_epi32( ds_colormap[ds_source[spot[7]]], ds_colormap[ds_source[spot[6]]],
+                           ds_colormap[ds_source[spot[5]]], ds_colormap[ds_source[spot[4]]],
+                           ds_colormap[ds_source[spot[3]]], ds_colormap[ds_source[spot[2]]],
+                           ds_colormap[ds_source[spot[1]]], ds_colormap[ds_source[spot[0]]] );
+    return _mm256_i32gather_epi32( (const int*)color8.to32, ci, 4 );
+}
+
+// As blend4_sse2, for 8 pixels.  Unpack and pack stay within the 128 bit
+// lanes, so the pixel order is kept.
+TARGET_AVX2
+static inline __m256i blend8_avx2( __m256i d, __m256i s,
+                                   __m256i wd, __m256i ws )
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alpha_mask = _mm256_set1_epi32( PIX32_ALPHA_MASK );
+    __m256i lo = _mm256_add_epi16( _mm256_mullo_epi16( _mm256_unpacklo_epi8( d, zero ), wd ),
+                                   _mm256_mullo_epi16( _mm256_unpacklo_epi8( s, zero ), ws ) );
+    __m256i hi = _mm256_add_epi16( _mm256_mullo_epi16( _mm256_unpackhi_epi8( d, zero ), wd ),
+                                   _mm256_mullo_epi16( _mm256_unpackhi_epi8( s, zero ), ws ) );
+    __m256i r = _mm256_packus_epi16( _mm256_srli_epi16( lo, 8 ), _mm256_srli_epi16( hi, 8 ) );
+    return _mm256_or_si256( _mm256_andnot_si256( alpha_mask, r ), _mm256_and_si256( alpha_mask, d ) );
+}
+
+TARGET_AVX2
+static void R_DrawSpan_32_AVX2( void )
+{
+    uint32_t *  p32 = (uint32_t*)( ylookup[ds_y] + columnofs[ds_x1] );
+    int     count = ds_x2 - ds_x1 + 1;
+    uint32_t  xfrac = ds_xfrac;
+    uint32_t  yfrac = ds_yfrac;
+    span8_avx2_t  sp;
+
+    span8_init_avx2( &sp, xfrac, yfrac );
+    while( count >= 8 )
+    {
+        _mm256_storeu_si256( (__m256i*)p32, span8_colors_avx2( &sp ) );
+        p32 += 8;
+        xfrac += 8 * (uint32_t)ds_xstep;
+        yfrac += 8 * (uint32_t)ds_ystep;
+        count -= 8;
+    }
+    while( count-- )
+    {
+        *(p32++) = color8.to32[ ds_colormap[ds_source[SPAN_SPOT( xfrac, yfrac )]] ];
+        xfrac += ds_xstep;
+        yfrac += ds_ystep;
+    }
+}
+
+TARGET_AVX2
+static void R_DrawTranslucentSpan_32_AVX2( void )
+{
+    uint32_t *  p32 = (uint32_t*)( ylookup[ds_y] + columnofs[ds_x1] );
+    int     count = ds_x2 - ds_x1 + 1;
+    uint32_t  xfrac = ds_xfrac;
+    uint32_t  yfrac = ds_yfrac;
+    unsigned int alpha_d = dr_alpha;
+    unsigned int alpha_r = 255 - alpha_d;
+    __m256i  wd = _mm256_set1_epi16( alpha_r );
+    __m256i  ws = _mm256_set1_epi16( alpha_d );
+    span8_avx2_t  sp;
+
+    span8_init_avx2( &sp, xfrac, yfrac );
+    while( count >= 8 )
+    {
+        __m256i s = span8_colors_avx2( &sp );
+        __m256i d = _mm256_loadu_si256( (__m256i*)p32 );
+        _mm256_storeu_si256( (__m256i*)p32, blend8_avx2( d, s, wd, ws ) );
+        p32 += 8;
+        xfrac += 8 * (uint32_t)ds_xstep;
+        yfrac += 8 * (uint32_t)ds_ystep;
+        count -= 8;
+    }
+    while( count-- )
+    {
+        blend_pix32( p32++, color8.to32[ ds_colormap[ds_source[SPAN_SPOT( xfrac, yfrac )]] ],
+                     alpha_r, alpha_d );
+        xfrac += ds_xstep;
+        yfrac += ds_ystep;
+    }
+}
+
+TARGET_AVX2
+static void R_DrawFogSpan_32_AVX2( void )
+{
+    uint32_t *  p32 = (uint32_t*)( ylookup[ds_y] + columnofs[ds_x1] );
+    int     count = ds_x2 - ds_x1 + 1;
+    unsigned int alpha_d = dr_alpha;
+    unsigned int alpha_r = (255 - alpha_d) * 0.84;  // cloudy fog, as R_DrawFogSpan_32
+    uint32_t  fogcolor = color8.to32[ ds_colormap[ ds_source[fog_index] ]];
+    __m256i  s = _mm256_set1_epi32( fogcolor );
+    __m256i  wd = _mm256_set1_epi16( alpha_r );
+    __m256i  ws = _mm256_set1_epi16( alpha_d );
+
+    while( count >= 8 )
+    {
+        __m256i d = _mm256_loadu_si256( (__m256i*)p32 );
+        _mm256_storeu_si256( (__m256i*)p32, blend8_avx2( d, s, wd, ws ) );
+        p32 += 8;
+        count -= 8;
+    }
+    while( count-- )
+        blend_pix32( p32++, fogcolor, alpha_r, alpha_d );
+}
+#endif  // ENABLE_DRAW32
+#endif  // SIMD_X86
+
+
+// ==========================================================================
+//                      NEON
+// ==========================================================================
+
+#ifdef SIMD_NEON
+
+typedef struct {
+    uint32x4_t  xv, yv;  // u,v of 4 pixels
+    uint32x4_t  xstep4, ystep4;
+    uint32x4_t  imask, ymask;
+    int32x4_t   fracshift;  // negative, right shift
+} span4_neon_t;
+
+static inline void span4_init_neon( span4_neon_t * sp, uint32_t xfrac, uint32_t yfrac )
+{
+    uint32_t xs = ds_xstep, ys = ds_ystep;
+    uint32_t xa[4] = { xfrac, xfrac + xs, xfrac + 2*xs, xfrac + 3*xs };
+    uint32_t ya[4] = { yfrac, yfrac + ys, yfrac + 2*ys, yfrac + 3*ys };
+    sp->xv = vld1q_u32( xa );
+    sp->yv = vld1q_u32( ya );
+    sp->xstep4 = vdupq_n_u32( 4*xs );
+    sp->ystep4 = vdupq_n_u32( 4*ys );
+    sp->imask = vdupq_n_u32( flat_imask );
+    sp->ymask = vdupq_n_u32( flat_ymask );
+    sp->fracshift = vdupq_n_s32( - (int32_t)flatfracbits );
+}
+
+static inline void span4_spots_neon( span4_neon_t * sp, uint32_t * spot )
+{
+    uint32x4_t  yi = vandq_u32( vshlq_u32( sp->yv, sp->fracshift ), sp->ymask );
+    uint32x4_t  xi = vshrq_n_u32( vandq_u32( sp->xv, sp->imask ), FRACBITS );
+    vst1q_u32( spot, vorrq_u32( yi, xi ) );
+    sp->xv = vaddq_u32( sp->xv, sp->xstep4 );
+    sp->yv = vaddq_u32( sp->yv, sp->ystep4 );
+}
+
+static void R_DrawSpan_8_NEON( void )
+{
+    byte *  dest = ylookup[ds_y] + columnofs[ds_x1];
+    int     count = ds_x2 - ds_x1 + 1;
+    uint32_t  xfrac = ds_xfrac;
+    uint32_t  yfrac = ds_yfrac;
+    uint32_t  spot[4];
+    span4_neon_t  sp;
+
+    span4_init_neon( &sp, xfrac, yfrac );
+    while( count >= 4 )
+    {
+        span4_spots_neon( &sp, spot );
+        dest[0] = ds_colormap[ds_source[spot[0]]];
+        dest[1] = ds_colormap[ds_source[spot[1]]];
+        dest[2] = ds_colormap[ds_source[spot[2]]];
+        dest[3] = ds_colormap[ds_source[spot[3]]];
+        dest += 4;
+        xfrac += 4 * (uint32_t)ds_xstep;
+        yfrac += 4 * (uint32_t)ds_ystep;
+        count -= 4;
+    }
+    while( count-- )
+    {
+        *(dest++) = ds_colormap[ds_source[SPAN_SPOT( xfrac, yfrac )]];
+        xfrac += ds_xstep;
+        yfrac += ds_ystep;
+    }
+}
+
+#ifdef ENABLE_DRAW32
+static void R_DrawSpan_32_NEON( void )
+{
+    uint32_t *  p32 = (uint32_t*)( ylookup[ds_y] + columnofs[ds_x1] );
+    int     count = ds_x2 - ds_x1 + 1;
+    uint32_t  xfrac = ds_xfrac;
+    uint32_t  yfrac = ds_yfrac;
+    uint32_t  spot[4];
+    uint32_t  c[4];
+    span4_neon_t  sp;
+
+    span4_init_neon( &sp, xfrac, yfrac );
+    while( count >= 4 )
+    {
+        span4_spots_neon( &sp, spot );
+        c[0] = color8.to32[ ds_colormap[ds_source[spot[0]]] ];
+        c[1] = color8.to32[ ds_colormap[ds_source[spot[1]]] ];
+        c[2] = color8.to32[ ds_colormap[ds_source[spot[2]]] ];
+        c[3] = color8.to32[ ds_colormap[ds_source[spot[3]]] ];
+        vst1q_u32( p32, vld1q_u32( c ) );
+        p32 += 4;
+        xfrac += 4 * (uint32_t)ds_xstep;
+        yfrac += 4 * (uint32_t)ds_ystep;
+        count -= 4;
+    }
+    while( count-- )
+    {
+        *(p32++) = color8.to32[ ds_colormap[ds_source[SPAN_SPOT( xfrac, yfrac )]] ];
+        xfrac += ds_xstep;
+        yfrac += ds_ystep;
+    }
+}
+
+// (d * wd + s * ws) >> 8, for b,g,r of 4 pixels.  Keeps the dest alpha.
+static inline uint8x16_t blend4_neon( uint8x16_t d, uint8x16_t s,
+                                      uint8x8_t wd, uint8x8_t ws )
+{
+    uint16x8_t lo = vmlal_u8( vmull_u8( vget_low_u8( d ), wd ), vget_low_u8( s ), ws );
+    uint16x8_t hi = vmlal_u8( vmull_u8( vget_high_u8( d ), wd ), vget_high_u8( s ), ws );
+    uint8x16_t r = vcombine_u8( vshrn_n_u16( lo, 8 ), vshrn_n_u16( hi, 8 ) );
+    uint8x16_t alpha_mask = vreinterpretq_u8_u32( vdupq_n_u32( PIX32_ALPHA_MASK ) );
+    return vbslq_u8( alpha_mask, d, r );
+}
+
+static void R_DrawTranslucentSpan_32_NEON( void )
+{
+    uint32_t *  p32 = (uint32_t*)( ylookup[ds_y] + columnofs[ds_x1] );
+    int     count = ds_x2 - ds_x1 + 1;
+    uint32_t  xfrac = ds_xfrac;
+    uint32_t  yfrac = ds_yfrac;
+    uint32_t  spot[4];
+    uint32_t  c[4];
+    unsigned int alpha_d = dr_alpha;
+    unsigned int alpha_r = 255 - alpha_d;
+    uint8x8_t  wd = vdup_n_u8( alpha_r );
+    uint8x8_t  ws = vdup_n_u8( alpha_d );
+    span4_neon_t  sp;
+
+    span4_init_neon( &sp, xfrac, yfrac );
+    while( count >= 4 )
+    {
+        span4_spots_neon( &sp, spot );
+        c[0] = color8.to32[ ds_colormap[ds_source[spot[0]]] ];
+        c[1] = color8.to32[ ds_colormap[ds_source[spot[1]]] ];
+        c[2] = color8.to32[ ds_colormap[ds_source[spot[2]]] ];
+        c[3] = color8.to32[ ds_colormap[ds_source[spot[3]]] ];
+        uint8x16_t d = vreinterpretq_u8_u32( vld1q_u32( p32 ) );
+        uint8x16_t s = vreinterpretq_u8_u32( vld1q_u32( c ) );
+        vst1q_u32( p32, vreinterpretq_u32_u8( blend4_neon( d, s, wd, ws ) ) );
+        p32 += 4;
+        xfrac += 4 * (uint32_t)ds_xstep;
+        yfrac += 4 * (uint32_t)ds_ystep;
+        count -= 4;
+    }
+    while( count-- )
+    {
+        blend_pix32( p32++, color8.to32[ ds_colormap[ds_source[SPAN_SPOT( xfrac, yfrac )]] ],
+                     alpha_r, alpha_d );
+        xfrac += ds_xstep;
+        yfrac += ds_ystep;
+    }
+}
+
+static void R_DrawFogSpan_32_NEON( void )
+{
+    uint32_t *  p32 = (uint32_t*)( ylookup[ds_y] + columnofs[ds_x1] );
+    int     count = ds_x2 - ds_x1 + 1;
+    unsigned int alpha_d = dr_alpha;
+    unsigned int alpha_r = (255 - alpha_d) * 0.84;  // cloudy fog, as R_DrawFogSpan_32
+    uint32_t  fogcolor = color8.to32[ ds_colormap[ ds_source[fog_index] ]];
+    uint8x16_t  s = vreinterpretq_u8_u32( vdupq_n_u32( fogcolor ) );
+    uint8x8_t  wd = vdup_n_u8( alpha_r );
+    uint8x8_t  ws = vdup_n_u8( alpha_d );
+
+    while( count >= 4 )
+    {
+        uint8x16_t d = vreinterpretq_u8_u32( vld1q_u32( p32 ) );
+        vst1q_u32( p32, vreinterpretq_u32_u8( blend4_neon( d, s, wd, ws ) ) );
+        p32 += 4;
+        count -= 4;
+    }
+    while( count-- )
+        blend_pix32( p32++, fogcolor, alpha_r, alpha_d );
+}
+#endif  // ENABLE_DRAW32
+#endif  // SIMD_NEON
+
+
+// Replace the C drawers, set by SCR_SetMode, with SIMD drawers.
+void R_Setup_SIMD_Drawers( void )
+{
+    simd_drawer_name = NULL;
+
+    if( M_CheckParm( "-nosimd" ) )
+        return;
+
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+    if( ! __builtin_cpu_supports( "sse2" ) )
+        return;
+
+    switch( vid.drawmode )
+    {
+     case DRAW8PAL:
+        spanfunc = basespanfunc = R_DrawSpan_8_SSE2;
+        simd_drawer_name = "SSE2";
+        break;
+#ifdef ENABLE_DRAW32
+     case DRAW32:
+        transcolfunc = R_DrawTranslucentColumn_32_SSE2;
+        skintranscolfunc = R_DrawTranslucentColumn_32_SSE2;
+        if( __builtin_cpu_supports( "avx2" ) )
+        {
+            spanfunc = basespanfunc = R_DrawSpan_32_AVX2;
+            transspanfunc = R_DrawTranslucentSpan_32_AVX2;
+            fogspanfunc = R_DrawFogSpan_32_AVX2;
+            simd_drawer_name = "AVX2";
+        }
+        else
+        {
+            spanfunc = basespanfunc = R_DrawSpan_32_SSE2;
+            transspanfunc = R_DrawTranslucentSpan_32_SSE2;
+            fogspanfunc = R_DrawFogSpan_32_SSE2;
+            simd_drawer_name = "SSE2";
+        }
+        break;
+#endif
+     default:
+        break;
+    }
+#endif
+
+#ifdef SIMD_NEON
+    switch( vid.drawmode )
+    {
+     case DRAW8PAL:
+        spanfunc = basespanfunc = R_DrawSpan_8_NEON;
+        simd_drawer_name = "NEON";
+        break;
+#ifdef ENABLE_DRAW32
+     case DRAW32:
+        spanfunc = basespanfunc = R_DrawSpan_32_NEON;
+        transspanfunc = R_DrawTranslucentSpan_32_NEON;
+        fogspanfunc = R_DrawFogSpan_32_NEON;
+        simd_drawer_name = "NEON";
+        break;
+#endif
+     default:
+        break;
+    }
+#endif
+
+    if( simd_drawer_name )
+        GenPrintf( EMSG_ver, "Draw using %s drawers\n", simd_drawer_name );
+}
+
+
+// ==========================================================================
+//                      -simdcheck
+// ==========================================================================
+
+// Draw random spans and columns with the C drawer and with each SIMD drawer
+// that this cpu has, on scratch buffers, and compare every pixel.
+// Uses its own random numbers, and its own screen buffers.
+
+#define SIMDCHECK_WIDTH   640
+#define SIMDCHECK_HEIGHT  200
+#define SIMDCHECK_TESTS   4000
+
+typedef enum {
+   SC_span,
+   SC_transspan,
+   SC_fogspan,
+   SC_transcol,
+} simdcheck_kind_e;
+
+static uint32_t  simdcheck_seed = 0x1D872B41;
+static byte *  simdcheck_screen[2];
+static byte    simdcheck_flat[256*256];
+static byte    simdcheck_colormap[256];
+static byte    simdcheck_texture[1024];
+static unsigned int  simdcheck_mismatch = 0;
+
+static uint32_t  simdcheck_random( void )
+{
+    // xorshift32
+    simdcheck_seed ^= simdcheck_seed << 13;
+    simdcheck_seed ^= simdcheck_seed >> 17;
+    simdcheck_seed ^= simdcheck_seed << 5;
+    return simdcheck_seed;
+}
+
+// Random drawer inputs, the same for the C and the SIMD drawer.
+static void  simdcheck_setup( simdcheck_kind_e kind )
+{
+    static const byte translu_tab[5] =
+     { 0, TRANSLU_med, TRANSLU_more, TRANSLU_hi, TRANSLU_75 };
+    int sizeindex = 1 + (simdcheck_random() % 4);  // 32x32 .. 256x256 flat
+    int flatsize = 16 << sizeindex;
+    int i;
+
+    for( i=0; i<256; i++ )
+        simdcheck_colormap[i] = simdcheck_random();
+
+    flatfracbits = FRACBITS - (4 + sizeindex);
+    flat_imask = (flatsize << FRACBITS) - 1;
+    flat_ymask = (flatsize - 1) << (4 + sizeindex);
+    ds_source = simdcheck_flat;
+    ds_colormap = simdcheck_colormap;
+    ds_y = simdcheck_random() % SIMDCHECK_HEIGHT;
+    ds_x1 = simdcheck_random() % SIMDCHECK_WIDTH;
+    ds_x2 = ds_x1 + (simdcheck_random() % (SIMDCHECK_WIDTH - ds_x1));
+    ds_xfrac = simdcheck_random();
+    ds_yfrac = simdcheck_random();
+    // Steps of up to 4 texels either way.
+    ds_xstep = (int32_t)(simdcheck_random() % (8 << FRACBITS)) - (4 << FRACBITS);
+    ds_ystep = (int32_t)(simdcheck_random() % (8 << FRACBITS)) - (4 << FRACBITS);
+    dr_alpha = simdcheck_random();
+    fog_index = simdcheck_random();
+
+    if( kind == SC_transcol )
+    {
+        dc_source = simdcheck_texture;
+        dc_colormap = simdcheck_colormap;
+        dc_texheight = 1 + (simdcheck_random() % 256);  // any texture size
+        dc_iscale = 1 + (simdcheck_random() % (dc_texheight << FRACBITS));
+        dc_texturemid = (simdcheck_random() % (dc_texheight << FRACBITS));
+        dc_x = simdcheck_random() % SIMDCHECK_WIDTH;
+        dc_yl = simdcheck_random() % SIMDCHECK_HEIGHT;
+        dc_yh = dc_yl + (simdcheck_random() % (SIMDCHECK_HEIGHT - dc_yl));
+        dc_translucent_index = translu_tab[ simdcheck_random() % 5 ];
+        centery = simdcheck_random() % SIMDCHECK_HEIGHT;
+    }
+}
+
+// Point the drawers at one of the scratch screens.
+static void  simdcheck_screen_select( int sn, int bytepp )
+{
+    int i;
+    for( i=0; i<SIMDCHECK_HEIGHT; i++ )
+        ylookup[i] = simdcheck_screen[sn] + (i * SIMDCHECK_WIDTH * bytepp);
+    for( i=0; i<SIMDCHECK_WIDTH; i++ )
+        columnofs[i] = i * bytepp;
+    vid.ybytes = SIMDCHECK_WIDTH * bytepp;
+}
+
+// Return the number of tests that differ.
+static unsigned int  simdcheck_drawer( const char * name, int bytepp, simdcheck_kind_e kind,
+                                       void (*c_drawer)(void), void (*simd_drawer)(void) )
+{
+    int scrsize = SIMDCHECK_WIDTH * SIMDCHECK_HEIGHT * bytepp;
+    unsigned int  differ = 0;
+    int t, i;
+
+    // Random screen contents, including the 32bpp alpha byte.
+    // The screens stay equal between tests, so the background only
+    // needs to be filled once.
+    for( i=0; i<scrsize; i++ )
+        simdcheck_screen[0][i] = simdcheck_random();
+    memcpy( simdcheck_screen[1], simdcheck_screen[0], scrsize );
+
+    for( t=0; t<SIMDCHECK_TESTS; t++ )
+    {
+        simdcheck_setup( kind );
+
+        simdcheck_screen_select( 0, bytepp );
+        c_drawer();
+        simdcheck_screen_select( 1, bytepp );
+        simd_drawer();
+
+        if( memcmp( simdcheck_screen[0], simdcheck_screen[1], scrsize ) == 0 )
+            continue;
+
+        for( i=0; i<scrsize; i++ )
+        {
+            if( simdcheck_screen[0][i] != simdcheck_screen[1][i] )
+                break;
+        }
+        if( differ < 4 )
+        {
+            GenPrintf( EMSG_warn|EMSG_all, "SIMD check: %s test %d differs at x=%d y=%d, C=%02X SIMD=%02X\n",
+                       name, t, (i % (SIMDCHECK_WIDTH * bytepp)) / bytepp,
+                       i / (SIMDCHECK_WIDTH * bytepp),
+                       simdcheck_screen[0][i], simdcheck_screen[1][i] );
+        }
+        differ++;
+        // Resync the screens for the next test.
+        memcpy( simdcheck_screen[1], simdcheck_screen[0], scrsize );
+    }
+
+    GenPrintf( EMSG_info|EMSG_all, "SIMD check: %-32s %s\n", name, (differ)? "FAIL" : "ok" );
+    simdcheck_mismatch += differ;
+    return differ;
+}
+
+// -simdcheck
+// Check every SIMD drawer against its C drawer.
+// Return 0 when all match, 1 when any pixel differs.
+int  R_SIMD_Check( void )
+{
+    int  num_drawers = 0;
+    int  i;
+
+    simdcheck_screen[0] = malloc( SIMDCHECK_WIDTH * SIMDCHECK_HEIGHT * 4 );
+    simdcheck_screen[1] = malloc( SIMDCHECK_WIDTH * SIMDCHECK_HEIGHT * 4 );
+    if( ! simdcheck_screen[0] || ! simdcheck_screen[1] )
+        I_Error( "SIMD check: cannot allocate screens\n" );
+
+    for( i=0; i<sizeof(simdcheck_flat); i++ )
+        simdcheck_flat[i] = simdcheck_random();
+    for( i=0; i<sizeof(simdcheck_texture); i++ )
+        simdcheck_texture[i] = simdcheck_random();
+#ifdef ENABLE_DRAW32
+    for( i=0; i<256; i++ )
+        color8.to32[i] = simdcheck_random();
+#endif
+    simdcheck_mismatch = 0;
+
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+    if( __builtin_cpu_supports( "sse2" ) )
+    {
+        simdcheck_drawer( "R_DrawSpan_8_SSE2", 1, SC_span, R_DrawSpan_8, R_DrawSpan_8_SSE2 );
+        num_drawers++;
+#ifdef ENABLE_DRAW32
+        simdcheck_drawer( "R_DrawSpan_32_SSE2", 4, SC_span, R_DrawSpan_32, R_DrawSpan_32_SSE2 );
+        simdcheck_drawer( "R_DrawTranslucentSpan_32_SSE2", 4, SC_transspan,
+                          R_DrawTranslucentSpan_32, R_DrawTranslucentSpan_32_SSE2 );
+        simdcheck_drawer( "R_DrawFogSpan_32_SSE2", 4, SC_fogspan,
+                          R_DrawFogSpan_32, R_DrawFogSpan_32_SSE2 );
+        simdcheck_drawer( "R_DrawTranslucentColumn_32_SSE2", 4, SC_transcol,
+                          R_DrawTranslucentColumn_32, R_DrawTranslucentColumn_32_SSE2 );
+        num_drawers += 4;
+#endif
+    }
+#ifdef ENABLE_DRAW32
+    if( __builtin_cpu_supports( "avx2" ) )
+    {
+        simdcheck_drawer( "R_DrawSpan_32_AVX2", 4, SC_span, R_DrawSpan_32, R_DrawSpan_32_AVX2 );
+        simdcheck_drawer( "R_DrawTranslucentSpan_32_AVX2", 4, SC_transspan,
+                          R_DrawTranslucentSpan_32, R_DrawTranslucentSpan_32_AVX2 );
+        simdcheck_drawer( "R_DrawFogSpan_32_AVX2", 4, SC_fogspan,
+                          R_DrawFogSpan_32, R_DrawFogSpan_32_AVX2 );
+        num_drawers += 3;
+    }
+#endif
+#endif
+
+#ifdef SIMD_NEON
+    simdcheck_drawer( "R_DrawSpan_8_NEON", 1, SC_span, R_DrawSpan_8, R_DrawSpan_8_NEON );
+    num_drawers++;
+#ifdef ENABLE_DRAW32
+    simdcheck_drawer( "R_DrawSpan_32_NEON", 4, SC_span, R_DrawSpan_32, R_DrawSpan_32_NEON );
+    simdcheck_drawer( "R_DrawTranslucentSpan_32_NEON", 4, SC_transspan,
+                      R_DrawTranslucentSpan_32, R_DrawTranslucentSpan_32_NEON );
+    simdcheck_drawer( "R_DrawFogSpan_32_NEON", 4, SC_fogspan,
+                      R_DrawFogSpan_32, R_DrawFogSpan_32_NEON );
+    num_drawers += 3;
+#endif
+#endif
+
+    free( simdcheck_screen[0] );
+    free( simdcheck_screen[1] );
+
+    GenPrintf( EMSG_info|EMSG_all, "SIMD check: %d drawers, %d tests each, %u differ\n",
+               num_drawers, SIMDCHECK_TESTS, simdcheck_mismatch );
+    return ( simdcheck_mismatch )? 1 : 0;
+}
+
+#endif  // ENABLE_DRAW_SIMD
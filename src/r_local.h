@@ -59,5 +59,6 @@
 #include "r_data.h"
 #include "r_things.h"
 #include "r_draw.h"
+#include "r_thread.h"
 
 #endif // R_LOCAL_H
@@ -104,6 +104,8 @@
 #include "t_func.h"
 #include "am_map.h"
 #include "d_main.h"
+#include "g_tdreport.h"
+#include "m_profile.h"
 
 #ifdef HWRENDER
 #include "hardware/hw_main.h"
@@ -113,14 +115,6 @@
 // #define DEBUG_FIT_RATIO
 
 //profile stuff ---------------------------------------------------------
-//#define TIMING
-#ifdef TIMING
-#include "p5prof.h"
-long long mycount;
-long long mytotal = 0;
-//unsigned long  nombre = 100000;
-#endif
-//profile stuff ---------------------------------------------------------
 
 
 // Fineangles in the SCREENWIDTH wide window.  FINE_ANG90=2048.
@@ -1570,6 +1564,9 @@ void R_RenderPlayerView( byte pind, player_t* player )
 {
     // rendermode == render_soft
     R_SetupFrame(pind, player);
+#ifdef RENDER_THREADS
+    R_Thread_Frame_Start();
+#endif
 
     // Clear buffers.
     R_Clear_ClipSegs ();
@@ -1587,24 +1584,15 @@ void R_RenderPlayerView( byte pind, player_t* player )
 
     // The head node is the last node output.
 
-//profile stuff ---------------------------------------------------------
-#ifdef TIMING
-    mytotal=0;
-    ProfZeroTimer();
-#endif
-
     // [WDJ] Intercept degenerate case, so BSP node is never -1.
-    R_RenderBSPNode( ( numnodes > 0 )? numnodes-1
-                   : ( 0 | NF_SUBSECTOR ) );  // Degenerate, sector 0
-
-#ifdef TIMING
-    RDMSR(0x10,&mycount);
-    mytotal += mycount;   //64bit add
-
-    CONS_Printf("RenderBSPNode: 0x%d %d\n", *((int*)&mytotal+1),
-                                             (int)mytotal );
-#endif
-//profile stuff ---------------------------------------------------------
+    TDR_START( TDR_bsp );
+    {
+        PROF_ZONE( zt );
+        R_RenderBSPNode( ( numnodes > 0 )? numnodes-1
+                       : ( 0 | NF_SUBSECTOR ) );  // Degenerate, sector 0
+        PROF_END( zt, "R_RenderBSPNode" );
+    }
+    TDR_END( TDR_bsp );
 
 // horizontal column draw optimisation test.. deceiving.
 #ifdef HORIZONTALDRAW
@@ -1618,7 +1606,9 @@ void R_RenderPlayerView( byte pind, player_t* player )
     NetUpdate ();
 
     //R_Draw_Portals ();
+    TDR_START( TDR_planes );
     R_Draw_Planes ();
+    TDR_END( TDR_planes );
 
     // Check for new console commands.
     NetUpdate ();
@@ -1630,6 +1620,7 @@ void R_RenderPlayerView( byte pind, player_t* player )
 
     // draw mid texture and sprite
     // SoM: And now 3D floors/sides!
+    TDR_START( TDR_masked );
     R_Draw_Masked ();
 
     if( view_fogfloor
@@ -1646,6 +1637,12 @@ void R_RenderPlayerView( byte pind, player_t* player )
     if( cv_psprites.EV && !viewangleoffset && !script_camera_on
         && camera.chase != player )
         R_DrawPlayerSprites ();
+    TDR_END( TDR_masked );
+
+#ifdef RENDER_THREADS
+    // Finish the queued draws before the view is changed.
+    R_Thread_Frame_End();
+#endif
 
     // Check for new console commands.
     NetUpdate ();
@@ -1700,6 +1697,11 @@ void R_Register_EngineStuff (void)
     CV_RegisterVar (&cv_cam_height);
     CV_RegisterVar (&cv_cam_speed );
 
+#ifdef RENDER_THREADS
+    R_Thread_Register ();
+#endif
+    R_Data_Register ();
+
     // unfinished, not for release
 #ifdef PERSPCORRECT
     CV_RegisterVar (&cv_perspcorr);
@@ -88,6 +88,7 @@
 #include "v_video.h"
 #include "w_wad.h"
 #include "z_zone.h"
+#include "m_profile.h"
 
 #include "p_setup.h"    // levelflats
 
@@ -196,17 +197,6 @@ void R_Init_Planes (void)
 }
 
 
-//profile stuff ---------------------------------------------------------
-//#define TIMING
-#ifdef TIMING
-#include "p5prof.h"
-         long long mycount;
-         long long mytotal = 0;
-         unsigned long  nombre = 100000;
-#endif
-//profile stuff ---------------------------------------------------------
-
-
 //
 // R_MapPlane
 //
@@ -293,21 +283,7 @@ void R_MapPlane ( int y, int x1, int x2 )
     ds_x2 = x2;
     // high or low detail
 
-//added:16-01-98:profile hspans drawer.
-#ifdef TIMING
-  ProfZeroTimer();
-#endif
-   
-  spanfunc ();
-
-#ifdef TIMING
-  RDMSR(0x10,&mycount);
-  mytotal += mycount;   //64bit add
-  if(nombre--==0)
-  I_Error("spanfunc() CPU Spy reports: 0x%d %d\n", *((int*)&mytotal+1),
-                                        (int)mytotal );
-#endif
-
+  DRAW_SPAN( spanfunc );
 }
 
 
@@ -315,6 +291,20 @@ void R_MapPlane ( int y, int x1, int x2 )
 // R_Clear_Planes
 // At begining of frame.
 //
+// Number of visplanes in the last frame, for the timedemo report.
+int  R_Count_Visplanes (void)
+{
+    visplane_t * pl;
+    int  i, count = 0;
+
+    for (i=0; i<VISPL_HASHSIZE; i++)
+    {
+        for( pl = vispl_hashtab[i]; pl; pl = pl->next )
+            count++;
+    }
+    return count;
+}
+
 //Fab:26-04-98:
 // NOTE : uses con_clipviewtop, so that when console is on,
 //        don't draw the part of the view hidden under the console
@@ -794,7 +784,7 @@ void R_Draw_Planes (void)
                         if( dc_yl < 0 )  dc_yl = 0;
                         dc_source = & skytop_flat[ (angle & (SKY_FLAT_WIDTH-1)) ][0];
                         dc_texheight = SKY_FLAT_HEIGHT;
-                        skydrawerfunc[0] ();  // tiled
+                        DRAW_COLUMN( skydrawerfunc[0] );  // tiled
                         dc_texheight = sky_height;  // restore for sky_pict
                         dc_yl = yl_min;
                     }
@@ -806,13 +796,13 @@ void R_Draw_Planes (void)
                         if( dc_yh > rdraw_viewheight-1 )  dc_yh = rdraw_viewheight-1;		       
                         dc_source = & ground_flat[ (angle & (SKY_FLAT_WIDTH-1)) ][0];
                         dc_texheight = SKY_FLAT_HEIGHT;
-                        skydrawerfunc[0] ();  // tiled
+                        DRAW_COLUMN( skydrawerfunc[0] );  // tiled
                         dc_texheight = sky_height;  // restore for sky_pict
                         dc_yh = yh_max;
                     }
                     // sky_pict has colofs array
                     dc_source = & sky_pict[ ((uint32_t*)sky_pict)[ angle ] ];
-                    skycolfunc ();
+                    DRAW_COLUMN( skycolfunc );
                 }
             }
 #else
@@ -837,7 +827,7 @@ void R_Draw_Planes (void)
                     dc_x = x;
                     // Sky has dedicated texture.
                     dc_source = ((byte*)sky_patch) + sky_patch->columnofs[ angle & sky_widthmask ];
-                    skycolfunc ();
+                    DRAW_COLUMN( skycolfunc );
                 }
             }
 #endif
@@ -903,6 +893,7 @@ void R_DrawSinglePlane(visplane_t* pl)
   int  angf;
   lightlev_t  addlight = (pl->extra_colormap && pl->extra_colormap->fog) ? extralight_cm : extralight;
   lightlev_t  vlight = pl->lightlevel;  // visible light 0..255
+  PROF_ZONE( zt );
 
   if (pl->minx > pl->maxx)
     return;
@@ -997,6 +988,7 @@ void R_DrawSinglePlane(visplane_t* pl)
 
 
   Z_ChangeTag (ds_source, PU_CACHE);
+  PROF_END( zt, "R_DrawSinglePlane" );
 }
 
 
@@ -153,6 +153,7 @@ extern fixed_t          distscale[MAXVIDWIDTH];
 
 void R_Init_Planes (void);
 void R_Clear_Planes (player_t *player);
+int  R_Count_Visplanes (void);
 void R_Draw_Planes (void);
 
 // Draw plane span at row y, span=(x1..x2)
@@ -107,6 +107,8 @@
 #include "d_netcmd.h"
 #include "p_local.h" //Camera...
 #include "console.h" //Con_clipviewtop
+#include "g_tdreport.h"
+#include "m_profile.h"
 
 
 
@@ -315,7 +317,7 @@ void  R_Draw_WallColumn( texture_render_t * texren, int colnum )
 #ifdef HORIZONTALDRAW
     hcolfunc ();
 #else
-    colfunc ();
+    DRAW_COLUMN( colfunc );
 #endif
 }
 
@@ -685,7 +687,7 @@ static void R_DrawSplatColumn (column_t* column)
             //debug_Printf("l %d h %d %d\n",dc_yl,dc_yh, column->length);
             // Drawn by either R_DrawColumn
             //  or (SHADOW) R_DrawFuzzColumn.
-            colfunc ();
+            DRAW_COLUMN( colfunc );
         }
         column = (column_t *)(  (byte *)column + column->length + 4);
     }
@@ -1142,7 +1144,7 @@ void R_Render_PictureColumn ( byte * column_data )
     {
         // TM_picture format, do not have to adjust.
         dc_source = column_data;
-        colfunc ();
+        DRAW_COLUMN( colfunc );
     }
 }
 
@@ -2206,18 +2208,6 @@ nofog:
 #define FIXED_TO_HEIGHTFRAC( x )    ((x)>>(FRACBITS-HEIGHTBITS))
 
 
-//profile stuff ---------------------------------------------------------
-//#define TIMING
-#ifdef TIMING
-#include "p5prof.h"
-long long mycount;
-long long mytotal = 0;
-unsigned long   nombre = 100000;
-//static   char runtest[10][80];
-#endif
-//profile stuff ---------------------------------------------------------
-
-
 
 // Software Render
 // IN: rw_ parameters
@@ -2494,23 +2484,8 @@ void R_RenderSegLoop (void)
 
             dc_texturemid = rw_midtexturemid;
             dc_texheight = textureheight[midtexture] >> FRACBITS;
-            //profile stuff ---------------------------------------------------------
-#ifdef TIMING
-            ProfZeroTimer();
-#endif
-
             // Does not know if TM_picture or TM_patch	     
             R_Draw_WallColumn(mid_texren, texturecolumn);
-
-#ifdef TIMING
-            RDMSR(0x10,&mycount);
-            mytotal += mycount;      //64bit add
-            
-            if(nombre--==0)
-                I_Error("R_DrawColumn CPU Spy reports: 0x%d %d\n", *((int*)&mytotal+1),
-                (int)mytotal );
-#endif
-            //profile stuff ---------------------------------------------------------
           }
             // dont draw anything more for this column, since
             // a midtexture blocks the view
@@ -2683,7 +2658,7 @@ void R_RenderSegLoop (void)
 //  between start and stop pixels (inclusive).
 //
 // Called during BSP traversal for every visible linedef segment of a subsector.
-void R_StoreWallRange( int   start, int   stop)
+static void store_wall_range( int   start, int   stop)
 {
     fixed_t             hyp;
     fixed_t             sineval;
@@ -3618,3 +3593,13 @@ void R_StoreWallRange( int   start, int   stop)
     }
     ds_p++;
 }
+
+// Wall time for the timedemo report, and the profile.
+void R_StoreWallRange( int   start, int   stop)
+{
+    PROF_ZONE( zt );
+    TDR_START( TDR_walls );
+    store_wall_range( start, stop );
+    TDR_END( TDR_walls );
+    PROF_END( zt, "R_StoreWallRange" );
+}
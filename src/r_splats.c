@@ -38,6 +38,7 @@
 #include "r_main.h"
 #include "r_plane.h"
 #include "r_splats.h"
+#include "r_thread.h"
 #include "w_wad.h"
 #include "z_zone.h"
 #include "d_netcmd.h"
@@ -530,7 +531,7 @@ static void R_RenderFloorSplat (floorsplat_t* pSplat, vertex_t* verts, byte* pTe
         ds_y = y;
         ds_x1 = x1;
         ds_x2 = x2;
-        spanfunc ();
+        DRAW_SPAN( spanfunc );
 
         // reset for next calls to edge rasterizer
             rastertab[y].minx = FIXED_MAX;
@@ -918,6 +918,12 @@ void R_Init_Sprites (char** namelist)
 
 
 
+// Number of sprites in the last frame, for the timedemo report.
+int  R_Count_Vissprites (void)
+{
+    return vspr_count;
+}
+
 //
 // R_Clear_Sprites
 // Called at frame start.
@@ -1181,7 +1187,7 @@ void R_DrawMaskedColumn ( byte * column_data )
 
             // Drawn by either R_DrawColumn
             //  or (SHADOW) R_DrawFuzzColumn.
-            colfunc ();
+            DRAW_COLUMN( colfunc );
         }
         column = (column_t *)(  (byte *)column + column->length + 4);
     }
@@ -2028,6 +2034,11 @@ void R_DrawPlayerSprites (void)
     dm_floorclip = clip_screen_bot_max;  // clip at bottom of screen
     dm_ceilingclip = clip_screen_top_min;  // clip at top of screen
 
+#ifdef RENDER_THREADS
+    // Queued draws use centery.
+    R_Thread_Flush();
+#endif
+
     //added:06-02-98: quickie fix for psprite pos because of freelook
     kikhak = centery;
     centery = centerypsp;             //for R_DrawColumn
@@ -2042,6 +2053,10 @@ void R_DrawPlayerSprites (void)
             R_DrawPSprite (psp);
     }
 
+#ifdef RENDER_THREADS
+    R_Thread_Flush();
+#endif
+
     //added:06-02-98: oooo dirty boy
     centery = kikhak;
     centeryfrac = centery<<FRACBITS;
@@ -112,6 +112,7 @@ void R_AddSprites (sector_t* sec, int lightlevel);
 void R_AddPSprites (void);
 void R_Init_Sprites (char** namelist);
 void R_Clear_Sprites (void);
+int  R_Count_Vissprites (void);
 void R_Init_draw_masked();
 void R_Draw_Masked (void);
 
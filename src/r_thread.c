@@ -0,0 +1,413 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 2024 by DooM Legacy Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+//
+// DESCRIPTION:
+//      Threaded software render.
+//
+//   The BSP walk, seg clipping, plane and sprite setup stay on the main
+//   thread.  Each column and span draw is queued with its draw state.
+//   At a flush the screen is split into vertical strips, and every strip
+//   replays the whole queue in order, drawing only the pixels within
+//   the strip.  The main thread draws the first strip.
+//   Every pixel is drawn by one thread, in the original order, with the
+//   same draw state, so the screen is identical to the unthreaded draw.
+//
+//   Drawers that read or keep state across columns (fuzz, fog) are not
+//   queued.  The queue is flushed, and they are drawn by the main thread.
+//
+//-----------------------------------------------------------------------------
+
+#include "doomincl.h"
+#include "r_thread.h"
+
+#ifdef RENDER_THREADS
+
+#include <pthread.h>
+
+#include "r_draw.h"
+#include "r_state.h"
+#include "screen.h"
+#include "command.h"
+#include "m_profile.h"
+
+#define MAX_RENDER_THREADS  16
+
+CV_PossibleValue_t render_threads_cons_t[] = { {0, "MIN"}, {MAX_RENDER_THREADS, "MAX"}, {0, NULL} };
+// 0,1 = unthreaded draw, otherwise the number of screen strips.
+consvar_t cv_render_threads = {"r_threads", "0", CV_SAVE, render_threads_cons_t};
+
+byte  rth_active = 0;
+
+// A queued draw, with the draw state that it uses.
+typedef struct {
+    void (*drawfunc)(void);
+    byte  span;  // 0=column, 1=span
+
+    byte  alpha;
+#ifdef ENABLE_DRAW_ALPHA
+    byte  alpha_mode, alpha_background;
+    byte  color8;
+    RGBA_t  color;
+#endif
+
+    lighttable_t * colormap;
+    byte *  source;
+    byte *  translucentmap;
+
+    union {
+      struct {
+        int  x, yl, yh;
+        fixed_t  iscale, texturemid;
+        byte *  skintran;
+        int  texheight;
+        byte  translucent_index;
+      } col;
+      struct {
+        int  y, x1, x2;
+        fixed_t  xfrac, yfrac, xstep, ystep;
+        unsigned int  fracbits, ymask;
+        fixed_t  imask;
+      } span;
+    } u;
+} draw_cmd_t;
+
+static draw_cmd_t *  rth_queue = NULL;
+static int  rth_count = 0;
+static int  rth_alloc = 0;
+
+typedef struct {
+    pthread_t  thread;
+    int  x1, x2;  // strip, empty when x1 > x2
+} rth_worker_t;
+
+static rth_worker_t  rth_worker[MAX_RENDER_THREADS];
+static int  rth_num_workers = 0;  // worker threads started
+static int  rth_x2_main;  // main thread strip is 0..rth_x2_main
+
+static pthread_mutex_t  rth_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   rth_start_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t   rth_done_cond = PTHREAD_COND_INITIALIZER;
+static unsigned int  rth_generation = 0;  // one per flush
+static int  rth_pending = 0;  // workers still drawing
+
+
+static void rth_get_alpha( draw_cmd_t * cmd )
+{
+    cmd->alpha = dr_alpha;
+#ifdef ENABLE_DRAW_ALPHA
+    cmd->alpha_mode = dr_alpha_mode;
+    cmd->alpha_background = dr_alpha_background;
+    cmd->color8 = dr_color8;
+    cmd->color = dr_color;
+#endif
+}
+
+static void rth_set_alpha( draw_cmd_t * cmd )
+{
+    dr_alpha = cmd->alpha;
+#ifdef ENABLE_DRAW_ALPHA
+    dr_alpha_mode = cmd->alpha_mode;
+    dr_alpha_background = cmd->alpha_background;
+    dr_color8 = cmd->color8;
+    dr_color = cmd->color;
+#endif
+}
+
+static void rth_get_column( draw_cmd_t * cmd )
+{
+    rth_get_alpha( cmd );
+    cmd->span = 0;
+    cmd->colormap = dc_colormap;
+    cmd->source = dc_source;
+    cmd->translucentmap = dc_translucentmap;
+    cmd->u.col.x = dc_x;
+    cmd->u.col.yl = dc_yl;
+    cmd->u.col.yh = dc_yh;
+    cmd->u.col.iscale = dc_iscale;
+    cmd->u.col.texturemid = dc_texturemid;
+    cmd->u.col.skintran = dc_skintran;
+    cmd->u.col.texheight = dc_texheight;
+    cmd->u.col.translucent_index = dc_translucent_index;
+}
+
+static void rth_set_column( draw_cmd_t * cmd )
+{
+    rth_set_alpha( cmd );
+    dc_colormap = cmd->colormap;
+    dc_source = cmd->source;
+    dc_translucentmap = cmd->translucentmap;
+    dc_x = cmd->u.col.x;
+    dc_yl = cmd->u.col.yl;
+    dc_yh = cmd->u.col.yh;
+    dc_iscale = cmd->u.col.iscale;
+    dc_texturemid = cmd->u.col.texturemid;
+    dc_skintran = cmd->u.col.skintran;
+    dc_texheight = cmd->u.col.texheight;
+    dc_translucent_index = cmd->u.col.translucent_index;
+}
+
+static void rth_get_span( draw_cmd_t * cmd )
+{
+    rth_get_alpha( cmd );
+    cmd->span = 1;
+    cmd->colormap = ds_colormap;
+    cmd->source = ds_source;
+    cmd->translucentmap = ds_translucentmap;
+    cmd->u.span.y = ds_y;
+    cmd->u.span.x1 = ds_x1;
+    cmd->u.span.x2 = ds_x2;
+    cmd->u.span.xfrac = ds_xfrac;
+    cmd->u.span.yfrac = ds_yfrac;
+    cmd->u.span.xstep = ds_xstep;
+    cmd->u.span.ystep = ds_ystep;
+    cmd->u.span.fracbits = flatfracbits;
+    cmd->u.span.ymask = flat_ymask;
+    cmd->u.span.imask = flat_imask;
+}
+
+static void rth_set_span( draw_cmd_t * cmd )
+{
+    rth_set_alpha( cmd );
+    ds_colormap = cmd->colormap;
+    ds_source = cmd->source;
+    ds_translucentmap = cmd->translucentmap;
+    ds_y = cmd->u.span.y;
+    ds_x1 = cmd->u.span.x1;
+    ds_x2 = cmd->u.span.x2;
+    ds_xfrac = cmd->u.span.xfrac;
+    ds_yfrac = cmd->u.span.yfrac;
+    ds_xstep = cmd->u.span.xstep;
+    ds_ystep = cmd->u.span.ystep;
+    flatfracbits = cmd->u.span.fracbits;
+    flat_ymask = cmd->u.span.ymask;
+    flat_imask = cmd->u.span.imask;
+}
+
+
+// Replay the queue, drawing only within the strip x1..x2.
+static void rth_replay( int x1, int x2 )
+{
+    draw_cmd_t * cmd = rth_queue;
+    draw_cmd_t * end = rth_queue + rth_count;
+    uint32_t  skip;
+    PROF_ZONE( zt );
+
+    for( ; cmd < end; cmd++ )
+    {
+        if( cmd->span )
+        {
+            if( cmd->u.span.x2 < x1 || cmd->u.span.x1 > x2 )
+                continue;
+            rth_set_span( cmd );
+            if( ds_x1 < x1 )
+            {
+                // Start within the strip, with the same u,v steps the
+                // drawer would have made.  The flat index masks are
+                // low bit masks, so the wrap is the same.
+                skip = x1 - ds_x1;
+                ds_xfrac = (fixed_t)((uint32_t)ds_xfrac + (skip * (uint32_t)ds_xstep));
+                ds_yfrac = (fixed_t)((uint32_t)ds_yfrac + (skip * (uint32_t)ds_ystep));
+                ds_x1 = x1;
+            }
+            if( ds_x2 > x2 )
+                ds_x2 = x2;
+        }
+        else
+        {
+            if( cmd->u.col.x < x1 || cmd->u.col.x > x2 )
+                continue;
+            rth_set_column( cmd );
+        }
+        cmd->drawfunc();
+    }
+    PROF_END( zt, "R_Thread replay" );
+}
+
+static void * rth_worker_func( void * arg )
+{
+    rth_worker_t * wp = (rth_worker_t*) arg;
+    unsigned int  generation = 0;
+
+    for(;;)
+    {
+        pthread_mutex_lock( &rth_mutex );
+        while( rth_generation == generation )
+            pthread_cond_wait( &rth_start_cond, &rth_mutex );
+        generation = rth_generation;
+        pthread_mutex_unlock( &rth_mutex );
+
+        if( wp->x1 <= wp->x2 )
+            rth_replay( wp->x1, wp->x2 );
+
+        pthread_mutex_lock( &rth_mutex );
+        if( --rth_pending == 0 )
+            pthread_cond_signal( &rth_done_cond );
+        pthread_mutex_unlock( &rth_mutex );
+    }
+    return NULL;
+}
+
+
+void R_Thread_Register (void)
+{
+    CV_RegisterVar (&cv_render_threads);
+}
+
+// Setup the strips for this view.
+void R_Thread_Frame_Start (void)
+{
+    int num_strips = cv_render_threads.EV;
+    int i;
+
+    rth_active = 0;
+    rth_count = 0;
+
+    if( num_strips > rdraw_viewwidth )
+        num_strips = rdraw_viewwidth;
+    if( num_strips < 2 )
+        return;
+
+    // Start more workers when needed, they are never stopped.
+    while( rth_num_workers < num_strips - 1 )
+    {
+        rth_worker_t * wp = & rth_worker[rth_num_workers];
+        wp->x1 = 1;  // empty
+        wp->x2 = 0;
+        if( pthread_create( &wp->thread, NULL, rth_worker_func, wp ) )
+        {
+            GenPrintf( EMSG_warn, "Render threads: only %i threads started\n", rth_num_workers );
+            cv_render_threads.EV = rth_num_workers + 1;
+            num_strips = rth_num_workers + 1;
+            if( num_strips < 2 )
+                return;
+            break;
+        }
+        pthread_detach( wp->thread );
+        rth_num_workers++;
+    }
+
+    // Strip 0 is drawn by the main thread.
+    rth_x2_main = (rdraw_viewwidth / num_strips) - 1;
+    for( i = 0; i < rth_num_workers; i++ )
+    {
+        rth_worker_t * wp = & rth_worker[i];
+        if( i < num_strips - 1 )
+        {
+            wp->x1 = ((i+1) * rdraw_viewwidth) / num_strips;
+            wp->x2 = (((i+2) * rdraw_viewwidth) / num_strips) - 1;
+        }
+        else
+        {
+            wp->x1 = 1;  // empty
+            wp->x2 = 0;
+        }
+    }
+
+    rth_active = 1;
+}
+
+void R_Thread_Frame_End (void)
+{
+    R_Thread_Flush();
+    rth_active = 0;
+}
+
+void R_Thread_Flush (void)
+{
+    draw_cmd_t  save_col, save_span;
+
+    if( rth_count == 0 )
+        return;
+
+    // The main thread may be part way through setting up a draw.
+    rth_get_column( &save_col );
+    rth_get_span( &save_span );
+
+    pthread_mutex_lock( &rth_mutex );
+    rth_pending = rth_num_workers;
+    rth_generation++;
+    pthread_cond_broadcast( &rth_start_cond );
+    pthread_mutex_unlock( &rth_mutex );
+
+    rth_replay( 0, rth_x2_main );
+
+    pthread_mutex_lock( &rth_mutex );
+    while( rth_pending > 0 )
+        pthread_cond_wait( &rth_done_cond, &rth_mutex );
+    pthread_mutex_unlock( &rth_mutex );
+
+    rth_set_span( &save_span );
+    rth_set_column( &save_col );  // alpha too
+    rth_count = 0;
+}
+
+static draw_cmd_t * rth_queue_entry( void (*drawfunc)(void) )
+{
+    if( rth_count >= rth_alloc )
+    {
+        int  newalloc = ( rth_alloc )? rth_alloc * 2 : 8192;
+        draw_cmd_t * nq = realloc( rth_queue, newalloc * sizeof(draw_cmd_t) );
+        if( nq == NULL )
+            I_Error( "Render threads: draw queue alloc failed\n" );
+        rth_queue = nq;
+        rth_alloc = newalloc;
+    }
+    rth_queue[rth_count].drawfunc = drawfunc;
+    return & rth_queue[rth_count++];
+}
+
+void R_Thread_Column ( void (*drawfunc)(void) )
+{
+    if( drawfunc == R_DrawColumnShadowed )
+    {
+        // Cuts the column, and draws the pieces through basecolfunc.
+        drawfunc();
+        return;
+    }
+
+    if( drawfunc == basecolfunc || drawfunc == skincolfunc
+        || drawfunc == transcolfunc || drawfunc == skintranscolfunc
+        || drawfunc == shadecolfunc
+#ifdef ENABLE_DRAW_ALPHA
+        || drawfunc == alpha_colfunc
+#endif
+        || drawfunc == skydrawerfunc[0] || drawfunc == skydrawerfunc[1] )
+    {
+        rth_get_column( rth_queue_entry( drawfunc ) );
+        return;
+    }
+
+    // Fuzz, fog, and unknown drawers, draw in order on this thread.
+    R_Thread_Flush();
+    drawfunc();
+}
+
+void R_Thread_Span ( void (*drawfunc)(void) )
+{
+    if( drawfunc == basespanfunc || drawfunc == transspanfunc )
+    {
+        rth_get_span( rth_queue_entry( drawfunc ) );
+        return;
+    }
+
+    // Fog span keeps state across spans.
+    R_Thread_Flush();
+    drawfunc();
+}
+
+#endif
@@ -0,0 +1,62 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 2024 by DooM Legacy Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+//
+// DESCRIPTION:
+//      Threaded software render, draws in vertical screen strips.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef R_THREAD_H
+#define R_THREAD_H
+
+#include "doomdef.h"
+  // RENDER_THREADS
+#include "doomtype.h"
+#include "command.h"
+  // consvar_t
+
+#ifdef RENDER_THREADS
+extern consvar_t  cv_render_threads;
+
+// Set during a threaded frame, the column and span draws are queued.
+extern byte  rth_active;
+
+void  R_Thread_Register (void);
+
+// Called at the start and end of R_RenderPlayerView.
+void  R_Thread_Frame_Start (void);
+void  R_Thread_Frame_End (void);
+
+// Draw everything that has been queued, and wait for it.
+// Called before freeing memory that queued draws may reference.
+void  R_Thread_Flush (void);
+
+// Queue a draw using the current dc_ or ds_ draw state.
+void  R_Thread_Column ( void (*drawfunc)(void) );
+void  R_Thread_Span ( void (*drawfunc)(void) );
+
+#define DRAW_COLUMN( drawfunc ) \
+   ( rth_active ? R_Thread_Column( drawfunc ) : (drawfunc)() )
+#define DRAW_SPAN( drawfunc ) \
+   ( rth_active ? R_Thread_Span( drawfunc ) : (drawfunc)() )
+#else
+#define DRAW_COLUMN( drawfunc )   (drawfunc)()
+#define DRAW_SPAN( drawfunc )     (drawfunc)()
+#endif
+
+#endif
@@ -109,6 +109,7 @@
 #include "command.h"
 #include "g_game.h"
 #include "m_argv.h"
+#include "m_profile.h"
 #include "r_main.h"     //R_PointToAngle2() used to calc stereo sep.
 #include "r_things.h"   // for skins
 #include "p_info.h"
@@ -1325,7 +1326,7 @@ int mix_musicvolume = 0;
 
 // Called by D_DoomLoop upon tics.
 // Not called when dedicated.
-void S_UpdateSounds(void)
+static void update_sounds(void)
 {
     sound_param_t sp1;
     int cnum;
@@ -1461,6 +1462,13 @@ void S_UpdateSounds(void)
 
 }
 
+void S_UpdateSounds(void)
+{
+    PROF_ZONE( zt );
+    update_sounds();
+    PROF_END( zt, "S_UpdateSounds" );
+}
+
 //  volume : volume control,  0..31
 void S_SetMusicVolume(int volume)
 {
@@ -450,6 +450,10 @@ void SCR_SetMode( byte change_flag )
         goto bpp_err;
     }
 
+#ifdef ENABLE_DRAW_SIMD
+    R_Setup_SIMD_Drawers();
+#endif
+
     V_SetPalette (0);
 
     // set fuzzcolfunc
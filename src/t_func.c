@@ -1471,6 +1471,7 @@ void SF_Resurrect(void)
         {
             mo->height = mo->info->height;
             mo->radius = mo->info->radius;
+            P_ThingGrid_Radius( mo->radius );
         }
 
         mo->flags = mo->info->flags;
@@ -2146,6 +2147,7 @@ void SF_SetObjProperty(void)
     {
     case 0:
       mo->info->radius = (value*FRACUNIT);
+      P_ThingGrid_Radius( mo->info->radius );
       break;
     case 1:
       mo->info->height = (value*FRACUNIT);
@@ -3416,6 +3418,7 @@ void SF_SectorColormap(void)
                 sec->modelsec = 0;
             }
         }
+        P_Sight_Cache_Clear();  // model affects sight
     }
 
     t_return.value.s = R_ColormapNameForNum(sector->midmap);
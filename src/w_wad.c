@@ -113,6 +113,11 @@
 #include "w_wad.h"
 #include "z_zone.h"
 
+#ifdef MMAP_WAD
+#include <sys/mman.h>
+  // mmap, munmap
+#endif
+
 #include "v_video.h"
   // HWR_patchstore
 #include "d_netfil.h"
@@ -124,6 +129,7 @@
 #include "md5.h"
 #include "m_swap.h"
 #include "m_misc.h"
+#include "m_argv.h"
 
 #ifdef HWRENDER
 #include "hardware/hw_main.h"
@@ -143,6 +149,10 @@ int          numwadfiles;             // number of active wadfiles
 wadfile_t *  wadfiles[MAX_WADFILES];  // 0 to numwadfiles-1 are valid
   // wadfile_t are Z_MALLOC
 
+#ifdef MMAP_WAD
+byte  wad_mmap_enable = 0;  // -mmapwad
+#endif
+
 
 // Return the wadfile info for the lumpnum
 wadfile_t * lumpnum_to_wad( lumpnum_t lumpnum )
@@ -168,6 +178,14 @@ void W_Shutdown(void)
     while (numwadfiles--)
     {
         wadfile_t * wf = wadfiles[numwadfiles];
+#ifdef MMAP_WAD
+        if( wf->mmap_base )
+        {
+            Z_Remove_Mapped( wf->mmap_base );
+            munmap( wf->mmap_base, wf->filesize );
+            wf->mmap_base = NULL;
+        }
+#endif
         if( wf->handle >= 0 )
             close(wf->handle);
     }
@@ -238,6 +256,125 @@ byte  W_filename_classify( const char * filename )
 
 
 
+//===========================================================================
+//                                                          LUMP NAME INDEX
+//===========================================================================
+
+// [WDJ] Hash index of the lump directory, over the numerical lump names.
+// Each hash chain is kept in the same order as the old linear scan,
+// wad files backwards (PWAD precedence), and forward within a wad file.
+// New wad files are only ever added at the end of wadfiles[], so their
+// lumps are inserted at the head of each chain, lumps in reverse order.
+
+typedef struct {
+    uint64_t   namecode;   // lump_name_t namecode
+    lumpnum_t  lumpnum;    // wad/lump identifier
+    int32_t    next;       // next entry in chain, -1 = end
+} lump_hash_entry_t;
+
+static lump_hash_entry_t *  lump_hash_entry = NULL;  // realloc
+static int32_t *  lump_hash_head = NULL;  // bucket chain heads, malloc
+static uint32_t   lump_hash_size = 0;  // number of buckets, power of 2
+static int        lump_hash_shift = 64;  // 64 - log2(lump_hash_size)
+static int        lump_hash_num_entry = 0;
+static int        lump_hash_alloc_entry = 0;
+static int        lump_hash_numwad = 0;  // wadfiles that have been indexed
+
+static inline
+uint32_t  lump_hash_bucket( uint64_t namecode )
+{
+    // Fibonacci hash, upper bits of the product are well mixed.
+    return (uint32_t)((namecode * 0x9E3779B97F4A7C15ULL) >> lump_hash_shift);
+}
+
+// Add the lumps of one wad file to the index.
+// Must be called in increasing wad number order.
+static void  W_Hash_wad_lumps( int wadnum )
+{
+    wadfile_t * wf = wadfiles[wadnum];
+    lumpinfo_t * lump_p;
+    int  j;
+
+    if( ! wf->lumpinfo )  return;
+
+    // Reverse order, so the head insert leaves the chain in forward order.
+    lump_p = & wf->lumpinfo[ wf->numlumps - 1 ];
+    for( j = wf->numlumps - 1; j >= 0; j--, lump_p-- )
+    {
+        lump_hash_entry_t * ep = & lump_hash_entry[ lump_hash_num_entry ];
+        uint64_t namecode = *(uint64_t *)lump_p->name;
+        uint32_t bucket = lump_hash_bucket( namecode );
+        ep->namecode = namecode;
+        ep->lumpnum = WADLUMP(wadnum,j);
+        ep->next = lump_hash_head[bucket];
+        lump_hash_head[bucket] = lump_hash_num_entry++;
+    }
+}
+
+// Bring the lump name index up to date with wadfiles[].
+// Rebuilds when the wad list was reset, or the hash table must grow.
+// Called by W_Load_WadFile, W_Reload, and the lookups.
+void  W_Index_Lumps( void )
+{
+    int  total = 0;
+    int  i;
+
+    for( i = 0; i < numwadfiles; i++ )
+    {
+        if( wadfiles[i]->lumpinfo )
+            total += wadfiles[i]->numlumps;
+    }
+
+    if( lump_hash_numwad > numwadfiles  // wad list was reset
+        || total > lump_hash_alloc_entry )
+    {
+        // Full rebuild, keep load factor under 1.
+        uint32_t  size = 1024;
+        int  bits = 10;
+        while( size < total )
+        {
+            size <<= 1;
+            bits ++;
+        }
+        if( total > lump_hash_alloc_entry )
+        {
+            lump_hash_alloc_entry = size;
+            lump_hash_entry = realloc( lump_hash_entry, sizeof(lump_hash_entry_t) * size );
+            if( lump_hash_entry == NULL )
+                I_Error( "W_Index_Lumps: cannot allocate %i entries\n", size );
+        }
+        if( size != lump_hash_size )
+        {
+            free( lump_hash_head );
+            lump_hash_head = malloc( sizeof(int32_t) * size );
+            if( lump_hash_head == NULL )
+                I_Error( "W_Index_Lumps: cannot allocate %i buckets\n", size );
+            lump_hash_size = size;
+            lump_hash_shift = 64 - bits;
+        }
+        memset( lump_hash_head, 0xFF, sizeof(int32_t) * lump_hash_size );  // -1
+        lump_hash_num_entry = 0;
+        lump_hash_numwad = 0;
+    }
+
+    // Add any wad files not yet indexed.
+    for( ; lump_hash_numwad < numwadfiles; lump_hash_numwad++ )
+        W_Hash_wad_lumps( lump_hash_numwad );
+}
+
+// Return the first index entry of the chain for the name, -1 if none.
+static inline
+int32_t  W_Hash_first( uint64_t namecode )
+{
+    if( lump_hash_numwad != numwadfiles )
+        W_Index_Lumps();
+    if( lump_hash_head == NULL )
+        return -1;
+    return lump_hash_head[ lump_hash_bucket( namecode ) ];
+}
+
+
+
 // W_AddFile
 // All files are optional, but at least one file must be
 //  found (PWAD, if all required lumps are present).
@@ -498,6 +635,24 @@ int W_Load_WadFile ( const char * filename )
     wadfile->numlumps = numlumps;
     wadfile->lumpinfo = lumpinfo;
     wadfile->filesize = file_size;
+#ifdef MMAP_WAD
+    wadfile->mmap_base = NULL;
+    if( wad_mmap_enable && fc == FC_wad && handle >= 0 && file_size > 0 )
+    {
+        // Private mapping, so writes into a lump (such as endian fixes)
+        // are copy-on-write and never reach the file.
+        void * mp = mmap( NULL, file_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, handle, 0 );
+        if( mp == MAP_FAILED )
+        {
+            GenPrintf(EMSG_warn, "File %s: mmap failed, using read\n", filenamebuf );
+        }
+        else
+        {
+            wadfile->mmap_base = mp;
+            Z_Add_Mapped( mp, file_size );
+        }
+    }
+#endif
 
     //
     //  add the wadfile
@@ -599,6 +754,9 @@ int W_Load_WadFile ( const char * filename )
     wadfile->hwrcache = grPatch;
 #endif
 
+    // Index the new lumps before any lookup, such as dehacked lumps.
+    W_Index_Lumps();
+
     GenPrintf(EMSG_info, "Added file %s (%i lumps)\n", filenamebuf, numlumps);
     W_Load_dehacked_wad_lumps( filenum );
 
@@ -689,6 +847,10 @@ void W_Reload (void)
 
     close (handle);
     free(fileinfo);
+
+    // Force a full rebuild of the lump name index.
+    lump_hash_numwad = numwadfiles + 1;
+    W_Index_Lumps();
 }
 #endif
 
@@ -715,6 +877,10 @@ int W_Init_MultipleFiles ( char ** filenames )
     // open all the files, load headers, and count lumps
     numwadfiles = 0;
 
+#ifdef MMAP_WAD
+    wad_mmap_enable = M_CheckParm("-mmapwad") != 0;
+#endif
+
     // will be realloced as lumps are added
     for ( ; *filenames ; filenames++)
     {
@@ -750,36 +916,31 @@ int W_Init_MultipleFiles ( char ** filenames )
 lumpnum_t  W_Check_Namespace (const char* name, lump_namespace_e within_namespace)
 {
     lumpnum_t  alternate = NO_LUMP;
-    int  i,j;
+    int32_t  e;
     lump_name_t name8;
-    lumpinfo_t* lump_p;
+    lump_hash_entry_t * ep;
 
     numerical_name( name, & name8 );
 
-    // Scan wad files backwards so PWAD files take precedence.
-    for (i = numwadfiles-1 ; i>=0; i--)
+    // The chain is in scan order, wad files backwards so PWAD files
+    // take precedence, and forward within a wad file.
+    for( e = W_Hash_first( name8.namecode ); e >= 0; e = ep->next )
     {
-        // Scan forward within a wad file.
-        lump_p = wadfiles[i]->lumpinfo;
-        if( ! lump_p )  continue;
-
-        for (j = 0; j<wadfiles[i]->numlumps; j++,lump_p++)
-        { 
-            // Fast numerical name compare.
-            if ( *(uint64_t *)lump_p->name == name8.namecode )
+        ep = & lump_hash_entry[e];
+        // Fast numerical name compare.
+        if ( ep->namecode == name8.namecode )
+        {
+            // Name matches.
+            // Check if lump is from the wanted namespace.
+            if( within_namespace == LNS_any
+                || wadfiles[WADFILENUM(ep->lumpnum)]->lumpinfo[LUMPNUM(ep->lumpnum)].lump_namespace == within_namespace )
             {
-                // Name matches.
-                // Check if lump is from the wanted namespace.
-                if( within_namespace == LNS_any
-                    || lump_p->lump_namespace == within_namespace )
-                {
-                    // Return wad/lump identifier
-                    return  WADLUMP(i,j);
-                }
-                // Wrong namespace.
-                if( alternate == NO_LUMP )  // remember first lump found
-                   alternate = WADLUMP(i,j);  // wad/lump identifier
+                // Return wad/lump identifier
+                return  ep->lumpnum;
             }
+            // Wrong namespace.
+            if( alternate == NO_LUMP )  // remember first lump found
+               alternate = ep->lumpnum;  // wad/lump identifier
         }
     }
     // Not found.
@@ -805,9 +966,9 @@ lumpnum_t  W_CheckNumForName (const char* name)
 //  Return lump number, or NO_LUMP.
 lumpnum_t  W_CheckNumForNamePwad (const char* name, int wadid, int startlump)
 {
-    int  i;
+    int32_t  e;
     lump_name_t name8;
-    lumpinfo_t* lump_p;
+    lump_hash_entry_t * ep;
 
     // make the name into numerical for easy compares
     numerical_name( name, & name8 );
@@ -819,16 +980,19 @@ lumpnum_t  W_CheckNumForNamePwad (const char* name, int wadid, int startlump)
     //
     if (startlump < wadfiles[wadid]->numlumps)
     {
-        lump_p = wadfiles[wadid]->lumpinfo + startlump;
-        if( ! lump_p )
+        if( ! wadfiles[wadid]->lumpinfo )
             return NO_LUMP;
 
-        for (i = startlump; i<wadfiles[wadid]->numlumps; i++,lump_p++)
+        // The chain is forward within each wad.
+        for( e = W_Hash_first( name8.namecode ); e >= 0; e = ep->next )
         {
+            ep = & lump_hash_entry[e];
             // Fast numerical name compare.
-            if ( *(uint64_t *)lump_p->name == name8.namecode )
+            if ( ep->namecode == name8.namecode
+                 && WADFILENUM(ep->lumpnum) == wadid
+                 && LUMPNUM(ep->lumpnum) >= startlump )
             {
-                return WADLUMP(wadid,i);
+                return ep->lumpnum;
             }
         }
     }
@@ -864,29 +1028,28 @@ lumpnum_t  W_GetNumForName (const char* name)
 // Scan wads files forward, IWAD precedence.
 lumpnum_t  W_CheckNumForNameFirst (const char* name)
 {
-    int i, j;
+    lumpnum_t  found = NO_LUMP;
+    int32_t  e;
     lump_name_t name8;
-    lumpinfo_t* lump_p;
+    lump_hash_entry_t * ep;
 
     numerical_name( name, & name8 );
 
-    // scan wad files forward, when original wad resources
-    //  must take precedence
-    for (i = 0; i<numwadfiles; i++)
+    // Wad files forward, when original wad resources must take precedence.
+    // The chain has wad files backwards, forward within a wad file,
+    // so keep the first match of the lowest wad file.
+    for( e = W_Hash_first( name8.namecode ); e >= 0; e = ep->next )
     {
-        lump_p = wadfiles[i]->lumpinfo;
-        if( ! lump_p )  continue;
-
-        for (j = 0; j<wadfiles[i]->numlumps; j++,lump_p++)
+        ep = & lump_hash_entry[e];
+        if ( ep->namecode == name8.namecode )
         {
-            if ( *(uint64_t *)lump_p->name == name8.namecode )
-            {
-                return WADLUMP(i,j);
-            }
+            if( found == NO_LUMP
+                || WADFILENUM(ep->lumpnum) < WADFILENUM(found) )
+                found = ep->lumpnum;
         }
     }
 
-    return NO_LUMP;
+    return found;
 }
 
 //
@@ -1002,6 +1165,15 @@ int  W_ReadLumpHeader ( lumpnum_t     lump,
         bytesread = WZ_read_wadfile_from_archive_file_offset( wn1, wf, lif->position, size, /*OUT*/ dest );
     }
     else
+#endif
+#ifdef MMAP_WAD
+    if( wf->mmap_base && (lif->position + size) <= wf->filesize )
+    {
+        // Copy from the mapping, no syscalls.
+        memcpy( dest, wf->mmap_base + lif->position, size );
+        bytesread = size;
+    }
+    else
 #endif
     {
         lseek (handle, lif->position, SEEK_SET);
@@ -1043,7 +1215,28 @@ void W_ReadLump ( lumpnum_t     lump,
 // [WDJ] Indicates cache miss, new lump read requires endian fixing.
 boolean lump_read;	// set by W_CacheLumpNum
 
-void* W_CacheLumpNum ( lumpnum_t lumpnum, int ztag )
+#ifdef MMAP_WAD
+// Return the lump within the wad mapping, or NULL when it must be read.
+// Lumps are used in place as structs, so only 4 byte aligned lumps qualify.
+static
+void* W_Mapped_lump( wadfile_t * wf, unsigned int llump )
+{
+    lumpinfo_t * lif;
+    if( ! wf->mmap_base || ! wf->lumpinfo )
+        return NULL;
+    lif = & wf->lumpinfo[ llump ];
+    if( lif->size == 0
+        || (lif->position & 0x03)
+        || (lif->position + lif->size) > wf->filesize )
+        return NULL;
+    return wf->mmap_base + lif->position;
+}
+#endif
+
+//  allow_map : may return the lump within the wad mapping, otherwise it
+//     must be a Z_Malloc copy, that the caller may convert (endian).
+static
+void* W_Cache_lump ( lumpnum_t lumpnum, int ztag, byte allow_map )
 {
     lumpcache_t*  lumpcache;
 
@@ -1074,9 +1267,28 @@ void* W_CacheLumpNum ( lumpnum_t lumpnum, int ztag )
 #endif
 
     lumpcache = wadfiles[lfile]->lumpcache;
+#ifdef MMAP_WAD
+    if( lumpcache[llump] && ! allow_map && Z_Is_Mapped( lumpcache[llump] ) )
+    {
+        // The caller needs a zone copy, replace the mapped lump.
+        lumpcache[llump] = NULL;
+    }
+#endif
     if (!lumpcache[llump])
     {
         // read the lump in
+#ifdef MMAP_WAD
+        if( allow_map )
+        {
+            // Use the lump in place, it stays until W_Shutdown.
+            lumpcache[llump] = W_Mapped_lump( wadfiles[lfile], llump );
+            if( lumpcache[llump] )
+            {
+                lump_read = 1; // first use, caller may apply fixes
+                return lumpcache[llump];
+            }
+        }
+#endif
 
         //debug_Printf ("cache miss on lump %i\n",lump);
         byte* ptr = Z_Malloc ( W_LumpLength(lumpnum), ztag, &lumpcache[llump]);
@@ -1096,6 +1308,11 @@ void* W_CacheLumpNum ( lumpnum_t lumpnum, int ztag )
     return lumpcache[llump];
 }
 
+void* W_CacheLumpNum ( lumpnum_t lumpnum, int ztag )
+{
+    return W_Cache_lump( lumpnum, ztag, 1 );
+}
+
 
 // ==========================================================================
 // W_CacheLumpName
@@ -1167,7 +1384,8 @@ void* W_CachePatchNum_Endian ( lumpnum_t lump, int ztag )
 {
 // __BIG_ENDIAN__ is defined on MAC compilers, not on WIN, nor LINUX
 #ifdef __BIG_ENDIAN__
-    patch_t * patch = W_CacheLumpNum(lump, ztag);
+    // Needs a zone copy for the endian conversion.
+    patch_t * patch = W_Cache_lump(lump, ztag, 0);
     // [WDJ] If newly read patch then fix endian.
     if( lump_read )
     {
@@ -1195,9 +1413,9 @@ void* W_CachePatchNum_Endian ( lumpnum_t lump, int ztag )
 // Called from many draw functions
 void* W_CachePatchNum ( lumpnum_t lumpnum, int ztag )
 {
+#ifdef HWRENDER
     MipPatch_t*   grPatch;
 
-#ifdef HWRENDER
     if( ! HWR_patchstore ) {
         return W_CachePatchNum_Endian ( lumpnum, ztag );
     }
@@ -1228,7 +1446,7 @@ void* W_CachePatchNum ( lumpnum_t lumpnum, int ztag )
     return (void*)grPatch;
 #else
     // Software renderer only, simplified
-    return W_CachePatchNum_Endian( lump, ztag );
+    return W_CachePatchNum_Endian( lumpnum, ztag );
 #endif
 }
 
@@ -1330,6 +1548,11 @@ void* W_CacheRawAsPic( lumpnum_t lumpnum, int width, int height, int ztag)
 #endif
 
     lumpcache = wadfiles[lfile]->lumpcache;
+#ifdef MMAP_WAD
+    // A raw mapped lump is not a pic, must make the pic copy.
+    if( lumpcache[llump] && Z_Is_Mapped( lumpcache[llump] ) )
+        lumpcache[llump] = NULL;
+#endif
     if (!lumpcache[llump]) 	// cache miss
     {
         // read the lump in
@@ -1361,7 +1584,8 @@ void* W_CachePicNum( lumpnum_t lumpnum, int ztag )
 {
 // __BIG_ENDIAN__ is defined on MAC compilers, not on WIN, nor LINUX
 #ifdef __BIG_ENDIAN__
-    pic_t * pt = W_CacheLumpNum ( lumpnum, ztag );
+    // Needs a zone copy for the endian conversion.
+    pic_t * pt = W_Cache_lump ( lumpnum, ztag, 0 );
     // [WDJ] If newly read pic then fix endian.
     if( lump_read )
     {
@@ -1430,9 +1654,37 @@ uint64_t  W_lump_checksum( void* lumpptr )
     // Work only with the lumpptr given, cannot trust that can get stats
     // on the exact same lump, it may be in multiple wads and pwads.
     // Very simple checksum over the size of the Z_Malloc block.
-    int lumpsize = Z_Datasize( lumpptr );
+    int lumpsize;
     uint64_t  checksum = 0;
     int i;
+
+#ifdef MMAP_WAD
+    if( Z_Is_Mapped( lumpptr ) )
+    {
+        // Not a Z_Malloc block, find the lump size from the wad directory.
+        lumpsize = 0;
+        for( i=0; i<numwadfiles; i++ )
+        {
+            wadfile_t * wf = wadfiles[i];
+            lumpinfo_t * lif = wf->lumpinfo;
+            int j;
+            if( ! wf->mmap_base || ! lif )  continue;
+            if( (byte*)lumpptr < wf->mmap_base
+                || (byte*)lumpptr >= wf->mmap_base + wf->filesize )  continue;
+            for( j=0; j<wf->numlumps; j++, lif++ )
+            {
+                if( wf->mmap_base + lif->position == (byte*)lumpptr )
+                {
+                    lumpsize = lif->size;
+                    break;
+                }
+            }
+            break;
+        }
+    }
+    else
+#endif
+    lumpsize = Z_Datasize( lumpptr );
     for( i=0; i<lumpsize; i++ )
       checksum += ((byte*)lumpptr)[i];
     return checksum;
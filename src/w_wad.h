@@ -185,6 +185,9 @@ typedef struct wadfile_s
     byte             classify;   // file_classify_e
     byte             archive_parent;    // archive wadfile index,  0xFF= unused
     byte             archive_num_wadfile; // number of wadfile in this archive, 0= unused
+#endif
+#ifdef MMAP_WAD
+    byte *           mmap_base;  // whole file mapping, NULL when not mapped
 #endif
     int              numlumps;   // this wad's number of resources
     int              handle;     // from system
@@ -201,6 +204,11 @@ wadfile_t * lumpnum_to_wad( lumpnum_t lumpnum );
 // [WDJ] Indicates cache miss, new lump read requires endian fixing.
 extern boolean lump_read;
 
+#ifdef MMAP_WAD
+// Set by -mmapwad, wad files loaded after are memory mapped.
+extern byte  wad_mmap_enable;
+#endif
+
 // return file_classify_e
 byte  W_filename_classify( const char * filename );
 
@@ -234,6 +242,9 @@ int     W_Init_MultipleFiles( char** filenames );
 //  WADFILE_RELOAD
 void    W_Reload (void);
 
+// Update the lump name hash index after wadfiles[] changes.
+void    W_Index_Lumps( void );
+
 //  Return lump id, or NO_LUMP if name not found.
 lumpnum_t  W_Check_Namespace (const char* name, lump_namespace_e within_namespace);
 //  Return lump id, or NO_LUMP if name not found.
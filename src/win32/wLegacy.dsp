@@ -908,10 +908,6 @@ SOURCE=..\mserv.h
 # End Source File
 # Begin Source File
 
-SOURCE=..\p5prof.h
-# End Source File
-# Begin Source File
-
 SOURCE=..\Qmus2mid.c
 # End Source File
 # Begin Source File
@@ -67,6 +67,8 @@
 #include "command.h"
 #include "m_argv.h"
 #include "i_video.h"
+#include "r_thread.h"
+  // RENDER_THREADS
 #ifdef HWRENDER
 #include "hardware/hw_drv.h"
    // for hardware memory stats
@@ -120,6 +122,12 @@
 // Applied as an option to ZONE_ZALLOC.
 #define GROW_ZONE
 
+// Size-class slabs for small non-purgable allocations (mobj parts,
+// thinkers, secnodes, FraggleScript values).  Keeps them out of the
+// rover walk, which reduces zone fragmentation over long sessions.
+// Applied as an option to ZONE_ZALLOC.
+#define ZONE_SLAB
+
 // Aggressively purges any PU_CACHE, clearing cache faster.
 // This stresses the memory system more, testing user code to not
 // depend upon PU_CACHE that can disappear. Used for testing memory code.
@@ -141,6 +149,7 @@
 #ifdef PLAIN_MALLOC
   #undef ZONE_ZALLOC
   #undef GROW_ZONE
+  #undef ZONE_SLAB
   #define USE_MALLOC
 #endif
 
@@ -148,6 +157,7 @@
   #undef ZONE_ZALLOC
   #undef PLAIN_MALLOC
   #undef GROW_ZONE
+  #undef ZONE_SLAB
   #define USE_MALLOC
 #endif
 
@@ -184,6 +194,7 @@ memzone_t	memhead;	// statically allocated mainzone
 #endif
 
 #define ZONEID  0x1d4a11
+#define SLABID  0x1d4a5b
 #define INVALIDID 0x22eebb00
 
 void Command_MemInfo_f( void );
@@ -360,6 +371,248 @@ memblock_t*  Z_GrowZone( int reqsize, int std_grow )
     }
 }
 #endif
+
+
+#ifdef ZONE_SLAB
+// =========================================================================
+//                        SLAB ALLOCATION
+// =========================================================================
+//
+// Small allocations, with a tag < PU_PURGELEVEL, except PU_LUMP and
+// PU_IN_USE, are taken from chunks of equal size items, one chunk list
+// per size class.  An item changed to a purgable tag stays in its slab,
+// and is purged when Z_Malloc has searched the whole zone.
+// Each item has a memblock_t header, with id=SLABID, so the tag and user
+// are kept like any zone block, and Z_ChangeTag, Z_Datasize work unchanged.
+// The in-use items of a class are linked by next, prev, so that Z_FreeTags
+// can free them by tag.  Free items are linked by next in their chunk.
+// The chunks are aligned zone blocks, so an item finds its chunk by
+// masking its address.
+// A dedicated pool (Z_Pool_Create) is a slab class of one item size,
+// with its items aligned, kept apart from the other allocations.
+
+#define SLAB_CHUNK_BITS   14
+#define SLAB_CHUNK_SIZE   (1<<SLAB_CHUNK_BITS)
+#define SLAB_MAX_REQSIZE  256
+
+typedef struct slab_chunk_s  slab_chunk_t;
+typedef struct slab_class_s  slab_class_t;
+
+struct slab_chunk_s
+{
+    slab_chunk_t * next, * prev;  // chunk list of the class
+    slab_class_t * sclass;
+    memblock_t *   freelist;  // free items, linked by next
+    int            num_used;
+    int            pad;  // keep items 8 byte aligned
+};
+
+struct slab_class_s
+{
+    int            datasize;  // usable bytes per item
+    int            itemsize;  // including memblock_t
+    int            items_per_chunk;
+    int            first_item;  // offset of the first item in a chunk
+    const char *   name;  // dedicated pool, NULL for a size class
+    int            num_chunk;
+    int            num_used;
+    slab_chunk_t * chunks;  // chunks with free items are first
+    memblock_t     inuse;   // head of in-use item list
+};
+
+#define NUM_SLAB_CLASS  8
+static const int slab_class_datasize[NUM_SLAB_CLASS] =
+{  16, 32, 48, 64, 96, 128, 192, SLAB_MAX_REQSIZE };
+
+// The size classes, then the dedicated pools.
+#define MAX_SLAB_POOL   4
+static slab_class_t  slab_class[NUM_SLAB_CLASS + MAX_SLAB_POOL];
+static int  num_slab_class = NUM_SLAB_CLASS;
+// Index to class by (reqsize-1)/16.
+static byte  slab_class_index[ SLAB_MAX_REQSIZE/16 ];
+
+static void Z_Slab_Init( void )
+{
+    int i, c;
+    for( c=0; c<NUM_SLAB_CLASS; c++ )
+    {
+        slab_class_t * sc = & slab_class[c];
+        sc->datasize = slab_class_datasize[c];
+        sc->itemsize = (sc->datasize + sizeof(memblock_t) + 7) & ~7;
+        sc->first_item = sizeof(slab_chunk_t);
+        sc->name = NULL;
+        sc->items_per_chunk = (SLAB_CHUNK_SIZE - sc->first_item) / sc->itemsize;
+        sc->num_chunk = 0;
+        sc->num_used = 0;
+        sc->chunks = NULL;
+        sc->inuse.next = sc->inuse.prev = & sc->inuse;
+        sc->inuse.memtag = PU_ZONE;
+        sc->inuse.id = SLABID;
+    }
+    c = 0;
+    for( i=0; i < SLAB_MAX_REQSIZE/16; i++ )
+    {
+        if( (i+1)*16 > slab_class_datasize[c] )  c++;
+        slab_class_index[i] = c;
+    }
+}
+
+// Make a new chunk for the class, put it at the head of the chunk list.
+static slab_chunk_t * Z_Slab_NewChunk( slab_class_t * sc )
+{
+    slab_chunk_t * ch;
+    byte * ip;
+    int i;
+
+    ch = Z_MallocAlign( SLAB_CHUNK_SIZE, PU_STATIC, NULL, SLAB_CHUNK_BITS );
+    ch->sclass = sc;
+    ch->num_used = 0;
+    ch->freelist = NULL;
+    // Free list in address order.
+    ip = (byte*)ch + sc->first_item + ((sc->items_per_chunk - 1) * sc->itemsize);
+    for( i = sc->items_per_chunk; i > 0; i--, ip -= sc->itemsize )
+    {
+        memblock_t * ib = (memblock_t*) ip;
+        ib->id = SLABID;
+        ib->size = sc->itemsize;
+        ib->memtag = PU_FREE;
+        ib->user = NULL;
+        ib->prev = NULL;
+        ib->next = ch->freelist;
+        ch->freelist = ib;
+    }
+
+    ch->prev = NULL;
+    ch->next = sc->chunks;
+    if( sc->chunks )
+        sc->chunks->prev = ch;
+    sc->chunks = ch;
+    sc->num_chunk++;
+    return ch;
+}
+
+static void Z_Slab_UnlinkChunk( slab_class_t * sc, slab_chunk_t * ch )
+{
+    if( ch->prev )
+        ch->prev->next = ch->next;
+    else
+        sc->chunks = ch->next;
+    if( ch->next )
+        ch->next->prev = ch->prev;
+}
+
+static void* Z_Slab_Alloc( slab_class_t * sc, memtag_e tag, void **user )
+{
+    slab_chunk_t * ch = sc->chunks;
+    memblock_t * ib;
+
+    if( ch == NULL || ch->freelist == NULL )
+        ch = Z_Slab_NewChunk( sc );
+
+    ib = ch->freelist;
+    ch->freelist = ib->next;
+    ch->num_used++;
+    sc->num_used++;
+    if( ch->freelist == NULL && ch->next )
+    {
+        // Full, move it to the tail, so chunks with free items are first.
+        slab_chunk_t * tail = ch->next;
+        while( tail->next )  tail = tail->next;
+        Z_Slab_UnlinkChunk( sc, ch );
+        tail->next = ch;
+        ch->prev = tail;
+        ch->next = NULL;
+    }
+
+    ib->memtag = tag;
+    ib->user = user;
+    // link into in-use list
+    Z_LinkBlock( ib, & sc->inuse, sc->inuse.next );
+
+    void * data = (byte*)ib + sizeof(memblock_t);
+    if( user )  *user = data;
+    return data;
+}
+
+static void* Z_Slab_Malloc( int reqsize, memtag_e tag, void **user )
+{
+    return Z_Slab_Alloc( & slab_class[ slab_class_index[ (reqsize-1) >> 4 ] ], tag, user );
+}
+
+static void Z_Slab_Free( memblock_t * ib )
+{
+    slab_chunk_t * ch = (slab_chunk_t*)( (uintptr_t)ib & ~(uintptr_t)(SLAB_CHUNK_SIZE-1) );
+    slab_class_t * sc = ch->sclass;
+
+    if( ib->user )
+    {
+        // clear the user's owner ptr (they no longer have access)
+        *ib->user = NULL;
+    }
+    // unlink from in-use list
+    ib->prev->next = ib->next;
+    ib->next->prev = ib->prev;
+
+    ib->memtag = PU_FREE;
+    ib->user = NULL;
+    ib->prev = NULL;
+    ib->next = ch->freelist;
+    if( ch->freelist == NULL && ch != sc->chunks )
+    {
+        // Was full, move it to the head.
+        Z_Slab_UnlinkChunk( sc, ch );
+        ch->prev = NULL;
+        ch->next = sc->chunks;
+        sc->chunks->prev = ch;
+        sc->chunks = ch;
+    }
+    ch->freelist = ib;
+    ch->num_used--;
+    sc->num_used--;
+
+    if( ch->num_used == 0 && sc->num_chunk > 1 )
+    {
+        // Keep one empty chunk per class, return the others to the zone.
+        Z_Slab_UnlinkChunk( sc, ch );
+        sc->num_chunk--;
+        Z_Free( ch );
+    }
+}
+
+static void Z_Slab_FreeTags( memtag_e lowtag, memtag_e hightag )
+{
+    int c;
+    for( c=0; c<num_slab_class; c++ )
+    {
+        memblock_t * head = & slab_class[c].inuse;
+        memblock_t * ib = head->next;
+        while( ib != head )
+        {
+            memblock_t * next = ib->next;  // get link before freeing
+            if( ib->memtag >= lowtag && ib->memtag <= hightag )
+                Z_Slab_Free( ib );
+            ib = next;
+        }
+    }
+}
+
+// Free the slab items that became purgable, by Z_ChangeTag.
+// The rover does not walk the slabs, so Z_Malloc calls this when
+// it has searched the whole zone.
+// Return the number of chunks given back to the zone.
+static int Z_Slab_Purge( void )
+{
+    int c;
+    int num_chunk = 0;
+
+    for( c=0; c<num_slab_class; c++ )
+        num_chunk += slab_class[c].num_chunk;
+    Z_Slab_FreeTags( PU_PURGELEVEL, PU_CACHE_DEFAULT );
+    for( c=0; c<num_slab_class; c++ )
+        num_chunk -= slab_class[c].num_chunk;
+    return num_chunk;
+}
+#endif	// ZONE_SLAB
 #endif	// ZONE_ZALLOC
 
 
@@ -434,6 +687,9 @@ void Z_Init (void)
     if( mb_wanted > 2047 )   mb_wanted = 2047;	// [WDJ]
     GenPrintf( EMSG_info, "%d MiB requested for Z_Init.\n", mb_wanted);
     Z_ZoneInit( mb_wanted );
+#ifdef ZONE_SLAB
+    Z_Slab_Init();
+#endif
 #endif
 
     // calls Z_Malloc, so must be last
@@ -441,6 +697,54 @@ void Z_Init (void)
 }
 
 
+// [WDJ] Memory mapped regions (mmap wad files).
+// Lumps within these regions are handed out as if they were zone blocks,
+// so Z_Free and Z_ChangeTag must ignore them.
+#define MAX_MAPPED_REGION  32
+typedef struct {
+    byte *  base;
+    size_t  size;
+} mapped_region_t;
+
+static mapped_region_t  mapped_region[ MAX_MAPPED_REGION ];
+static int  num_mapped_region = 0;
+
+void  Z_Add_Mapped( void * base, size_t size )
+{
+    if( num_mapped_region >= MAX_MAPPED_REGION )
+        I_Error( "Z_Add_Mapped: too many mapped regions\n" );
+    mapped_region[num_mapped_region].base = base;
+    mapped_region[num_mapped_region].size = size;
+    num_mapped_region++;
+}
+
+void  Z_Remove_Mapped( void * base )
+{
+    int i;
+    for( i=0; i<num_mapped_region; i++ )
+    {
+        if( mapped_region[i].base == base )
+        {
+            mapped_region[i] = mapped_region[--num_mapped_region];
+            return;
+        }
+    }
+}
+
+// Return true when ptr is within a mapped region, and is not a zone block.
+byte  Z_Is_Mapped( void * ptr )
+{
+    int i;
+    for( i=0; i<num_mapped_region; i++ )
+    {
+        if( (byte*)ptr >= mapped_region[i].base
+            && (byte*)ptr < mapped_region[i].base + mapped_region[i].size )
+            return 1;
+    }
+    return 0;
+}
+
+
 //
 // Z_Free
 //
@@ -452,6 +756,14 @@ void Z_Free (void* ptr)
 {
     memblock_t*  block = (memblock_t *) ( (byte *)ptr - sizeof(memblock_t));
 
+    // Lumps in a mapped wad are never freed.
+    if( num_mapped_region && Z_Is_Mapped( ptr ) )  return;
+
+#ifdef RENDER_THREADS
+    // Queued render draws may still reference this memory.
+    if( rth_active )  R_Thread_Flush();
+#endif
+
 #ifdef DEBUG_ZONE
 #ifndef PLAIN_MALLOC
    memblock_t*         other;
@@ -478,6 +790,14 @@ for (other = mainzone->blocklist.next ; other->next != &mainzone->blocklist; oth
 #endif
 #endif
 
+#ifdef ZONE_SLAB
+    if (block->id == SLABID)
+    {
+        if (block->memtag == PU_FREE)  return;	// already freed
+        Z_Slab_Free( block );
+        return;
+    }
+#endif
     if (block->id != ZONEID)
         I_Error ("Z_Free: memory block has corrupt ZONEID: %x", block->id);
     if (block->memtag == PU_FREE)  return;	// already freed
@@ -623,6 +943,24 @@ void* Z_MallocAlign (int reqsize, memtag_e tag, void **user, int alignbits )
 
     if( tag == PU_CACHE_DEFAULT )   tag = PU_CACHE;
 
+#ifdef ZONE_SLAB
+    // Small, non-purgable, allocations from the slabs.
+    // PU_LUMP and PU_IN_USE become PU_CACHE at level exit, and are kept
+    // in the zone, where the rover purges them.
+    if( reqsize > 0 && reqsize <= SLAB_MAX_REQSIZE
+        && tag < PU_PURGELEVEL && tag != PU_LUMP && tag != PU_IN_USE
+        && alignbits <= 3 )
+    {
+        void * sp = Z_Slab_Malloc( reqsize, tag, user );
+# ifdef DEBUG_ZONE
+        memblock_t * sb = (memblock_t *)((byte *)sp - sizeof(memblock_t));
+        sb->ownerfile = file;
+        sb->ownerline = line;
+# endif
+        return sp;
+    }
+#endif
+
     reqsize = (reqsize + 3) & ~3;	// alloc rounded up to next 4 byte alignment
     // account for size of block header
     memalloc_size = reqsize + sizeof(memblock_t);
@@ -663,6 +1001,20 @@ void* Z_MallocAlign (int reqsize, memtag_e tag, void **user, int alignbits )
         if (rover == start)
         {
             // scanned all the way around the list
+#ifdef ZONE_SLAB
+            // Purgable slab items, which were changed to PU_CACHE,
+            // can give chunks back to the zone.  Search it again.
+            if( Z_Slab_Purge() )
+            {
+                rover = mainzone->rover;
+                if ( rover->prev->memtag == PU_FREE )
+                    rover = rover->prev;
+                start = rover->prev;
+                base = NULL;
+                basesize = 0;
+                continue;
+            }
+#endif
             //faB: debug to see if problems of memory fragmentation..
             Command_MemInfo_f();
 	   
@@ -906,6 +1258,10 @@ void Z_FreeTags( memtag_e lowtag, memtag_e hightag )
 
     // protect PU_FREE, and PU_ZONE
     if ( lowtag < PU_INVALID )   lowtag = PU_INVALID;
+
+#ifdef ZONE_SLAB
+    Z_Slab_FreeTags( lowtag, hightag );
+#endif
    
     for (block = mainzone->blocklist.next ;
          block != &mainzone->blocklist ; )
@@ -957,6 +1313,17 @@ void Z_ChangeTags_To( memtag_e old_tag, memtag_e new_tag )
         // free blocks will not match
         if (block->memtag == old_tag)  block->memtag = new_tag;
     }
+#ifdef ZONE_SLAB
+    int c;
+    for( c=0; c<num_slab_class; c++ )
+    {
+        memblock_t * head = & slab_class[c].inuse;
+        for( block = head->next; block != head; block = block->next )
+        {
+            if (block->memtag == old_tag)  block->memtag = new_tag;
+        }
+    }
+#endif
 #endif   
 }
 
@@ -1084,6 +1451,23 @@ void Z_CheckHeap (int i)
             I_Error ("Z_CheckHeap: two consecutive free blocks %d\n",i);
 #endif
     }
+#ifdef ZONE_SLAB
+    int c;
+    for( c=0; c<num_slab_class; c++ )
+    {
+        memblock_t * head = & slab_class[c].inuse;
+        for( block = head->next; block != head; block = block->next )
+        {
+            if (block->id != SLABID || block->memtag == PU_FREE)
+                I_Error ("Z_CheckHeap: corrupt slab item %d\n",i);
+            if (block->user &&
+                (*block->user != (byte *)block + sizeof(memblock_t)))
+                I_Error ("Z_CheckHeap: slab item doesn't have a proper user %d\n",i);
+            if ( block->next->prev != block)
+                I_Error ("Z_CheckHeap: slab item doesn't have proper back link %d\n",i);
+        }
+    }
+#endif
 #endif	// TAGGED_MALLOC, ZONE_ZALLOC
 }
 
@@ -1099,6 +1483,8 @@ void  Z_ChangeTag_debug (void *ptr, memtag_e chtag, char * fn, int ln)
 void  Z_ChangeTag ( void* ptr, memtag_e chtag )
 #endif
 {
+    // Lumps in a mapped wad have no tag.
+    if( num_mapped_region && Z_Is_Mapped( ptr ) )  return;
 
 #ifdef PARANOIA
     if( ! verify_Z_Malloc( ptr ) )
@@ -1113,7 +1499,11 @@ void  Z_ChangeTag ( void* ptr, memtag_e chtag )
     memblock_t* block;
     block = (memblock_t *) ( (byte *)ptr - sizeof(memblock_t));
 
+#ifdef ZONE_SLAB
+    if (block->id != ZONEID && block->id != SLABID)
+#else
     if (block->id != ZONEID)
+#endif
         I_Error ("Z_ChangeTag: free block has corrupt ZONEID: %x", block->id);
 
     if (chtag >= PU_PURGELEVEL && !block->user)
@@ -1165,7 +1555,12 @@ done:
 byte  verify_Z_Malloc( void * mp )
 {
     memblock_t * mmp = (memblock_t*) ((byte *)(mp) - sizeof(memblock_t));
+    if( num_mapped_region && Z_Is_Mapped( mp ) )  return 1;
+#ifdef ZONE_SLAB
+    if( mmp->id != ZONEID && mmp->id != SLABID )  return 0;
+#else
     if( mmp->id != ZONEID )  return 0;
+#endif
     if( mmp->memtag < PU_STATIC || mmp->memtag > PU_CACHE_DEFAULT )  return 0;
     return 1;
 }
@@ -1244,6 +1639,18 @@ int Z_TagUsage (memtag_e usetag)
             bytes += block->size;
     }
 #endif
+#ifdef ZONE_SLAB
+    int c;
+    for( c=0; c<num_slab_class; c++ )
+    {
+        memblock_t * head = & slab_class[c].inuse;
+        for( block = head->next; block != head; block = block->next )
+        {
+            if (block->memtag == usetag)
+                bytes += block->size;
+        }
+    }
+#endif
 
     return bytes;
 }
@@ -1272,6 +1679,25 @@ void Command_MemInfo_f(void)
     CONS_Printf("free  memory       : %7d KiB\n", memfree>>10);
     CONS_Printf("cache memory       : %7d KiB\n", cache>>10);
     CONS_Printf("largest free block : %7d KiB\n", largefreeblock>>10);
+#ifdef ZONE_SLAB
+    {
+        int c;
+        CONS_Printf("\2Slab Info (in used memory)\n");
+        for( c=0; c<num_slab_class; c++ )
+        {
+            slab_class_t * sc = & slab_class[c];
+            int total = sc->num_chunk * sc->items_per_chunk;
+            if( sc->name )
+                CONS_Printf("pool %-14s: %6d / %6d items, %3d chunks, %3d%%\n",
+                        sc->name, sc->num_used, total, sc->num_chunk,
+                        (total)? (sc->num_used * 100 / total) : 0 );
+            else
+                CONS_Printf("slab %3d bytes     : %6d / %6d items, %3d chunks, %3d%%\n",
+                        sc->datasize, sc->num_used, total, sc->num_chunk,
+                        (total)? (sc->num_used * 100 / total) : 0 );
+        }
+    }
+#endif
 #ifdef HWRENDER
     if( rendermode != render_soft )
     {
@@ -1298,6 +1724,77 @@ char *Z_Strdup(const char *s, memtag_e tag, void **user)
   return strcpy(Z_Malloc(strlen(s)+1, tag, user), s);
 }
 
+
+// [WDJ] Dedicated pools of equal size items.
+// The items are packed into chunks, aligned, and stay at the same address.
+// They are freed by Z_Free, and by Z_FreeTags, like any zone block.
+#ifndef ZONE_SLAB
+struct slab_class_s
+{
+    int   datasize;
+};
+#define MAX_SLAB_POOL   4
+static struct slab_class_s  zpool_fallback[MAX_SLAB_POOL];
+static int  num_zpool_fallback = 0;
+#endif
+
+//  name : for meminfo
+//  datasize : item size
+//  alignbits : item alignment, such as 6 for cache lines
+zpool_t *  Z_Pool_Create( const char * name, int datasize, int alignbits )
+{
+#ifdef ZONE_SLAB
+    slab_class_t * sc;
+    int align = 1 << alignbits;
+
+    if( align < 8 )  align = 8;
+    if( num_slab_class >= NUM_SLAB_CLASS + MAX_SLAB_POOL )
+        I_Error( "Z_Pool_Create: too many pools\n" );
+
+    sc = & slab_class[ num_slab_class++ ];
+    sc->name = name;
+    sc->datasize = datasize;
+    sc->itemsize = (datasize + sizeof(memblock_t) + align - 1) & ~(align - 1);
+    // The item data, after its memblock_t header, is aligned.
+    sc->first_item = ((sizeof(slab_chunk_t) + sizeof(memblock_t) + align - 1) & ~(align - 1))
+                     - sizeof(memblock_t);
+    sc->items_per_chunk = (SLAB_CHUNK_SIZE - sc->first_item) / sc->itemsize;
+    if( sc->items_per_chunk < 1 )
+        I_Error( "Z_Pool_Create: %s item too large\n", name );
+    sc->num_chunk = 0;
+    sc->num_used = 0;
+    sc->chunks = NULL;
+    sc->inuse.next = sc->inuse.prev = & sc->inuse;
+    sc->inuse.memtag = PU_ZONE;
+    sc->inuse.id = SLABID;
+    return sc;
+#else
+    // Without the slabs, the items are ordinary zone blocks.
+    zpool_t * zp;
+    if( num_zpool_fallback >= MAX_SLAB_POOL )
+        I_Error( "Z_Pool_Create: too many pools\n" );
+    zp = & zpool_fallback[ num_zpool_fallback++ ];
+    zp->datasize = datasize;
+    return zp;
+#endif
+}
+
+// The tag must be less than PU_PURGELEVEL.
+void *  Z_Pool_Malloc( zpool_t * pool, memtag_e tag, void ** user )
+{
+#ifdef ZONE_SLAB
+    void * sp = Z_Slab_Alloc( pool, tag, user );
+# ifdef DEBUG_ZONE
+    memblock_t * sb = (memblock_t *)((byte *)sp - sizeof(memblock_t));
+    sb->ownerfile = (char*) pool->name;
+    sb->ownerline = 0;
+# endif
+    return sp;
+#else
+    return Z_Malloc( pool->datasize, tag, user );
+#endif
+}
+
 // return size of data of this block.
 int Z_Datasize( void* ptr )
 {
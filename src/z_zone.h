@@ -138,9 +138,20 @@ void*   Z_MallocAlign(int reqsize, memtag_e tag, void **user, int alignbits);
 
 char * Z_Strdup(const char *s, memtag_e tag, void **user);
 
+// Dedicated pool of equal size items, freed by Z_Free and Z_FreeTags.
+typedef struct slab_class_s  zpool_t;
+zpool_t *  Z_Pool_Create( const char * name, int datasize, int alignbits );
+void *  Z_Pool_Malloc( zpool_t * pool, memtag_e tag, void ** user );
+
 // return size of data of this block.
 int Z_Datasize( void* ptr );
 
+// Memory mapped regions, whose contents are passed off as zone blocks.
+// Z_Free and Z_ChangeTag ignore ptrs within them.
+void  Z_Add_Mapped( void * base, size_t size );
+void  Z_Remove_Mapped( void * base );
+byte  Z_Is_Mapped( void * ptr );
+
 // memblock header
 typedef struct memblock_s  memblock_t;
 typedef struct memblock_s